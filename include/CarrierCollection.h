@@ -53,7 +53,7 @@ public:
 
 	double beamy = 0. , beamz = 0.; //Mean position of the injected carriers in detector plane (y,z)
 
-	void add_carriers_from_file(QString filename, std::string scanType, double depth);
+	void add_carriers_from_file(QString filename, std::string scanType, double depth, int stride = 1);
 	void simulate_drift( double dt, double max_time, double shift_x, double shift_y,  std::valarray<double> &curr_elec, std::valarray<double> &curr_hole, int &totalCrosses);
 
 	TH2D get_e_dist_histogram(int n_bins_x, int n_bins_y, TString hist_name = "e_dist", TString hist_title ="e_dist");
@@ -0,0 +1,99 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   On-disk layout of the "edge" trees (measurements from Edge_tree, simulations from
+   TRACSInterface and EdgeTreeWriter, fit outputs), shared by all writers and readers.
+
+   Writers create the raw (TMeas) and proc (TWaveform) branches fully split, so every
+   data member is a column of its own (Vbias, z, volt, Qt, BlineMean, ...), with baskets
+   sized for waveforms of thousands of samples. The tree is flushed every 30 MB, which
+   is also when ROOT resizes the baskets to the entries seen so far.
+
+   The compression is 100*algorithm + level, as TFile takes it (1 zlib, 2 LZMA, 4 LZ4,
+   5 ZSTD; level 0-9). It defaults to EDGE_COMPRESS, which can be set at build time
+   (-DEDGE_COMPRESS=404 for LZ4 at level 4, for instance).
+
+   Readers call Activate with the columns they use: the rest are neither read nor
+   decompressed by GetEntry. The branch names are those of the data members, without
+   the name of the object branch, as TTree::Draw takes them. Trees written before,
+   with raw and proc unsplit, have no such columns: they are left as they are.
+
+   Built with -DEDGE_SHARED_T=1 the time axis, Tstart+i*At for every entry, goes once
+   in the TMeasHeader (SharedT=1; Tstart is 0 unless the writer sets it), and time and
+   Qt (the running sum of volt-BlineMean) are left out of the entries, which takes the
+   raw branch down to about a third. Readers call TMeas::Expand after GetEntry, with
+   the BlineMean of the proc entry, to fill both again, and write time in the formulas
+   of TTree::Draw as TimeFormula does. Writers go through Fill and AddHeader, so that
+   the entries and the header agree on the mode.
+
+*/
+
+#ifndef EDGELAYOUT_H
+#define EDGELAYOUT_H
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TString.h>
+
+#ifndef EDGE_COMPRESS
+#define EDGE_COMPRESS 105              //zlib, level 5
+#endif
+
+#ifndef EDGE_SHARED_T
+#define EDGE_SHARED_T 0                //1: time axis in the header, not in the entries
+#endif
+
+class TMeas ;
+class TMeasHeader ;
+
+namespace edgelayout {
+
+	const Int_t    kSplit     = 99 ;           //Every data member in its own branch
+	const Int_t    kBasket    = 256000 ;       //Bytes
+	const Long64_t kAutoFlush = -30000000 ;    //Bytes, negative: flush every so many
+
+	//Sets the compression of f (EDGE_COMPRESS if compress < 0)
+	void SetCompression( TFile * f , Int_t compress = -1 ) ;
+
+	//Flushing of a new tree
+	void Setup( TTree * tree ) ;
+
+	//Split branch of an object, obj is the address of the pointer to it (as &em)
+	template <class T> TBranch * Branch( TTree * tree , const char * name , T ** obj ) {
+		return tree->Branch( name , obj , kBasket , kSplit ) ;
+	}
+
+	//Only the branches in the comma separated list columns (and their objects) are read.
+	//Returns kFALSE, leaving the tree untouched, if any is not a branch of the tree
+	Bool_t Activate( TTree * tree , const char * columns ) ;
+
+	//Reads all the branches again
+	void ActivateAll( TTree * tree ) ;
+
+	//tree->Fill(), with time and Qt stored in the entry em unless EDGE_SHARED_T
+	Int_t Fill( TTree * tree , TMeas * em ) ;
+
+	//Adds emh, marked with the time axis mode of Fill, to the user info of tree
+	void AddHeader( TTree * tree , TMeasHeader * emh ) ;
+
+	//Columns that hold the time axis of the entries of tree, for Activate
+	TString TimeColumns( TTree * tree ) ;
+
+	//formula of TTree::Draw with the column time as T0+Iteration$*At if the axis is shared
+	TString TimeFormula( TString formula , Bool_t shared , Double_t At , Double_t T0 ) ;
+
+}
+
+#endif
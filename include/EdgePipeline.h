@@ -0,0 +1,104 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Three stage conversion of the waveforms read by Edge_tree:
+
+     reader   the parser, which reads one waveform after another into its TMeas and
+              hands each one over with Push
+     workers  build the TWaveform of every waveform (baseline, edges, rise time,
+              charges), several at once. Each one takes a block of the events waiting
+              and computes their extrema, baselines, rise times and running charges
+              together (WaveformBatch)
+     writer   fills the tree with them, in the order they were read
+
+   Push copies the fields of the event and swaps its arrays with those of a free one,
+   so nothing is copied sample by sample and the parser goes on with the next one
+   while the others are processed. There is a fixed number of events in flight: Push
+   waits when all of them are taken.
+
+   The "raw" branch is given the writer's own TMeas, so the object of the parser is not
+   read while the parser writes it. With ROOT's implicit multithreading enabled the
+   baskets are also compressed in parallel when the tree flushes them.
+
+*/
+
+#ifndef EDGEPIPELINE_H
+#define EDGEPIPELINE_H
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "TTree.h"
+#include "TMeas.h"
+#include "TWaveform.h"
+#include "WaveformBatch.h"
+
+class EdgePipeline {
+
+  public:
+
+     //em: the event of the parser, with its arrays already allocated
+     EdgePipeline( TTree * tree , TMeas * em , int nworkers = 0 ) ;
+
+     ~EdgePipeline( ) ;
+
+     //LPower, LNph: laser power and photons, for the TWaveform of the event (TCT+)
+     void Push( TMeas * em , Double_t LPower = 0. , Double_t LNph = 0. ) ;
+
+     //Waits until all the events pushed are in the tree
+     void Close( ) ;
+
+     Long64_t GetEntries( ) const { return nout ; } ;
+
+  private:
+
+     struct Record {
+        TMeas * ev ;
+        TWaveform * wv ;
+        Double_t LPower , LNph ;
+     } ;
+
+     void Worker( ) ;
+     void Writer( ) ;
+     void Process( std::vector< std::pair<Long64_t,Record> > & jobs , WaveformBatch *& batch ) ;
+
+     static void Swap( TMeas * to , TMeas * from ) ;
+
+     EdgePipeline( const EdgePipeline & ) = delete ;
+     EdgePipeline & operator=( const EdgePipeline & ) = delete ;
+
+     enum { kBlock = 4 } ;                        //Events a worker takes at once
+
+     TTree * tree ;
+     TMeas * out ;                                //Object of the raw branch
+     TWaveform * wv ;                             //Object of the proc branch
+     std::vector<TMeas *> events ;
+     std::vector<TMeas *> idle ;                  //Free to take the next Push
+     std::deque< std::pair<Long64_t,Record> > work ;
+     std::map<Long64_t,Record> done ;
+     Long64_t nin , nout ;
+     bool closing ;
+     std::mutex qmtx ;
+     std::condition_variable cvidle , cvwork , cvdone ;
+     std::vector<std::thread> workers ;
+     std::thread writer ;
+
+};
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Writer of the simulated currents of a scan straight into the "edge" tree that
+   Edge_tree builds from a .hetct file, and that TRACSFit and TScan read:
+
+     raw    TMeas, one entry per (V, Y, Z) point, in the order of the rows
+     proc   TWaveform of the same entry
+     user info of the tree: the TMeasHeader of the scan
+
+   Rows are given as to HetctWriter, so the same batches feed both. Nothing is written
+   to text and parsed back. The layout, compression included, is that of EdgeLayout.h
+   unless given otherwise.
+
+   Unlike parse_TRACS, the slices ix, iy, iz are counted with the steps in microns
+   and the positions in millimetres, so they do count the points of the scan.
+
+   All the calls, construction included, must come from the same thread.
+
+*/
+
+#ifndef EDGETREEWRITER_H
+#define EDGETREEWRITER_H
+
+#include <string>
+#include <vector>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TMeas.h>
+#include <TWaveform.h>
+#include <TMeasHeader.h>
+
+#include <HetctWriter.h>
+#include <EdgeLayout.h>
+
+class EdgeTreeWriter {
+
+  public:
+
+     //Takes ownership of emh, which goes into the file. compress < 0: EDGE_COMPRESS
+     EdgeTreeWriter( std::string filename , TMeasHeader * emh , Int_t compress = -1 , Int_t bufsize = edgelayout::kBasket , Long64_t autoflush = edgelayout::kAutoFlush ) ;
+
+     ~EdgeTreeWriter( ) ;
+
+     void Write( const std::vector<HetctWriter::Row> & rows ) ;
+
+     //Writes the header and the tree, and closes the file
+     void Close( ) ;
+
+     Long64_t GetEntries( ) const { return nfill ; } ;
+
+  private:
+
+     void Fill( const HetctWriter::Row & row ) ;
+
+     EdgeTreeWriter( const EdgeTreeWriter & ) = delete ;
+     EdgeTreeWriter & operator=( const EdgeTreeWriter & ) = delete ;
+
+     TFile * file ;
+     TTree * tree ;
+     TMeas * em ;
+     TWaveform * wv ;
+     TMeasHeader * emh ;
+     Int_t bufsize ;
+     Int_t ntmax ;                     //Samples allocated in em
+     Long64_t nfill ;
+     int Polarity ;
+     Double_t x0 , y0 , z0 ;
+
+};
+
+#endif
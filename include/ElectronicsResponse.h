@@ -0,0 +1,81 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Response of the readout electronics: a chain of stages (RC low pass, measured
+   amplifier transfer function, bandwidth limit) applied, in the order they were
+   added, to many waveforms at once.
+
+   The waveforms are held in a contiguous time-major matrix, w[it*nw + iw], so the
+   recursive filters advance all the waveforms together, one time step at a time,
+   with the innermost loop running over contiguous memory.
+
+*/
+
+#ifndef ELECTRONICSRESPONSE_H
+#define ELECTRONICSRESPONSE_H
+
+#include <vector>
+#include <valarray>
+#include <memory>
+
+#include <TH1D.h>
+#include <TRACSFFT.h>
+#include <WaveformStore.h>
+
+class ElectronicsResponse {
+
+  public:
+
+     ElectronicsResponse( double dt ) ;
+
+     //Stages
+     void AddRC( double RC ) ;
+     void AddTransferFunction( const std::vector<double> & tf , double tfdt ) ;
+     void AddBandwidth( double f3dB ) ;
+     void Clear( ) ;
+     int GetNStages( ) const { return stages.size() ; } ;
+
+     void SetTimeStep( double dt ) ;
+     void SetRC( double RC ) ;
+
+     //Time-major matrix of nw waveforms of nt samples
+     void Apply( std::vector<double> & w , int nw , int nt ) const ;
+
+     //Rows irows of waves (all of them if empty), packed, shaped and put back
+     void Apply( WaveformStore & waves , const std::vector<int> & irows = std::vector<int>() ) const ;
+
+     //Histogram of one waveform, only when asked for
+     static TH1D * Histogram( const std::valarray<double> & wave , double dt , TString name , TString title ) ;
+
+  private:
+
+     enum { kRC , kTransfer , kBandwidth } ;
+
+     struct Stage {
+        int type ;
+        double par ;                                  //RC (s), cut-off frequency (Hz) or time step of tf (s)
+        double c[5] ;                                 //Filter coefficients at the current time step
+        std::vector<double> tf ;                      //Transfer function as given
+        std::shared_ptr<fft::Kernel> kernel ;         //Transfer function resampled at the current time step
+     } ;
+
+     void Coefficients( Stage & s ) const ;
+
+     std::vector<Stage> stages ;
+     double dt ;
+
+};
+
+#endif
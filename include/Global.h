@@ -19,13 +19,17 @@
 #include <mutex>
 
 #include <TH1D.h> // 1 Dimensional ROOT histogram
+#include <WaveformStore.h>
+#include <ResultSink.h>
 
 
-extern std::vector<std::vector <TH1D*> >  i_ramo_array, i_conv_array, i_rc_array;
 extern int num_threads;
+extern int fidelity;
 extern std::mutex mtx;
 extern std::string fnm;
-extern std::valarray<std::valarray <double> > vItotals;
+extern WaveformStore vItotals, vIconv;
+extern bool floatStore;
+extern ResultSink * resultSink;
 extern std::ofstream fileDiffDrift;
 //extern std::atomic<double> numberDs;
 //extern std::atomic<int> tempNumberDs;
@@ -0,0 +1,69 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Writer of the data rows of a .hetct file (the header is written by
+   utilities::write_to_hetct_header):
+
+     Nt T(C) V 0  y(mm) z(mm) i[0] ... i[Nt-1]
+
+   The file stays open with a large buffer. A batch of rows is formatted by several
+   threads at once, each one into its own block of text, and the blocks are then
+   written one after the other. Samples are written with the fewest digits that read
+   back to the same value (float or double, as stored), zeros as a single 0; the
+   coordinates as before, with six significant digits.
+
+*/
+
+#ifndef HETCTWRITER_H
+#define HETCTWRITER_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <WaveformStore.h>
+
+class HetctWriter {
+
+  public:
+
+     struct Row {
+        WaveformStore::View wave ;
+        double temp , yShift , height , voltage ;   //K, um, um, V
+     } ;
+
+     HetctWriter( std::string filename , size_t bufsize = 1 << 22 ) ;
+
+     ~HetctWriter( ) ;
+
+     void Write( const std::vector<Row> & rows , int nthreads = 1 ) ;
+
+     void Flush( ) ;
+
+     static void Format( const Row & row , std::string & text ) ;
+
+     static char * Shortest( char * p , double v , bool single = false ) ;
+
+  private:
+
+     HetctWriter( const HetctWriter & ) = delete ;
+     HetctWriter & operator=( const HetctWriter & ) = delete ;
+
+     FILE * fp ;
+     std::vector<char> buffer ;
+
+};
+
+#endif
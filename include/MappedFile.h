@@ -0,0 +1,88 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Read-only view of a whole text file, mapped in memory instead of read through an
+   ifstream, with a cursor that moves over it.
+
+   Header lines are taken with GetLine, as with getline. The data are taken number by
+   number with Next, which skips blanks and newlines as operator>> does and converts
+   the characters in place: decimal numbers of up to 19 digits and small exponents
+   (the scope values, "-1.611310E-8") are converted exactly with integer arithmetic
+   and one product or quotient by a power of ten, which gives the same double as
+   strtod. Any other number is handed to strtod. When the next token is not a number
+   Next returns false and the cursor stays before it.
+
+*/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+class MappedFile {
+
+  public:
+
+     MappedFile( std::string filename ) ;
+
+     ~MappedFile( ) ;
+
+     bool IsOpen( ) const { return fd >= 0 ; } ;
+
+     size_t GetSize( ) const { return end - begin ; } ;
+
+     void Rewind( ) { p = begin ; } ;
+
+     //Nothing left but blanks
+     bool Eof( ) ;
+
+     //Rest of the current line, without the newline
+     bool GetLine( std::string & line ) ;
+
+     void SkipLine( ) ;
+
+     //Next blank separated token
+     bool Word( std::string & word ) ;
+
+     //Next character that is not a blank, as operator>>(char)
+     bool Char( char & c ) ;
+
+     bool Next( double & v ) ;
+     bool Next( int & v ) ;
+     bool Next( unsigned short & v ) ;
+
+     const char * Tell( ) const { return p ; } ;
+
+     void Seek( const char * pos ) { p = pos ; } ;
+
+     //Converts the number at s, returns where it ends or s if there is none
+     static const char * Parse( const char * s , const char * e , double & v ) ;
+
+  private:
+
+     MappedFile( const MappedFile & ) = delete ;
+     MappedFile & operator=( const MappedFile & ) = delete ;
+
+     void SkipBlanks( ) ;
+
+     int fd ;
+     const char * begin ;
+     const char * end ;
+     const char * p ;
+
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Streaming output of the currents of a scan, instead of keeping all of them in
+   vItotals until the end of the run.
+
+   The simulating threads Push every current as soon as it is shaped, together with
+   its store row ( iv*NY + iy )*NZ + iz. Pushes go into a bounded lock-free queue; when
+   it is full the thread waits, so memory stays bounded however large the scan is.
+   A writer thread, started by Open, pops them and fills the edge tree of the scan
+   (EdgeTreeWriter) in row order, holding the ones that arrive early in a reorder
+   buffer. A Push of a row window or more past the next one to write waits, so that
+   buffer never holds more than window rows, however slow one point is. Every thread
+   pushes its rows in increasing order, so the one holding the next row is never
+   kept waiting. On request the rows are also appended to the .hetct file,
+   which is flushed whenever the queue runs dry, so the rows written survive if the
+   run is interrupted.
+
+*/
+
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+#include <string>
+#include <vector>
+#include <valarray>
+#include <map>
+#include <atomic>
+#include <thread>
+
+#include <HetctWriter.h>
+#include <EdgeTreeWriter.h>
+
+class ResultSink {
+
+  public:
+
+     //hetct: also export the rows as text; single: samples kept in single precision, as
+     //the rows of a WaveformStore with floatStore
+     ResultSink( bool hetct = false , bool single = false , size_t capacity = 1024 , size_t window = 1024 ) ;
+
+     ~ResultSink( ) ;
+
+     void Push( size_t row , const std::valarray<double> & w , double temp , double yShift , double height , double voltage ) ;
+
+     //Starts writing the tree to filename with .root for .hetct, and appending to
+     //filename (header already written) if hetct. Takes ownership of emh
+     void Open( std::string filename , TMeasHeader * emh ) ;
+
+     bool IsHetct( ) const { return hetct ; } ;
+
+     //Waits for all the pushed rows to be written
+     void Close( ) ;
+
+     size_t GetNWritten( ) const { return nwritten ; } ;
+
+  private:
+
+     struct Item {
+        size_t row ;
+        double temp , yShift , height , voltage ;
+        std::vector<double> samples ;
+        std::vector<float> ssamples ;                 //Instead of samples if single
+     } ;
+
+     struct Slot {
+        std::atomic<size_t> seq ;
+        Item item ;
+     } ;
+
+     bool Pop( Item & item ) ;
+     void Writer( ) ;
+     void Write( std::vector<Item> & ready ) ;
+
+     ResultSink( const ResultSink & ) = delete ;
+     ResultSink & operator=( const ResultSink & ) = delete ;
+
+     std::vector<Slot> slots ;
+     size_t mask ;
+     std::atomic<size_t> head , tail ;                //Next slot to push and to pop
+
+     std::map<size_t,Item> pending ;                  //Reorder buffer, writer thread only
+     std::atomic<size_t> next ;                       //Next row to write
+     size_t window ;                                  //Rows past next that may be pushed
+     bool hetct ;
+     bool single ;
+     HetctWriter * out ;
+     std::string rootname ;
+     TMeasHeader * emh ;
+     EdgeTreeWriter * tree ;                          //Created and used by the writer thread
+     std::thread writer ;
+     std::atomic<bool> closing ;
+     std::atomic<size_t> nwritten ;
+
+};
+
+#endif
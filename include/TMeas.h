@@ -24,6 +24,8 @@
 
 using namespace std ;       //Evita usar std::cin;
 
+class TMeasHeader ;
+
 class TMeas: public TObject {
 
    public:
@@ -62,10 +64,16 @@ class TMeas: public TObject {
      char       comment[NXCHAR] ; //! (DNS) File comment
      
      Int_t      Nt       ;	  //Number of bins in scope		    
+     Int_t      NtS      ;        //Bins of time and Qt in the entry: Nt, or 0 with the time axis in the header
      Double_t   *volt	 ;        //[Nt]
-     Double_t   *time	 ;        //[Nt]
+     Double_t   *time	 ;        //[NtS]
      //One possible change: Qt is not neccessary to be declared as a pointer.
-     Double_t * Qt	 ;            //[Nt]
+     Double_t * Qt	 ;            //[NtS]
+
+     //Entries read from a tree with TMeasHeader::SharedT get time from the header and
+     //Qt as the running sum of volt-BlineMean (as TWaveform::CalcRunningCharge), with
+     //BlineMean that of the proc entry. Others are left as they are
+     void Expand( const TMeasHeader * emh , Double_t BlineMean ) ;
 
      
      UShort_t   Setup    ;          //! 0=OldTCT , 1=eTCT (default), 2=TCT+
@@ -73,7 +81,7 @@ class TMeas: public TObject {
              
      UInt_t     Ntevent ;          //! Total number of DATA-START
 
-    ClassDef(TMeas,1)  //Edge-TCT data class
+    ClassDef(TMeas,2)  //Edge-TCT data class
 } ;
 
 
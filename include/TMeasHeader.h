@@ -39,6 +39,8 @@ class TMeasHeader: public TObject {
      Double_t   Ay ;              //Y step [mum]                 
      Double_t   Az ;              //Z step [mum]                 
      Double_t   Nt ;              //Number of steps in time
+     Int_t      SharedT ;         //1: time and Qt not in the entries, time[i]=Tstart+i*At (TMeas::Expand)
+     Double_t   Tstart ;          //Origin of the shared time axis [ns]
      
      TString    comment ;         //File comment
      Double_t   Temp ;            //Temperature
@@ -93,7 +95,7 @@ class TMeasHeader: public TObject {
      Double_t GetTemperature()    {return Temp ;} 	    
      TString  GetComment() { return comment; } 
 
-    ClassDef(TMeasHeader,3)  //Edge-TCT data header class
+    ClassDef(TMeasHeader,5)  //Edge-TCT data header class
 } ;
 
 #endif
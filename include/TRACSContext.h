@@ -0,0 +1,154 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   TRACSContext: a private simulation made of nparts TRACSInterface objects (one per
+   thread) writing into their own store of currents. It is built once and kept warm:
+   only the fit parameters change between evaluations.
+
+   TRACSEvaluator: a set of contexts used to simulate batches of parameter sets
+   concurrently, returning the residuals or chi2 of a TRACSFit for each of them.
+   It can also run any other kind of job needing a context of its own.
+
+   TRACSContextFCN: Minuit function simulating on a given context, for minimizations
+   running side by side (e.g. Minos).
+
+   TRACSGradientFCN: Minuit function providing its gradient, the finite differences of
+   all the free parameters simulated at once on the contexts of a TRACSEvaluator.
+
+*/
+
+#ifndef TRACSCONTEXT_H
+#define TRACSCONTEXT_H
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+#include <Minuit2/FCNGradientBase.h>
+
+#include <TRACSInterface.h>
+#include <TRACSFit.h>
+
+class TRACSContext {
+
+  public:
+
+     TRACSContext( std::string filename , int nparts ) ;
+
+     ~TRACSContext( ) ;
+
+     void Simulate( const std::vector<Double_t> & par , bool irradiated ) ;
+
+     void Residuals( TRACSFit * fit , const std::vector<Double_t> & par , bool irradiated , std::vector<Double_t> & res ) ;
+
+     Double_t Chi2( TRACSFit * fit , const std::vector<Double_t> & par , bool irradiated ) ;
+
+     TRACSInterface * GetInterface( ) { return sim[0] ; } ;
+
+     const WaveformStore & GetItotals( ) const { return store ; } ;
+
+     int GetNSimulations( ) { return nsim ; } ;
+
+  private:
+
+     void SimulatePart( int tid , const std::vector<Double_t> & par , bool irradiated ) ;
+
+     std::vector<TRACSInterface*> sim ;
+     WaveformStore store ;
+     int nsim ;
+
+};
+
+class TRACSEvaluator {
+
+  public:
+
+     TRACSEvaluator( std::string filename , TRACSFit * fit , bool irradiated , int ncontexts , int nthreads ) ;
+
+     ~TRACSEvaluator( ) ;
+
+     void Residuals( const std::vector< std::vector<Double_t> > & pars , std::vector< std::vector<Double_t> > & res ) ;
+
+     void Chi2( const std::vector< std::vector<Double_t> > & pars , std::vector<Double_t> & chi2 ) ;
+
+     void RunJobs( int njobs , std::function<void( int , TRACSContext * )> job ) ;
+
+     int GetNContexts( ) { return ctx.size() ; } ;
+
+     int GetNCalls( ) ;
+
+     TRACSFit * GetFit( ) { return fitter ; } ;
+
+     bool IsIrradiated( ) { return irrad ; } ;
+
+  private:
+
+     void Worker( int ic , int njobs , std::function<void( int , TRACSContext * )> * job , std::atomic<int> * next ) ;
+
+     std::vector<TRACSContext*> ctx ;
+     TRACSFit * fitter ;
+     bool irrad ;
+
+};
+
+class TRACSContextFCN : public ROOT::Minuit2::FCNBase {
+
+  public:
+
+     TRACSContextFCN( TRACSContext * context , TRACSFit * fit , bool irradiated ) : context( context ) , fitter( fit ) , irrad( irradiated ) { } ;
+
+     virtual Double_t operator( )( const std::vector<Double_t> & par ) const { return context->Chi2( fitter , par , irrad ) ; } ;
+
+     virtual Double_t Up( ) const { return 1. ; } ;
+
+  private:
+
+     TRACSContext * context ;
+     TRACSFit * fitter ;
+     bool irrad ;
+
+};
+
+class TRACSGradientFCN : public ROOT::Minuit2::FCNGradientBase {
+
+  public:
+
+     TRACSGradientFCN( TRACSEvaluator * ev ) : ev( ev ) , lastChi2( 0. ) , lastFidelity( 0 ) { } ;
+
+     //Parameters fixed in the minimization, not worth simulating their derivatives
+     void SetFixed( const std::vector<bool> & fix ) { fixed = fix ; } ;
+
+     virtual Double_t operator( )( const std::vector<Double_t> & par ) const ;
+
+     virtual std::vector<Double_t> Gradient( const std::vector<Double_t> & par ) const ;
+
+     //The gradient is numerical anyway: do not let Minuit compare it with its own, serially
+     virtual bool CheckGradient( ) const { return false ; } ;
+
+     virtual Double_t Up( ) const { return 1. ; } ;
+
+  private:
+
+     TRACSEvaluator * ev ;
+     std::vector<bool> fixed ;
+     mutable std::vector<Double_t> lastPar ;
+     mutable Double_t lastChi2 ;
+     mutable int lastFidelity ;                     //fidelity of lastChi2: a rung of the ladder does not reuse the previous one
+
+};
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Differential evolution (DE/rand/1/bin) global minimizer.
+
+   A population of parameter sets inside a box is evolved generation by generation;
+   every generation is a batch of independent chi2 evaluations handed to the caller
+   at once, so they can be simulated concurrently. Meant to find the basin of the
+   global minimum, leaving the final convergence and the errors to Migrad.
+
+*/
+
+#ifndef TRACSDE_H
+#define TRACSDE_H
+
+#include <vector>
+#include <functional>
+#include <random>
+
+class TRACSDE {
+
+  public:
+
+     //Fills chi2[i] with the chi2 of parameter set pars[i]
+     typedef std::function<void( const std::vector< std::vector<double> > & pars , std::vector<double> & chi2 )> BatchChi2 ;
+
+     TRACSDE( BatchChi2 fcn , const std::vector<double> & par , const std::vector<double> & low , const std::vector<double> & high ) ;
+
+     void Fix( int ipar ) ;
+
+     void SetPopulation( int n ) { npop = n ; } ;
+     void SetMaxGenerations( int n ) { maxGen = n ; } ;
+     void SetTolerance( double tol ) { tolerance = tol ; } ;
+     void SetSeed( unsigned int seed ) { rng.seed( seed ) ; } ;
+     void SetPrintLevel( int level ) { printLevel = level ; } ;
+
+     bool Minimize( ) ;
+
+     double Chi2( ) const { return chi2[ibest] ; } ;
+     int NGenerations( ) const { return nGen ; } ;
+     int NFcn( ) const { return nFcn ; } ;
+     const std::vector<double> & Parameters( ) const { return pop[ibest] ; } ;
+     std::vector<double> Spread( ) const ;
+
+  private:
+
+     BatchChi2 fcn ;
+
+     std::vector<double> par , low , high ;
+     std::vector<bool> fixed ;
+
+     std::vector< std::vector<double> > pop ;        //Population and the chi2 of its members
+     std::vector<double> chi2 ;
+     int ibest ;
+
+     std::mt19937 rng ;
+     double tolerance ;
+     int npop , maxGen , nGen , nFcn , printLevel ;
+
+};
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Error analysis after Migrad. Every Minos side (a constrained minimization) and
+   every point of a chi2 scan is an independent job, run concurrently on the
+   simulation contexts of a TRACSEvaluator.
+
+*/
+
+#ifndef TRACSERRORS_H
+#define TRACSERRORS_H
+
+#include <vector>
+#include <utility>
+
+#include <Minuit2/FunctionMinimum.h>
+#include <Minuit2/MnUserParameterState.h>
+#include <Minuit2/MinosError.h>
+
+#include <TRACSContext.h>
+
+std::vector<ROOT::Minuit2::MinosError> ParallelMinos( TRACSEvaluator & ev , const ROOT::Minuit2::FunctionMinimum & min , const std::vector<unsigned int> & ipars , unsigned int strategy = 1 ) ;
+
+std::vector< std::pair<double,double> > ParallelScan( TRACSEvaluator & ev , const ROOT::Minuit2::MnUserParameterState & state , unsigned int ipar , unsigned int npoints = 21 , double low = 0. , double high = 0. ) ;
+
+void ErrorAnalysis( std::string filename , TRACSFit * fit , bool irradiated , const ROOT::Minuit2::FunctionMinimum & min , int nthreads , unsigned int npoints = 21 ) ;
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Radix-2 fast Fourier transform and the correlation and convolution of sampled waveforms
+   built on it. Plain arrays, no ROOT and no global state: safe to call from any thread.
+
+*/
+
+#ifndef TRACSFFT_H
+#define TRACSFFT_H
+
+#include <vector>
+#include <complex>
+#include <map>
+#include <mutex>
+
+namespace fft
+{
+	//Smallest power of 2 not below n
+	size_t NextPow2( size_t n ) ;
+
+	//In place transform, a.size() a power of 2. The inverse includes the 1/N factor
+	void Transform( std::vector< std::complex<double> > & a , bool inverse ) ;
+
+	//r[d] = sum_k a[k] x[k+d] for d in [0,nlags), x taken as 0 beyond its end
+	void Correlate( const std::vector<double> & a , const std::vector<double> & x , int nlags , std::vector<double> & r ) ;
+
+	//Offset in (-0.5,0.5) of the vertex of the parabola through r[i-1], r[i], r[i+1]
+	double ParabolicPeak( const std::vector<double> & r , int i ) ;
+
+	//c[n] = sum_k a[k] b[n-k] for n in [0,nc), directly or by FFT, whichever is cheaper
+	void Convolve( const std::vector<double> & a , const std::vector<double> & b , size_t nc , std::vector<double> & c ) ;
+
+	//Fixed convolution kernel (e.g. a transfer function) keeping its spectrum for every
+	//padded length used, so that only the signal is transformed at each call
+	class Kernel {
+
+	  public:
+
+	     Kernel( const std::vector<double> & h ) : h( h ) { } ;
+
+	     void Apply( const std::vector<double> & x , size_t nc , std::vector<double> & y ) const ;
+
+	     size_t size( ) const { return h.size() ; } ;
+
+	  private:
+
+	     std::vector<double> h ;
+	     mutable std::map< size_t , std::vector< std::complex<double> > > spectra ;
+	     mutable std::mutex smtx ;
+
+	};
+}
+
+#endif
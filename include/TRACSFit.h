@@ -56,12 +56,25 @@ class TRACSFit : public ROOT::Minuit2::FCNBase {
 
      TRACSFit ( TString FileMeas , TString FileConf , TString howstr ) ;
 
+     TRACSFit ( TString FileMeas , TString FileConf , TString howstr , TRACSInterface * sim ) ;
+
      ~TRACSFit(  ) ;
 
      Double_t MyTRACSFit( TH1D *hsimc , TH1D *hmeasc );
 
      Double_t LeastSquares( ) ;
 
+     void Residuals( const WaveformStore & itotals , Double_t At , Double_t norm , std::vector<Double_t> & res ) const ;
+
+     Int_t GetNResiduals( ) const { return nRes ; } ;
+
+     //Trigger offset between simulation and measurement found by cross-correlation
+     enum { kNoAlign , kAlignGlobal , kAlignEvent } ;
+
+     void SetAlignment( Int_t mode , Double_t maxshift = 0. ) ;
+
+     void TimeShifts( const WaveformStore & itotals , Double_t At , std::vector<Double_t> & shift ) const ;
+
      virtual  Double_t operator( )(const std::vector<Double_t>& par  ) const ;
 
      virtual  Double_t Up() const {return 1.;}
@@ -124,6 +137,14 @@ class TRACSFit : public ROOT::Minuit2::FCNBase {
 
      Double_t theChi2, fitNorm;
 
+     /* Measurement cache used by Residuals( ) */
+     vector<Int_t> simEntry ;                        //Simulation entry (index in the current store) of every selected event
+     vector< vector<Double_t> > timem_c , voltm_c ;  //Measured times and sign flipped, baseline corrected volts in [iminm,imaxm)
+     Int_t nRes ;                                    //Total number of residuals
+     Double_t chiNorm ;                              //chiFinal from the steering file
+     Int_t alignMode ;                               //kNoAlign, kAlignGlobal or kAlignEvent
+     Double_t maxShift ;                             //Largest time shift searched by the alignment (ns)
+
      vector<Double_t> neffArray;
 
      Int_t  sameScale;       //Token that informs if input histograms are or not
@@ -39,6 +39,7 @@
 #include <Utilities.h>
 #include <Carrier.h>
 #include <CarrierCollection.h>
+#include <ElectronicsResponse.h>
 #include <Global.h>
 
 
@@ -46,6 +47,7 @@
 using std::vector;
 
 extern TH1D *H1DConvolution( TH1D *htct, Double_t Cend=0. , int tid=0) ; 
+extern void H1DConvolution( const std::valarray<double> & itct , Double_t bw , std::vector<double> & conv ) ;
 
 class TRACSInterface
 {
@@ -165,6 +167,19 @@ private:
 
 	//vector of i_total
 	//std::valarray<std::valarray <double> > vItotals;
+	WaveformStore * itotals; //Where loop_on() stores the shaped currents (vItotals by default)
+	int n_parts; //Number of z partitions (threads) sharing this simulation
+
+	//Fidelity: mesh cells and time step coarsened, carriers subsampled by this factor
+	int fidelity;
+	int n_cells_x0, n_cells_y0;
+	double dt0;
+
+	//Convolute the currents with the amplifier transfer function in loop_on
+	bool convolution;
+
+	//Readout chain applied at once to all the currents of the store (RC, TransferFunction, Bandwidth)
+	ElectronicsResponse * electronics;
 
 	//Time variables
 	UShort_t year, month, day, hour, min, sec;
@@ -172,7 +187,7 @@ private:
 public:
 
 	// Constructor
-	TRACSInterface(std::string filename); // Reads values, initializes detector
+	TRACSInterface(std::string filename, int nparts = 0, WaveformStore * store = nullptr); // Reads values, initializes detector
 
 	// Destructor
 	~TRACSInterface();
@@ -190,6 +205,8 @@ public:
 
 	// Simulations
 	void simulate_ramo_current();
+	void shape_rc();
+	void check_electronics(const WaveformStore::View & v);
 	void calculate_fields();
 
 	//Calculate time
@@ -210,10 +227,15 @@ public:
 	//double get_genTime();
 	std::vector<double> get_NeffParam();
 	std::string get_neff_type();
+	std::string get_hetctFilename();
 	int GetnSteps();
 	double GetTolerance();
 	double GetchiFinal();
 	int GettotalCrosses();
+	int GetNparts();
+	int get_Fidelity();
+	bool get_Convolution();
+	ElectronicsResponse * GetElectronics();
 
 
 
@@ -228,13 +250,16 @@ public:
 	void set_yPos(double newYPos);
 	void set_vBias(double newVBias);
 	void set_tcount(int tid = 0);
+	void set_hetctFilename();
 	void write_header(int tid = 0);
-	void resize_array();
 	void write_to_file(int tid = 0);
+	void write_conv_to_file(int tid = 0);
 	void fields_hist_to_file(int, int);
 	void set_neffType(std::string newParametrization);
 	void set_carrierFile(std::string newCarrFile);
 	void set_vItotals(double);
+	void set_Fidelity(int factor);
+	void set_Convolution(bool on);
 	void resetAll();
 
 
@@ -242,6 +267,7 @@ public:
 	//ROOT related
 	void DumpToTree( TMeas *em , TTree *tree ) ;
 	void GetTree( TTree * tree ) ;
+	TMeasHeader * GetMeasHeader( ) ;
 };
 
 #endif // TRACSINTERFACE_H
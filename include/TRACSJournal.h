@@ -0,0 +1,89 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Append-only journal of the chi2 evaluations of a fit.
+
+   Every evaluation (parameter vector -> chi2) and the state reached at the end of
+   every minimization stage are written to a text file as soon as they are known,
+   with numbers in hexadecimal floating point so they are read back bit for bit.
+   Evaluations are also kept in a hash table: a parameter vector already seen, in
+   this run or in a previous one, is not simulated again. Since Migrad is deterministic
+   given the chi2 values, rerunning a fit on its journal replays it from the cache up
+   to the point where it stopped and continues from there. Stages completed in a
+   previous run need not be replayed at all: GetStage gives the values and errors
+   they ended with.
+
+   Only the evaluations the fit program hands to Record are journaled (in MfgTRACSFit,
+   those of the Migrad FCN); others, run on their own simulation contexts, are not.
+
+   Record types, one per line:
+     H key                                      fit the journal belongs to
+     E stage chi2 npar p[0..npar-1]             evaluation
+     S stage valid fval edm nfcn npar val[] err[] fixed[]   end of stage
+
+*/
+
+#ifndef TRACSJOURNAL_H
+#define TRACSJOURNAL_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <utility>
+#include <mutex>
+
+class TRACSJournal {
+
+  public:
+
+     TRACSJournal( std::string filename , std::string key ) ;
+
+     ~TRACSJournal( ) ;
+
+     bool Lookup( const std::vector<double> & par , double & chi2 ) ;
+
+     void Record( int stage , const std::vector<double> & par , double chi2 ) ;
+
+     void RecordStage( int stage , bool valid , double fval , double edm , int nfcn , const std::vector<double> & val , const std::vector<double> & err , const std::vector<bool> & fixed ) ;
+
+     int GetNEvaluations( ) { return cache.size() ; } ;
+
+     int GetNHits( ) { return nhits ; } ;
+
+     int GetLastStage( ) { return lastStage ; } ;
+
+     //Values and errors at the end of stage, if it is in the journal
+     bool GetStage( int stage , std::vector<double> & val , std::vector<double> & err ) ;
+
+  private:
+
+     struct ParHash {
+        size_t operator( )( const std::vector<double> & par ) const ;
+     } ;
+
+     void Read( std::string filename , std::string key ) ;
+
+     std::unordered_map< std::vector<double> , double , ParHash > cache ;
+     std::map< int , std::pair< std::vector<double> , std::vector<double> > > stages ;
+     FILE * fp ;
+     std::mutex jmtx ;
+     int nhits ;
+     int lastStage ;
+
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Levenberg-Marquardt minimizer for chi2 = sum r_i^2.
+
+   Works on the residual vector r(p) instead of on the scalar chi2, so that the
+   Gauss-Newton approximation J^T J of the Hessian comes for free out of the
+   Jacobian. The residuals are requested in batches (the Jacobian columns, all at
+   once), letting the caller simulate them concurrently. Optionally uses the
+   geodesic acceleration of Transtrum & Sethna to follow curved valleys.
+
+*/
+
+#ifndef TRACSLMFIT_H
+#define TRACSLMFIT_H
+
+#include <vector>
+#include <functional>
+
+class TRACSLMFit {
+
+  public:
+
+     //Fills res[i] with the residual vector of parameter set pars[i]
+     typedef std::function<void( const std::vector< std::vector<double> > & pars , std::vector< std::vector<double> > & res )> BatchResiduals ;
+
+     TRACSLMFit( BatchResiduals fcn , const std::vector<double> & par , const std::vector<double> & err ) ;
+
+     void Fix( int ipar ) ;
+     void Release( int ipar ) ;
+     void SetValue( int ipar , double val ) ;
+     void SetError( int ipar , double err ) ;
+
+     void SetTolerance( double tol ) { tolerance = tol ; } ;
+     void SetMaxIterations( int n ) { maxIter = n ; } ;
+     void SetGeodesic( bool on ) { geodesic = on ; } ;
+     void SetPrintLevel( int level ) { printLevel = level ; } ;
+
+     bool Minimize( ) ;
+
+     bool IsValid( ) const { return valid ; } ;
+     double Chi2( ) const { return chi2 ; } ;
+     double Edm( ) const { return edm ; } ;
+     int NIterations( ) const { return nIter ; } ;
+     int NFcn( ) const { return nFcn ; } ;
+     bool IsFixed( int ipar ) const { return fixed[ipar] ; } ;
+     double Value( int ipar ) const { return par[ipar] ; } ;
+     double Error( int ipar ) const { return errors[ipar] ; } ;
+     const std::vector<double> & Parameters( ) const { return par ; } ;
+     const std::vector<double> & Errors( ) const { return errors ; } ;
+     const std::vector< std::vector<double> > & Covariance( ) const { return cov ; } ;
+
+  private:
+
+     void Jacobian( ) ;
+     void Evaluate( const std::vector< std::vector<double> > & pars , std::vector< std::vector<double> > & res ) ;
+     void CalcErrors( ) ;
+
+     BatchResiduals fcn ;
+
+     std::vector<double> par , step ;                //Parameters and their initial errors (scale of the FD steps)
+     std::vector<bool> fixed ;
+     std::vector<int> ifree ;                        //Indexes of the free parameters
+
+     std::vector<double> r ;                         //Residuals at par
+     std::vector< std::vector<double> > J ;          //Jacobian, J[k][i] = dr_i/dp_ifree[k]
+     std::vector< std::vector<double> > JtJ ;
+     std::vector<double> Jtr ;
+
+     std::vector<double> errors ;
+     std::vector< std::vector<double> > cov ;
+
+     double chi2 , edm , lambda , tolerance ;
+     int maxIter , nIter , nFcn , printLevel ;
+     bool geodesic , valid ;
+
+};
+
+#endif
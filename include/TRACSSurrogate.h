@@ -0,0 +1,86 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Surrogate-model minimizer for chi2 = sum r_i^2.
+
+   Every simulated parameter set and its residual vector are kept, and a radial basis
+   function interpolant of the residuals (one per time bin, all sharing the same
+   centres) stands in for the simulation. The emulated chi2 is minimized, which costs
+   nothing, and only the candidates it proposes are simulated, in batches, inside a
+   trust region that grows or shrinks depending on how well the emulator predicted
+   them.
+
+*/
+
+#ifndef TRACSSURROGATE_H
+#define TRACSSURROGATE_H
+
+#include <vector>
+#include <random>
+
+#include <TRACSLMFit.h>
+
+class TRACSSurrogate {
+
+  public:
+
+     typedef TRACSLMFit::BatchResiduals BatchResiduals ;
+
+     TRACSSurrogate( BatchResiduals fcn , const std::vector<double> & par , const std::vector<double> & err ) ;
+
+     void Fix( int ipar ) ;
+
+     void SetBatch( int n ) { nBatch = n ; } ;
+     void SetMaxSimulations( int n ) { maxFcn = n ; } ;
+     void SetTolerance( double tol ) { tolerance = tol ; } ;
+     void SetPrintLevel( int level ) { printLevel = level ; } ;
+
+     bool Minimize( ) ;
+
+     void Predict( const std::vector<double> & p , std::vector<double> & res ) const ;
+
+     double Chi2( ) const { return chi2[ibest] ; } ;
+     int NIterations( ) const { return nIter ; } ;
+     int NFcn( ) const { return nFcn ; } ;
+     const std::vector<double> & Parameters( ) const { return pts[ibest] ; } ;
+     const std::vector<double> & Errors( ) const { return errors ; } ;
+
+  private:
+
+     void Evaluate( const std::vector< std::vector<double> > & pars ) ;
+     bool Train( ) ;
+     std::vector<double> Coordinates( const std::vector<double> & p ) const ;
+
+     BatchResiduals fcn ;
+
+     std::vector<double> par , scale , errors ;
+     std::vector<bool> fixed ;
+     std::vector<int> ifree ;
+
+     std::vector< std::vector<double> > pts ;        //Simulated parameter sets, their residuals and chi2
+     std::vector< std::vector<double> > res ;
+     std::vector<double> chi2 ;
+     int ibest ;
+
+     std::vector< std::vector<double> > X ;          //Centres in scaled coordinates and interpolation weights
+     std::vector< std::vector<double> > W ;
+
+     std::mt19937 rng ;
+     double tolerance ;
+     int nBatch , maxFcn , nIter , nFcn , printLevel ;
+
+};
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Features of a block of waveforms that share the time axis, computed all at once:
+
+     Extrema        Vmax, Vmin and their indices
+     Baseline       mean and RMS of the first nbl samples
+     Crossing       time where the signal crosses a fraction of its height, to the left
+                    or to the right of the extreme, linearly interpolated
+     RunningCharge  cumulative sum of volt - baseline (TMeas::Qt)
+
+   The samples are held time major, sample i of waveform w at i*GetNmax() + w, so every
+   pass goes along the time axis once for the whole block and the inner loop, over the
+   waveforms, has no branches and vectorizes. Each waveform still adds up its own
+   samples in order, so the results are those of TWaveform, waveform by waveform.
+
+*/
+
+#ifndef WAVEFORMBATCH_H
+#define WAVEFORMBATCH_H
+
+#include <vector>
+
+class WaveformBatch {
+
+  public:
+
+     //time: the axis of all the waveforms, nt samples; nmax: waveforms in a block
+     WaveformBatch( int nt , const double * time , int nmax = 8 ) ;
+
+     //Whether a waveform with this axis can go in the block
+     bool SameAxis( int nt , const double * time ) const ;
+
+     //Empties the block
+     void Clear( ) { n = 0 ; } ;
+
+     //Copies volt (nt samples) into the block, returns its index or -1 if full
+     int Add( const double * volt ) ;
+
+     void Extrema( ) ;
+
+     void Baseline( int nbl ) ;
+
+     //Threshold bline + fraction*(Vmax-bline) (Vmin if polarity -1), searched from the
+     //extreme to the left (as TWaveform::CalcSignalTimeL) or to the right (CalcSignalTimeR,
+     //which leaves t and it as they are if there is no crossing). Needs Extrema
+     void Crossing( double fraction , const double * bline , const int * polarity , bool left , double * t , int * it ) ;
+
+     void RunningCharge( const double * bline ) ;
+
+     //Copies the running charge of waveform w into qt
+     void GetRunningCharge( int w , double * qt ) const ;
+
+     int    GetN( ) const { return n ; } ;
+     int    GetNmax( ) const { return nmax ; } ;
+     int    GetNt( ) const { return nt ; } ;
+     double GetVmax( int w ) const { return vmax[w] ; } ;
+     double GetVmin( int w ) const { return vmin[w] ; } ;
+     int    GetiVmax( int w ) const { return (int) imax[w] ; } ;
+     int    GetiVmin( int w ) const { return (int) imin[w] ; } ;
+     double GetBlineMean( int w ) const { return blmean[w] ; } ;
+     double GetBlineRMS( int w ) const { return blrms[w] ; } ;
+
+  private:
+
+     int nt , nmax , n ;
+     std::vector<double> time ;
+     std::vector<double> v ;               //nt x nmax, time major
+     std::vector<double> q ;               //Running charge, same layout
+     std::vector<double> vmax , vmin , blmean , blrms ;
+     std::vector<double> th , pol , bl ;     //Per lane, for Crossing and RunningCharge
+     std::vector<double> imax , imin , pos , idx ;   //Indices, as doubles so that they go in the same vectors
+
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   Store of the simulated currents of a scan: one row of samples per (V, Y, Z) point,
+   all of them in a single block of memory. Row iv,iy,iz is ( iv*NY + iy )*NZ + iz,
+   the order in which DumpToTree writes the entries of the tree. Rows start on a cache
+   line and have room for nt samples; each one remembers how many it holds, so a row
+   filled at reduced fidelity is shorter.
+
+   Samples are kept in double precision or, to save memory on large maps, in single
+   precision. Either way they are read through a View, a light handle to one row that
+   does not copy it.
+
+   Rows are written by several threads at once, each one to its own rows. Resize must
+   not run while rows are being written, unless the shape does not change.
+
+*/
+
+#ifndef WAVEFORMSTORE_H
+#define WAVEFORMSTORE_H
+
+#include <cstddef>
+#include <vector>
+#include <valarray>
+#include <mutex>
+
+class WaveformStore {
+
+  public:
+
+     class View {
+
+       public:
+
+          View( ) : data( nullptr ) , n( 0 ) , single( false ) { } ;
+
+          View( const void * data , size_t n , bool single ) : data( data ) , n( n ) , single( single ) { } ;
+
+          double operator[ ]( size_t i ) const { return single ? (double) ( (const float *) data )[i] : ( (const double *) data )[i] ; } ;
+
+          size_t size( ) const { return n ; } ;
+
+          bool IsSingle( ) const { return single ; } ;
+
+       private:
+
+          const void * data ;
+          size_t n ;
+          bool single ;
+
+     } ;
+
+     WaveformStore( ) ;
+
+     ~WaveformStore( ) ;
+
+     void Resize( int nv , int ny , int nz , int nt , bool single = false ) ;
+
+     size_t Index( int iv , int iy , int iz ) const { return ( (size_t) iv*ny + iy )*nz + iz ; } ;
+
+     View operator[ ]( size_t row ) const ;
+
+     void Set( size_t row , const std::valarray<double> & w ) ;
+
+     //n samples taken every stride elements of w
+     void Set( size_t row , const double * w , size_t n , size_t stride = 1 ) ;
+
+     size_t GetNRows( ) const { return length.size() ; } ;
+
+     int GetNV( ) const { return nv ; } ;
+
+     int GetNY( ) const { return ny ; } ;
+
+     int GetNZ( ) const { return nz ; } ;
+
+     int GetNt( ) const { return nt ; } ;
+
+     bool IsSingle( ) const { return single ; } ;
+
+     size_t GetBytes( ) const { return length.size()*stride ; } ;
+
+  private:
+
+     WaveformStore( const WaveformStore & ) = delete ;
+     WaveformStore & operator=( const WaveformStore & ) = delete ;
+
+     char * buffer ;
+     size_t stride ;                       //Bytes from one row to the next, a multiple of the cache line
+     std::vector<size_t> length ;          //Samples held by every row
+     int nv , ny , nz , nt ;
+     bool single ;
+     std::mutex smtx ;
+
+};
+
+#endif
@@ -31,12 +31,16 @@ CarrierCollection::CarrierCollection(SMSDetector * detector) :
 /*
  * Adds carriers from the file. The name of the file must be set in the steering file, in the field CarrierFile, more instructions can be found there.
  * The calculation of average positions is neccesary for fitting purposes, DumpToTree function.
+ * With stride > 1 only one pair of carriers out of stride is kept, its charge multiplied by stride (quick, coarse simulations).
  */
 /**
  *
  * @param filename
+ * @param scanType
+ * @param depth
+ * @param stride
  */
-void CarrierCollection::add_carriers_from_file(QString filename, std::string scanType, double depth)
+void CarrierCollection::add_carriers_from_file(QString filename, std::string scanType, double depth, int stride)
 {
 	// get char representation and make ifstream
 	char * char_fn = filename.toLocal8Bit().data();
@@ -44,6 +48,8 @@ void CarrierCollection::add_carriers_from_file(QString filename, std::string sca
 	bool once = true;
 	char carrier_type;
 	double q, x_init, y_init, gen_time;
+	int iline = 0;
+	if (stride < 1) stride = 1;
 
 	// process line by line
 	std::string line;
@@ -63,8 +69,9 @@ void CarrierCollection::add_carriers_from_file(QString filename, std::string sca
 		//Calculate average beam position
 		beamy += x_init;
 		beamz += y_init + extra_y;
-		Carrier carrier(carrier_type, q, x_init, y_init + extra_y, _detector, gen_time);
+		Carrier carrier(carrier_type, q*stride, x_init, y_init + extra_y, _detector, gen_time);
 		_carrier_list_sngl.push_back(carrier);
+		iline++;
 		if ( _carrier_list_sngl.size()!=0 ) {
 			beamy = beamy / _carrier_list_sngl.size();
 			beamz = beamz / _carrier_list_sngl.size();
@@ -78,12 +85,15 @@ void CarrierCollection::add_carriers_from_file(QString filename, std::string sca
 			std::cout << "Error while reading file" << std::endl; 
 			break;
 		} 
+		//Carrier files (etct.carriers) list the carriers in consecutive pairs mirrored in y (lines 2k, 2k+1):
+		//whole pairs are kept, or an even stride would keep one side only and bias the charge and beam position
+		if (((iline++)/2) % stride != 0) continue;
 
 
 		//Calculate average beam position
 		beamy += x_init;
 		beamz += y_init + extra_y;
-		Carrier carrier(carrier_type, q, x_init, y_init + extra_y, _detector, gen_time);
+		Carrier carrier(carrier_type, q*stride, x_init, y_init + extra_y, _detector, gen_time);
 		_carrier_list_sngl.push_back(carrier);
 	}
 	if ( _carrier_list_sngl.size()!=0 ) {
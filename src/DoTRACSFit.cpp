@@ -21,6 +21,11 @@
  *
     DoTRACSFit MeasurementFile TRACS.conf "Vbias==200 && Tset == 20"
 
+ * Adding "minos" (and optionally the number of points of the chi2 scans) runs the Minos errors and
+ * chi2 scans of the free parameters after the fit, each side and scan point as a parallel job.
+
+    DoTRACSFit MeasurementFile TRACS.conf "Vbias==200 && Tset == 20" minos 21
+
  */
 
 //#include <TApplication.h>
@@ -40,7 +45,9 @@
 
 #include <TRACSFit.h>
 #include <TRACSInterface.h>
+#include <TRACSErrors.h>
 #include <TString.h>
+#include <EdgeLayout.h>
 #include <stdio.h>
 
 std::vector<TRACSInterface*> TRACSsim;
@@ -123,6 +130,9 @@ int main( int argc, char *argv[]) {
 	std::cout << "Total time: " << total_timeTaken.total_seconds() << std::endl ;
 	std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
 
+	//Minos errors and chi2 scans
+	if ((argc>5) && (std::string( argv[5] ) == "minos")) ErrorAnalysis( fnm , fit , true , min , num_threads , (argc>6) ? atoi(argv[6]) : 21 ) ;
+
 	//Release parameter 3 and 0, minimize again
 	//upar.SetValue(0, min.UserState().Value(0) ) ;
 	//upar.SetValue(3, min.UserState().Value(3) ) ;
@@ -153,6 +163,7 @@ int main( int argc, char *argv[]) {
 
 	//Dump tree to disk
 	TFile fout("output.root","RECREATE") ;
+	edgelayout::SetCompression( &fout ) ;
 	TTree *tout = new TTree("edge","Fitting results");
 
 	TMeas *emo = new TMeas( );
@@ -162,7 +173,8 @@ int main( int argc, char *argv[]) {
 	emo->Qt   = new Double_t [emo->Nt] ;
 
 	// Create branches
-	tout->Branch("raw", &emo,32000,0);
+	edgelayout::Setup( tout ) ;
+	edgelayout::Branch( tout , "raw" , &emo ) ;
 
 	//Read RAW file
 	TRACSsim[0]->DumpToTree( emo , tout ) ;
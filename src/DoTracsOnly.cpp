@@ -22,6 +22,7 @@
 #include <TRACSFit.h>
 #include <TRACSInterface.h>
 #include <TString.h>
+#include <TROOT.h>
 #include <stdio.h>
 #include "../include/Threading.h"
 
@@ -31,6 +32,8 @@ std::vector<std::thread> t;
 
 int main( int argc, char *argv[]) {
 
+	bool hetct = false;
+
 	if(argc==1){
 		num_threads = std::thread::hardware_concurrency(); // No. of threads = No. of cores
 
@@ -43,12 +46,21 @@ int main( int argc, char *argv[]) {
 		}
 	}
 
-	if(argc==3){
+	if(argc>=3){
 		num_threads = atoi(argv[1]);
 		fnm = argv[2];
 
 	}
 
+	//Options after the steering file, in any order: DoTracsOnly <threads> <steering file> [float] [hetct]
+	//float: currents kept in single precision; hetct: also export them as a .hetct file
+	for (int i = 3; i < argc; i++){
+		std::string opt = argv[i];
+		if (opt == "float") floatStore = true;
+		else if (opt == "hetct") hetct = true;
+		else std::cout << "Unknown option " << opt << ", ignored" << std::endl;
+	}
+
 
 	//else num_threads = atoi(argv[1]);
 	//if (num_threads == 0){
@@ -64,6 +76,14 @@ int main( int argc, char *argv[]) {
 	t[0].join();*/
 
 
+	//The writer thread fills the tree while the others simulate: ROOT globals per thread,
+	//and histograms kept out of the output file
+	ROOT::EnableThreadSafety();
+	TH1::AddDirectory(kFALSE);
+
+	//Currents written to the output tree while the threads run, not kept in memory
+	resultSink = new ResultSink(hetct, floatStore);
+
 	TRACSsim.resize(num_threads);
 	t.resize(num_threads);
 	for (int i = 0; i < num_threads; ++i) {
@@ -73,8 +93,14 @@ int main( int argc, char *argv[]) {
 		t[i].join();
 	}
 
-	//write output to single file!
-	TRACSsim[0]->write_to_file(0);
+	//Wait for the last rows to reach the output file
+	resultSink->Close();
+	std::cout << "Waveforms written: " << resultSink->GetNWritten() << std::endl;
+	delete resultSink;
+	resultSink = nullptr;
+
+	//Convolved currents, if asked for in the steering file, kept in vIconv by the threads
+	TRACSsim[0]->write_conv_to_file();
 
 	//Results showed for diffusion
 	int crosses = 0;
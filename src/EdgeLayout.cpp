@@ -0,0 +1,164 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************EdgeLayout***********************************
+ *
+ * A column that is switched on switches on the object branch it hangs from, or the
+ * object would not be filled: raw for volt, proc for BlineMean.
+ *
+ * With the time axis shared, time and Qt are arrays of NtS=0 elements in every entry,
+ * so their columns are there but empty.
+ *
+ */
+
+#include <EdgeLayout.h>
+
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include <TObjArray.h>
+#include <TObjString.h>
+#include <TList.h>
+
+#include <TMeas.h>
+#include <TMeasHeader.h>
+
+/**
+ *
+ * @param f
+ * @param compress
+ */
+void edgelayout::SetCompression( TFile * f , Int_t compress ) {
+
+	f->SetCompressionSettings( ( compress < 0 ) ? EDGE_COMPRESS : compress ) ;
+
+}
+
+/**
+ *
+ * @param tree
+ */
+void edgelayout::Setup( TTree * tree ) {
+
+	tree->SetAutoFlush( kAutoFlush ) ;
+
+}
+
+/**
+ *
+ * @param tree
+ * @param columns
+ * @return
+ */
+Bool_t edgelayout::Activate( TTree * tree , const char * columns ) {
+
+	TObjArray * names = TString( columns ).Tokenize( "," ) ;
+	std::vector<TBranch *> on ;
+	for ( Int_t i = 0 ; i < names->GetEntries() ; i++ ) {
+		TString name = ( (TObjString *) names->At(i) )->GetString().Strip( TString::kBoth ) ;
+		TBranch * b = tree->GetBranch( name ) ;
+		if ( b == nullptr || b->GetMother() == b ) {          //Unknown, or a whole object
+			delete names ;
+			return kFALSE ;
+		}
+		on.push_back( b ) ;
+	}
+	delete names ;
+
+	tree->SetBranchStatus( "*" , 0 ) ;
+	for ( size_t i = 0 ; i < on.size() ; i++ ) {
+		tree->SetBranchStatus( on[i]->GetMother()->GetName() , 1 ) ;
+		tree->SetBranchStatus( on[i]->GetName() , 1 ) ;
+	}
+	return kTRUE ;
+
+}
+
+/**
+ *
+ * @param tree
+ */
+void edgelayout::ActivateAll( TTree * tree ) {
+
+	tree->SetBranchStatus( "*" , 1 ) ;
+
+}
+
+/**
+ *
+ * @param tree
+ * @param em
+ * @return
+ */
+Int_t edgelayout::Fill( TTree * tree , TMeas * em ) {
+
+	em->NtS = ( EDGE_SHARED_T == 1 ) ? 0 : em->Nt ;
+	return tree->Fill() ;
+
+}
+
+/**
+ *
+ * @param tree
+ * @param emh
+ */
+void edgelayout::AddHeader( TTree * tree , TMeasHeader * emh ) {
+
+	emh->SharedT = EDGE_SHARED_T ;
+	tree->GetUserInfo()->Add( emh ) ;
+
+}
+
+/**
+ *
+ * @param tree
+ * @return
+ */
+TString edgelayout::TimeColumns( TTree * tree ) {
+
+	if ( tree->GetBranch( "NtS" ) == 0 ) return "Nt,time" ;          //Written before NtS
+	TMeasHeader * emh = (TMeasHeader *) tree->GetUserInfo()->At(0) ;
+	if ( emh != 0 && emh->SharedT == 1 ) return "Nt,NtS" ;
+	return "Nt,NtS,time" ;
+
+}
+
+/*
+ * Only the whole name time is replaced: time0, ltime or raw.time are other columns
+ */
+/**
+ *
+ * @param formula
+ * @param shared
+ * @param At
+ * @param T0
+ * @return
+ */
+TString edgelayout::TimeFormula( TString formula , Bool_t shared , Double_t At , Double_t T0 ) {
+
+	if ( !shared ) return formula ;
+
+	std::string f( formula.Data() ) , out ;
+	std::string axis( Form( "(%.10g+Iteration$*%.10g)" , T0 , At ) ) ;
+	size_t i = 0 , j ;
+	while ( ( j = f.find( "time" , i ) ) != std::string::npos ) {
+		bool head = ( j == 0 ) || !( isalnum( f[j-1] ) || f[j-1] == '_' || f[j-1] == '.' ) ;
+		bool tail = ( j+4 == f.size() ) || !( isalnum( f[j+4] ) || f[j+4] == '_' ) ;
+		out += f.substr( i , j-i ) + ( ( head && tail ) ? axis : std::string( "time" ) ) ;
+		i = j+4 ;
+	}
+	out += f.substr( i ) ;
+	return TString( out.c_str() ) ;
+
+}
@@ -0,0 +1,243 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************EdgePipeline***********************************
+ *
+ * Events go round: idle -> (Push) work -> (workers) done -> (writer) idle. Each event
+ * keeps its number, so the writer takes them from done in the order of Push.
+ *
+ */
+
+#include "EdgePipeline.h"
+#include "EdgeLayout.h"
+
+#include <iostream>
+#include <algorithm>
+
+#include "TMath.h"
+
+/**
+ *
+ * @param tree
+ * @param em
+ * @param nworkers
+ */
+EdgePipeline::EdgePipeline( TTree * tree , TMeas * em , int nworkers ) : tree( tree ) , wv( nullptr ) , nin( 0 ) , nout( 0 ) , closing( false ) {
+
+	//Leave a core for the parser and one for the writer
+	if ( nworkers <= 0 ) nworkers = std::max( 1 , (int) std::thread::hardware_concurrency() - 2 ) ;
+
+	//All the events with arrays as large as those of em
+	Int_t nt = em->Nt ;
+	size_t nevents = 4*nworkers + 4 ;
+	events.resize( nevents + 1 ) ;
+	for ( size_t i = 0 ; i < events.size() ; i++ ) {
+		events[i] = new TMeas( ) ;
+		events[i]->volt = new Double_t [nt] ;
+		events[i]->time = new Double_t [nt] ;
+		events[i]->Qt   = new Double_t [nt] ;
+	}
+	out = events[nevents] ;
+	idle.assign( events.begin() , events.begin() + nevents ) ;
+
+	tree->SetBranchAddress( "raw" , &out ) ;
+
+	for ( int i = 0 ; i < nworkers ; i++ ) workers.push_back( std::thread( &EdgePipeline::Worker , this ) ) ;
+	writer = std::thread( &EdgePipeline::Writer , this ) ;
+
+}
+
+EdgePipeline::~EdgePipeline( ) {
+
+	Close( ) ;
+	for ( size_t i = 0 ; i < events.size() ; i++ ) delete events[i] ;
+
+}
+
+/*
+ * to takes all that from has, arrays included; from is left with the arrays of to
+ */
+/**
+ *
+ * @param to
+ * @param from
+ */
+void EdgePipeline::Swap( TMeas * to , TMeas * from ) {
+
+	Double_t * volt = to->volt , * time = to->time , * Qt = to->Qt ;
+	*to = *from ;
+	from->volt = volt ; from->time = time ; from->Qt = Qt ;
+
+}
+
+/**
+ *
+ * @param em
+ * @param LPower
+ * @param LNph
+ */
+void EdgePipeline::Push( TMeas * em , Double_t LPower , Double_t LNph ) {
+
+	std::unique_lock<std::mutex> lock( qmtx ) ;
+	cvidle.wait( lock , [this]{ return !idle.empty() ; } ) ;
+	TMeas * ev = idle.back() ;
+	idle.pop_back() ;
+	lock.unlock() ;
+
+	Swap( ev , em ) ;
+	Record r = { ev , nullptr , LPower , LNph } ;
+
+	lock.lock() ;
+	work.push_back( std::make_pair( nin++ , r ) ) ;
+	lock.unlock() ;
+	cvwork.notify_one() ;
+
+}
+
+void EdgePipeline::Worker( ) {
+
+	std::vector< std::pair<Long64_t,Record> > jobs ;
+	WaveformBatch * batch = nullptr ;
+
+	for ( ;; ) {
+
+		std::unique_lock<std::mutex> lock( qmtx ) ;
+		cvwork.wait( lock , [this]{ return closing || !work.empty() ; } ) ;
+		if ( work.empty() ) break ;
+		jobs.clear() ;
+		while ( !work.empty() && (int) jobs.size() < kBlock ) {
+			jobs.push_back( work.front() ) ;
+			work.pop_front() ;
+		}
+		lock.unlock() ;
+
+		Process( jobs , batch ) ;
+
+		lock.lock() ;
+		for ( size_t j = 0 ; j < jobs.size() ; j++ ) done[jobs[j].first] = jobs[j].second ;
+		lock.unlock() ;
+		cvdone.notify_one() ;
+
+	}
+
+	delete batch ;
+
+}
+
+/*
+ * Now postprocess these entries (find out baseline, rtime and so on). Those with the time
+ * axis and setup of the first go through the batch, any other one on its own
+ */
+/**
+ *
+ * @param jobs
+ * @param batch
+ */
+void EdgePipeline::Process( std::vector< std::pair<Long64_t,Record> > & jobs , WaveformBatch *& batch ) {
+
+	TMeas * first = jobs[0].second.ev ;
+	if ( batch == nullptr || !batch->SameAxis( first->Nt , first->time ) ) {
+		delete batch ;
+		batch = new WaveformBatch( first->Nt , first->time , kBlock ) ;
+	}
+	batch->Clear() ;
+
+	int lane[kBlock] ;
+	for ( size_t j = 0 ; j < jobs.size() ; j++ ) {
+		TMeas * ev = jobs[j].second.ev ;
+		bool same = ( ev->Setup == first->Setup ) && batch->SameAxis( ev->Nt , ev->time ) ;
+		lane[j] = same ? batch->Add( ev->volt ) : -1 ;
+	}
+	batch->Extrema( ) ;
+	if ( first->Nt > 1 ) batch->Baseline( TMath::Nint( TWaveform::GetT4BL( first->Setup )/( first->time[1]-first->time[0] ) ) ) ;
+
+	Double_t bline[kBlock] , rtl[kBlock] , rtr[kBlock] ;
+	int pol[kBlock] , irtl[kBlock] , irtr[kBlock] ;
+	for ( size_t j = 0 ; j < jobs.size() ; j++ ) {
+		Record & r = jobs[j].second ;
+		r.wv = new TWaveform( r.ev , kTRUE ) ;
+		int w = lane[j] ;
+		if ( w < 0 ) r.wv->Evaluate( r.ev ) ;
+		else {
+			r.wv->SetExtrema( batch->GetiVmax( w ) , batch->GetiVmin( w ) , batch->GetBlineMean( w ) ) ;
+			bline[w] = r.wv->BlineGetMean( ) ;
+			pol[w]   = r.wv->GetPolarity( ) ;
+		}
+		if ( r.LPower != 0. ) {
+			r.wv->LPower = r.LPower ;
+			r.wv->LNph   = r.LNph ;
+		}
+	}
+	if ( batch->GetN() == 0 ) return ;
+
+	//Rise time as TWaveform::CalcRiseTime, charges, and the running charge into Qt
+	batch->Crossing( 1.0-RTIME , bline , pol , true , rtl , irtl ) ;
+	batch->Crossing( RTIME     , bline , pol , true , rtr , irtr ) ;
+	batch->RunningCharge( bline ) ;
+	for ( size_t j = 0 ; j < jobs.size() ; j++ ) {
+		int w = lane[j] ;
+		if ( w < 0 ) continue ;
+		Record & r = jobs[j].second ;
+		r.wv->SetRiseTime( rtr[w]-rtl[w] ) ;
+		r.wv->Evaluate( ) ;
+		batch->GetRunningCharge( w , r.ev->Qt ) ;
+	}
+
+}
+
+void EdgePipeline::Writer( ) {
+
+	for ( ;; ) {
+
+		std::unique_lock<std::mutex> lock( qmtx ) ;
+		cvdone.wait( lock , [this]{ return done.count( nout ) || ( closing && nout == nin ) ; } ) ;
+		std::map<Long64_t,Record>::iterator it = done.find( nout ) ;
+		if ( it == done.end() ) return ;
+		Record r = it->second ;
+		done.erase( it ) ;
+		lock.unlock() ;
+
+		Swap( out , r.ev ) ;
+		wv = r.wv ;
+		if ( nout == 0 ) edgelayout::Branch( tree , "proc" , &wv ) ;
+		edgelayout::Fill( tree , out ) ;
+		delete wv ;
+		wv = nullptr ;
+
+		lock.lock() ;
+		idle.push_back( r.ev ) ;
+		nout++ ;
+		lock.unlock() ;
+		cvidle.notify_one() ;
+
+	}
+
+}
+
+void EdgePipeline::Close( ) {
+
+	if ( !writer.joinable() ) return ;
+
+	{
+		std::lock_guard<std::mutex> lock( qmtx ) ;
+		closing = true ;
+	}
+	cvwork.notify_all() ;
+	cvdone.notify_all() ;
+	for ( size_t i = 0 ; i < workers.size() ; i++ ) workers[i].join() ;
+	writer.join() ;
+
+	//Our objects are about to go
+	tree->ResetBranchAddresses() ;
+
+}
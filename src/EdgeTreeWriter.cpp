@@ -0,0 +1,145 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************EdgeTreeWriter***********************************
+ *
+ * Same entries as parse_TRACS fills from a .hetct file, filled from the rows in
+ * memory: T in C, positions in mm, time in ns.
+ *
+ */
+
+#include <EdgeTreeWriter.h>
+
+#include <iostream>
+#include <TMath.h>
+
+/**
+ *
+ * @param filename
+ * @param emh
+ * @param compress
+ * @param bufsize
+ * @param autoflush
+ */
+EdgeTreeWriter::EdgeTreeWriter( std::string filename , TMeasHeader * emh , Int_t compress , Int_t bufsize , Long64_t autoflush ) :
+	emh( emh ) , bufsize( bufsize ) , ntmax( 0 ) , nfill( 0 ) , Polarity( 0 ) , x0( 0. ) , y0( 0. ) , z0( 0. ) {
+
+	file = new TFile( filename.c_str() , "RECREATE" , "TRACS simulated scan" , ( compress < 0 ) ? EDGE_COMPRESS : compress ) ;
+	if ( file == nullptr || file->IsZombie() ) {
+		std::cout << "Error opening " << filename << std::endl ;
+		std::cout << "Exiting!" << std::endl ;
+		exit(-1) ;
+	}
+	std::cout << "Output file: " << filename << std::endl ;
+
+	file->cd() ;
+	tree = new TTree( "edge" , "eTCT measurement" ) ;
+	tree->SetAutoFlush( autoflush ) ;
+
+	em = new TMeas( ) ;
+	em->Setup = 5 ;
+	em->NV = emh->NV ;
+	em->Nx = emh->Nx ; em->Ny = emh->Ny ; em->Nz = emh->Nz ;
+	em->Ax = emh->Ax ; em->Ay = emh->Ay ; em->Az = emh->Az ;
+	em->At = emh->At ;
+	wv = nullptr ;
+
+	tree->Branch( "raw" , &em , bufsize , edgelayout::kSplit ) ;
+
+}
+
+EdgeTreeWriter::~EdgeTreeWriter( ) {
+
+	Close( ) ;
+	delete em ;
+
+}
+
+/**
+ *
+ * @param rows
+ */
+void EdgeTreeWriter::Write( const std::vector<HetctWriter::Row> & rows ) {
+
+	for ( size_t i = 0 ; i < rows.size() ; i++ ) Fill( rows[i] ) ;
+
+}
+
+/**
+ *
+ * @param row
+ */
+void EdgeTreeWriter::Fill( const HetctWriter::Row & row ) {
+
+	Int_t nt = row.wave.size() ;
+	if ( nt > ntmax ) {
+		delete [] em->volt ; delete [] em->time ; delete [] em->Qt ;
+		em->volt = new Double_t [nt] ;
+		em->time = new Double_t [nt] ;
+		em->Qt   = new Double_t [nt] ;
+		ntmax = nt ;
+	}
+	em->Nt = nt ;
+
+	em->Temp  = row.temp - 273. ;
+	em->Vbias = row.voltage ;
+	em->x = 0. ;
+	em->y = row.yShift/1000. ;
+	em->z = row.height/1000. ;
+
+	//Calculate the bin slice along each coordinate (steps in um)
+	if ( nfill == 0 ) { x0 = em->x ; y0 = em->y ; z0 = em->z ; }
+	em->ix = ( em->Ax!=0. )? 1 + TMath::Nint( 1000.*( em->x - x0 )/em->Ax ) : 1 ;
+	em->iy = ( em->Ay!=0. )? 1 + TMath::Nint( 1000.*( em->y - y0 )/em->Ay ) : 1 ;
+	em->iz = ( em->Az!=0. )? 1 + TMath::Nint( 1000.*( em->z - z0 )/em->Az ) : 1 ;
+
+	for ( int i = 0 ; i < nt ; i++ ) {
+		em->volt[i] = row.wave[i] ;
+		em->time[i] = i*em->At ;
+	}
+
+	//Estimate polarity
+	if ( TMath::Abs( TMath::MaxElement( nt , em->volt ) ) > TMath::Abs( TMath::MinElement( nt , em->volt ) ) ) Polarity++ ;
+	else Polarity-- ;
+
+	em->event = nfill ;
+
+	//Now postprocess this entry (find out baseline, rtime and so on)
+	wv = new TWaveform( em , kTRUE ) ;
+	wv->Evaluate( em ) ;
+	if ( nfill == 0 ) tree->Branch( "proc" , &wv , bufsize , edgelayout::kSplit ) ;
+
+	edgelayout::Fill( tree , em ) ;
+	nfill++ ;
+	delete wv ;
+	wv = nullptr ;
+
+}
+
+void EdgeTreeWriter::Close( ) {
+
+	if ( file == nullptr ) return ;
+
+	emh->Polarity = ( Polarity>1 ) ? 1 : -1 ;
+	edgelayout::AddHeader( tree , emh ) ;
+	em->Ntevent = nfill ;
+
+	file->cd() ;
+	tree->Write( "" , TObject::kOverwrite ) ;
+	file->Close() ;
+	delete file ;          //Takes the tree and the header with it
+	file = nullptr ;
+	tree = nullptr ;
+	std::cout << "Entries written to the tree: " << nfill << std::endl ;
+
+}
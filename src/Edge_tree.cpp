@@ -47,6 +47,9 @@
 #include "TMeas.h"
 #include "TMeasHeader.h"
 #include "TWaveform.h"
+#include "MappedFile.h"
+#include "EdgePipeline.h"
+#include "EdgeLayout.h"
 
 #include <cstdarg>
 #include <iostream>
@@ -58,6 +61,7 @@
 #include "TTree.h"
 #include "TMath.h"
 #include "TH1.h"
+#include "TROOT.h"
 
 #include <algorithm> //For the count method
 
@@ -99,14 +103,15 @@ ClassImp(TWaveform)
 
 // P R O T O T Y P I N G .....
 
-int       parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend  ) ;
-int    parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend  ) ;
+int       parse_file( const char *filename, MappedFile &text , TMeas *em , TTree *tree , Double_t Cend  ) ;
+int    parse_tctplus( MappedFile &text , TMeas *em , TTree *tree , Double_t Cend  ) ;
 int        parse_TPA( const char *filename, TMeas *em , TTree *tree , Double_t Cend  ) ;
 int     parse_tctUHH( const char *filename, TMeas *em , TTree *tree , Double_t Cend  ) ;
 int       parse_ifca( const char *filename, TMeas *em , TTree *tree , Double_t Cend  ) ;
-int       parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend  ) ;
+int       parse_TRACS( MappedFile &text , TMeas *em , TTree *tree , Double_t Cend  ) ;
 int       parse_IDLTS( const char *filename, TMeas *em , TTree *tree , Double_t Cend  ) ;
-int    ReadNerOfBins( const char *filename ) ;
+int    ReadNerOfBins( MappedFile &text ) ;
+static bool   ReadDate( MappedFile &text , string &what , UShort_t &dd , UShort_t &mm , UShort_t &yy , UShort_t &hh , UShort_t &mn , UShort_t &ss ) ;
 
 //rootcint mytest_dictionary.cxx -c mytest.h LinkDef.h
 
@@ -154,25 +159,40 @@ int tree( int argc ,  ... ) {
   cout<<"Output file: " << fnm.c_str() << endl ;
   
   
+  //TWaveforms built by several threads and baskets compressed in parallel (EdgePipeline).
+  //Their histograms are kept out of the file, they go with them
+  ROOT::EnableThreadSafety() ;
+  ROOT::EnableImplicitMT() ;
+  TH1::AddDirectory(kFALSE) ;
+
   //create a Tree file tree4.root
   TFile froot( fnm.c_str() , "RECREATE" );
+  edgelayout::SetCompression( &froot ) ;
 
-  // Create a ROOT Tree
+  // Create a ROOT Tree, split in columns (see EdgeLayout.h)
   TTree *tree = new TTree("edge","eTCT measurement");
+  edgelayout::Setup( tree ) ;
+
+  //Map the measurement file, read once from start to end
+  MappedFile text( pfnm ) ;
+  if ( !text.IsOpen() ) {
+    cout << "Error opening " << pfnm << endl ;
+    exit(1);
+  }
 
   // Create a pointer to an raw data object
   TMeas *em = new TMeas( );
-  em->Nt=ReadNerOfBins( pfnm ) ;
+  em->Nt=ReadNerOfBins( text ) ;
 
   em->volt = new Double_t [em->Nt] ;
   em->time = new Double_t [em->Nt] ;
   em->Qt   = new Double_t [em->Nt] ;
 
   // Create branches
-  tree->Branch("raw", &em,32000,1);
+  edgelayout::Branch( tree , "raw" , &em ) ;
 
   //Read RAW file
-  parse_file( pfnm , em , tree , Cend ) ;
+  parse_file( pfnm , text , em , tree , Cend ) ;
 
   // Write the file header
   froot.Write();
@@ -186,25 +206,33 @@ int tree( int argc ,  ... ) {
   
   return 0;
   
+}
+/*----------------------------------------------------------*/
+/*
+ * Header of an eTCT event, "DATA-START-1 15.06.2015 19:25:03". False at the end of the data
+ */
+static bool ReadDate( MappedFile &text , string &what , UShort_t &dd , UShort_t &mm , UShort_t &yy , UShort_t &hh , UShort_t &mn , UShort_t &ss ) {
+
+    char c ;
+    return text.Word( what ) && text.Next( dd ) && text.Char( c ) && text.Next( mm ) && text.Char( c ) && text.Next( yy ) &&
+           text.Next( hh ) && text.Char( c ) && text.Next( mn ) && text.Char( c ) && text.Next( ss ) ;
+
 }
 /*----------------------------------------------------------*/
 /**
  *
  * @param filename
+ * @param text
  * @param em
  * @param tree
  * @param Cend
  * @return
  */
-int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend ) {
+int parse_file( const char *filename, MappedFile &text , TMeas *em , TTree *tree , Double_t Cend ) {
 
 
-    //Open file
-    ifstream in( filename );
-    if (!in || in.bad()) {
-      cout << "Error opening " << filename << endl ;
-      return(0);
-    }
+    //File already mapped
+    text.Rewind() ;
     
     cout << "Creating tree for " << filename << endl ;
     
@@ -213,22 +241,21 @@ int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     string what , sval , unit , line ;
     
     
-    getline(in,line) ; if (DEBUG) cout << line.c_str() <<endl ; //Skip line
+    text.GetLine(line) ; if (DEBUG) cout << line.c_str() <<endl ; //Skip line
     if ( line.find("================") == 0 ) {
-      getline(in,line);
+      text.GetLine(line);
       if ( line.find("SSD simulation") == 0 ) {      
-	in.close() ;
+	text.Rewind() ;
 	em->Setup = 5;
-	parse_TRACS( filename , em , tree , Cend ) ; 
+	parse_TRACS( text , em , tree , Cend ) ; 
 	return(1) ;
      } else if ( line.find("SSD measurement") == 0 ) { 
-        for (Int_t i=0;i<3;i++)getline(in,line) ; 
+        for (Int_t i=0;i<3;i++)text.GetLine(line) ; 
 	if ( line.find("scanType: TCT+") == 0 ) {
-	  in.close() ;
+	  text.Rewind() ;
 	  em->Setup = 2;
-	  parse_tctplus( filename , em , tree , Cend ) ; 
+	  parse_tctplus( text , em , tree , Cend ) ; 
 	} else if ( line.find("scanType: DLTS") == 0 ) {
-	  in.close() ;
 	  em->Setup = 6;
 	  parse_IDLTS( filename , em , tree , Cend ) ; 
         }
@@ -236,19 +263,16 @@ int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
       }
     }
     if ( line.find("----------------") == 0 ) {
-      in.close() ;
       em->Setup = 3;
       parse_TPA( filename , em , tree , Cend ) ; 
       return(1) ;
     }
     if ( line.find("MTCT Header") == 0 ) {
-      in.close() ;
       em->Setup = 3;
       parse_tctUHH( filename , em , tree , Cend ) ; 
       return(1) ;
     }
     if ( line.find("* t0      :") == 0 ) {
-      in.close() ;
       em->Setup = 4;
       parse_ifca( filename , em , tree , Cend ) ; 
       return(1) ;
@@ -257,12 +281,12 @@ int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     //This is eTCT type of file
     em->Setup = 1;
     
-    getline(in,line) ; if (DEBUG) cout << line.c_str() <<endl ; //Skip line
-    getline(in,line) ; if (DEBUG) cout << line.c_str() <<endl ; //Skip line
+    text.GetLine(line) ; if (DEBUG) cout << line.c_str() <<endl ; //Skip line
+    text.GetLine(line) ; if (DEBUG) cout << line.c_str() <<endl ; //Skip line
 
 
     // NVoltages:      1
-    in >> what >> em->NV ;  
+    text.Word( what ) ; text.Next( em->NV ) ;  
     em->NV = ( em->NV==0 ) ? 1 : em->NV ;  //Lvb bug
     if (DEBUG) cout << what.c_str() << em->NV <<endl ;
 
@@ -275,35 +299,35 @@ int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     emh->Cend = Cend ;
     
     // NXpos:  0
-    in  >> what >> em->Nx ; 
+    text.Word( what ) ; text.Next( em->Nx ) ; 
     if (DEBUG) cout<<what.c_str() << em->Nx <<endl ;
     emh->Nx = em->Nx;
     
     // X0:     -1.700000E+1 mm
-    in >> what >> sval >> unit  ;  //Skip line
+    text.Word( what ) ; text.Word( sval ) ; text.Word( unit ) ;  //Skip line
   
     // dX:     0.000000E+0 mm
-    in  >> what >> em->Ax >> unit;  
+    text.Word( what ) ; text.Next( em->Ax ) ; text.Word( unit ) ;  
     if (DEBUG) cout << what.c_str() << em->Ax <<endl ; 
     em->Ax=em->Ax*1000. ;
     emh->Ax = em->Ax;
     
     // NYpos:  0
-    in  >> what >> em->Ny ;  
+    text.Word( what ) ; text.Next( em->Ny ) ;  
     if (DEBUG) cout << what.c_str()<< em->Ny <<endl ;
     emh->Ny = em->Ny;
     
     // Y0:     -7.300000E+0 mm
-    in >> what >> sval >> unit  ;  //Skip line
+    text.Word( what ) ; text.Word( sval ) ; text.Word( unit ) ;  //Skip line
     
     // dY:     0.000000E+0 mm
-    in  >> what >> em->Ay >> unit;  
+    text.Word( what ) ; text.Next( em->Ay ) ; text.Word( unit ) ;  
     em->Ay=em->Ay*1000. ;
     if (DEBUG) cout<<what.c_str() << em->Ay <<endl ;
     emh->Ay = em->Ay;
 
     // NZpos:  401
-    in  >> what >> em->Nz;
+    text.Word( what ) ; text.Next( em->Nz ) ;
     if (DEBUG) cout << what.c_str() << em->Nz<<endl ;
     #if SKIPLINES!=0
       Int_t Nzorig = em->Nz ;
@@ -313,10 +337,10 @@ int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     emh->Nz = em->Nz;
     
     // Z0:     7.830000E+0 mm
-    in >> what >> sval >> unit  ;  //Skip line
+    text.Word( what ) ; text.Word( sval ) ; text.Word( unit ) ;  //Skip line
 
     // dZ:     2.000000E-3 mm
-    in  >> what >> em->Az >> unit;  
+    text.Word( what ) ; text.Next( em->Az ) ; text.Word( unit ) ;  
       em->Az = em->Az*1000. ;
     #if SKIPLINES!=0
       em->Az = (SKIPLINES+1.0)*em->Az ;         //Already in mum
@@ -326,39 +350,40 @@ int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     
     
     // NTimePoints:    10003
-    in  >> what >> em->Nt;	     //14 NTimePoints:  10003
+    text.Word( what ) ; text.Next( em->Nt ) ;	     //14 NTimePoints:  10003
     if (DEBUG) cout << what.c_str() << em->Nt<<endl ;
 
     // t0:     -1.611310E-8 s
-    in >> what >> sval >> unit  ;  //Skip line
+    text.Word( what ) ; text.Word( sval ) ; text.Word( unit ) ;  //Skip line
 
     // dt:     5.000000E-11 s
-    in  >> what >> em->At >> unit;  //16 dt:	5.000000E-11 s
+    text.Word( what ) ; text.Next( em->At ) ; text.Word( unit ) ;  //16 dt:	5.000000E-11 s
     em->At=em->At*1.e9 ;
     if (DEBUG) cout << what.c_str() << em->At<<endl ;
     emh->At = em->At ;
 
     //Comment
     string comm ;
-    in.ignore(); getline(in,comm)  ;  //Skip line
+    text.SkipLine(); text.GetLine(comm)  ;  //Skip line
     if (DEBUG) cout << comm << endl ;
     emh->comment=comm ;
         
     //HEADER-END
     string hend ;
-    getline(in,hend) ;
+    text.GetLine(hend) ;
     if (DEBUG) cout << hend << endl  ;  //Skip line
      
     UShort_t  dd, mm, yy , hh , mn, ss;
     TDatime date ;
 
-    char   c ;
+    char   c = '.' ;
     int    iRead=0 , iactual = 1 ;
     int    ivb= 0 , Polarity = 0 ;
     Double_t VbiasOld=-999999.9 ;
     Double_t x0 , y0 , z0 ;
-    in >> what >> dd >> c>> mm >> c >> yy>> hh >> c >> mn >>c >> ss ;
-    while (!in.eof() && !in.bad()) {
+    EdgePipeline pipe( tree , em ) ;
+    bool more = ReadDate( text , what , dd , mm , yy , hh , mn , ss ) ;
+    while ( more ) {
       
       //Date
       if (DEBUG) cout <<what<<" "<<dd<<c<< mm<<c<< yy<<" "<< hh<<c << mn<<c << ss ;
@@ -366,7 +391,7 @@ int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
       em->utc = date ;
       
       //Itot , Vbias , X,Y,Z
-      in >> em->Itot >> em->Vbias >> em->x >> em->y >> em->z  ;
+      text.Next( em->Itot ) ; text.Next( em->Vbias ) ; text.Next( em->x ) ; text.Next( em->y ) ; text.Next( em->z ) ;
       if (DEBUG) cout<<" " << em->Itot<<" " << em->Vbias<<" " << em->x<<" " << em->y<<" " << em->z  ;
             
       //Calculate the bin slice along each coordinate
@@ -383,7 +408,7 @@ int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
       
       //All Voltages
        for ( int i=0 ; i< em->Nt ; i++) {
-        in >> em->volt[i] ;
+        text.Next( em->volt[i] ) ;
         em->time[i]=i*em->At ; 
       }
       
@@ -421,47 +446,40 @@ int parse_file( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
       else Polarity-- ;
 
       //DATA-END-x
-      in >> what ;
+      text.Word( what ) ;
       if (DEBUG) cout <<" " << what<<endl ;
 
       em->event=iRead ;
       
-      //Now postprocess this entry (find out baseline, rtime and so on
-      TWaveform *wv = new TWaveform( em ) ;
-	
-      if (iRead==0) tree->Branch("proc" , &wv , 32000 , 1 );
-       
-      tree->Fill() ;
+      //Postprocessed (baseline, rtime and so on) and filled by the pipeline
+      pipe.Push( em ) ;
       iRead++   ;
-      //if (iRead%1000 == 0) tree->AutoSave();
 
       if (iRead%100==0) cout << "Read " << iRead << flush <<"\r" ;
-      delete wv ; 
 
       //Get the header of the event, or give an error, so the while will now stop
-      in >> what >> dd >> c>> mm >> c >> yy>> hh >> c >> mn >>c >> ss ;
+      more = ReadDate( text , what , dd , mm , yy , hh , mn , ss ) ;
       iactual++ ;
       
       //Check if we want to read 1 out of SKIPLINES
       #if SKIPLINES!=0
 	for (Int_t iskip=0 ; iskip<SKIPLINES ; iskip++ ) { 
           if ( iactual % Nzorig != 1 ) {   //We do not want to skip the first line of each Vbias scan
-	    in.ignore(); getline(in,line);  //Skip one line, then read header again
+	    text.SkipLine();  //Skip one line, then read header again
 	    //cout << "Skipping line "<< iactual << " ," <<hh << ":" << mn <<":"<< ss << endl;
-	    in >> what >> dd >> c>> mm >> c >> yy>> hh >> c >> mn >>c >> ss ;
+	    more = ReadDate( text , what , dd , mm , yy , hh , mn , ss ) ;
             iactual++ ;
           } 
 	}
       #endif
     } 
     
+    pipe.Close() ;
     emh->Polarity = (Polarity>1) ? 1 : -1 ;
-    tree->GetUserInfo()->Add( emh ) ;
+    edgelayout::AddHeader( tree , emh ) ;
     cout << endl ;
     cout << "Total read:" << iRead << endl ;
     em->Ntevent=iRead ; //It does not go into the tree, only in the class!
-    
-    in.close() ;
         
     //delete emh ;
     
@@ -700,10 +718,11 @@ int parse_ifca( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
       em->event=iRead ;
             
       //Now postprocess this entry (find out baseline, rtime and so on
-      TWaveform *wv = new TWaveform( em ) ;
-      if (iRead==0) tree->Branch("proc" , &wv , 32000 , 1 );
+      TWaveform *wv = new TWaveform( em , kTRUE ) ;
+      wv->Evaluate( em ) ;
+      if (iRead==0) edgelayout::Branch( tree , "proc" , &wv ) ;
       
-      tree->Fill() ;
+      edgelayout::Fill( tree , em ) ;
       iRead++ ;
       
       //Estimate polarity
@@ -720,7 +739,7 @@ int parse_ifca( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     }
         
     emh->Polarity = (Polarity>1) ? 1 : -1 ;
-    tree->GetUserInfo()->Add( emh ) ;
+    edgelayout::AddHeader( tree , emh ) ;
     cout << endl ;
     cout << "Total read:" << iRead << endl ;
     em->Ntevent=iRead ; //It does not go into the tree, only in the class!
@@ -746,20 +765,19 @@ int parse_ifca( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
 /*----------------------------------------------------------*/
 /**
  *
- * @param filename
+ * @param text
  * @param em
  * @param tree
  * @param Cend
  * @return
  */
-int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend ) {
+int parse_tctplus( MappedFile &text , TMeas *em , TTree *tree , Double_t Cend ) {
     
     //Note that there is a difference in the coordinates. He calls X to my Y.
-    //Open file
-    ifstream in( filename );    
+    //File already mapped, from its start
 
     string line, what ;
-    for (Int_t iloop = 1 ; iloop<= 3 ; iloop ++ ) getline(in, line);
+    for (Int_t iloop = 1 ; iloop<= 3 ; iloop ++ ) text.GetLine(line);
     stringstream myStream(line);
     Double_t version ; myStream >> what >> version ;
 
@@ -769,7 +787,7 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     
     //StartTime
     Int_t istart=4 , iend = 6 ;
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line);
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line);
     TString sdate = TString( line ) ;
     UShort_t  dd, mm, yy , hh , mn, ss;
     yy=atoi( sdate(11,4).Data() );
@@ -785,13 +803,13 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     //comment
     istart=iend+1; //7
     iend=istart+1; //8
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line);
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line);
     TString comment = TString( line ) ;
     
     //Wavelength
     istart=iend+1; //9
     iend=istart+1; //10
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); 
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     Double_t wvlength ; myStream >> what >>  wvlength ;
     
@@ -800,7 +818,7 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     Int_t Illum ;
     istart=iend+1; //11
     iend=istart;   //11
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); 
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     string direction ; myStream >> what >>  direction ;
     if ( direction.find("top")    ==0 ) Illum=1;
@@ -809,48 +827,48 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     
     //Amp gain
     Double_t Gain ;
-    getline(in, line);  
+    text.GetLine(line);  
     myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> Gain ;
 
 
     //Fluence and annealing
     Double_t Phi =0., iann =0. ;
-    if (version <=1.2 ) getline(in, line); //read and discard biasteeresistance
+    if (version <=1.2 ) text.GetLine(line); //read and discard biasteeresistance
     if (version ==1.3 ) {
-      getline(in, line); //read and discard biasteeresistance
+      text.GetLine(line); //read and discard biasteeresistance
       
       //Fluence
-      getline(in, line); 
+      text.GetLine(line); 
       myStream.str(""); myStream.clear() ; myStream << line ;
       myStream >> what >> Phi ;
       
       //Annealing
-      getline(in, line); 
+      text.GetLine(line); 
       myStream.str(""); myStream.clear() ; myStream << line ;
       myStream >> what >> iann ;
       
     }
     
     //Frequency
-    getline(in, line); 
+    text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     Int_t Freq ; myStream >> what >> Freq ;
     
     //Number of averages
-    getline(in, line); 
+    text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     Int_t Nav ; myStream >> what >> Nav ;
     
     //Total number of Scans
-    getline(in, line); 
+    text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     Int_t NumOfScans ; myStream >> what >> NumOfScans ;
     
     
     // NVoltages
     Int_t Ival , t0s , tms ;
-    for (Int_t iloop = 1 ; iloop<= 9 ; iloop ++ ) getline(in, line); 
+    for (Int_t iloop = 1 ; iloop<= 9 ; iloop ++ ) text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what ; myStream >> Ival ;
     em->NV = Ival ; 
@@ -872,15 +890,15 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     emh->Cend = Cend ;
     
     //Vbias vector
-    getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what ; for ( int i=0 ; i< em->NV ; i++) myStream >> emh->vVbias[i] ;
     
     //Nominal power
     Int_t nPower ; Double_t Power ;
-    for (Int_t iloop = 1 ; iloop<= 4 ; iloop ++ ) getline(in, line); 
+    for (Int_t iloop = 1 ; iloop<= 4 ; iloop ++ ) text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what ; myStream >> nPower ;
-    getline(in, line); 
+    text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what ; myStream >> Power ;
     emh->Power = Power ;
@@ -890,7 +908,7 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     istart = 1; 
     iend   = istart+8; 
     Double_t Dval ;
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> Dval ;
     em->Ax  = Dval *1000. ; 
     emh->Ax = em->Ax;
@@ -898,14 +916,14 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     //Nx
     istart = iend+1; 
     iend   = istart; 
-    getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> em->Nx ; 
     emh->Nx = em->Nx;
 
     //Ay
     istart = iend+1; 
     iend   = istart+3; 
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream>> what  >> Dval ;
     em->Ay  = Dval *1000. ; 
     emh->Ay = em->Ay;
@@ -913,14 +931,14 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     //Ny
     istart = iend+1; 
     iend   = istart; 
-    getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> em->Ny ; 
     emh->Ny = em->Ny;
 
     //Az
     istart = iend+1; 
     iend   = istart+3; 
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream>> what  >> Dval ;
     em->Az  = Dval *1000. ; 
     emh->Az = em->Az;
@@ -928,7 +946,7 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     //Nz
     istart = iend+1; 
     iend   = istart; 
-    getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> em->Nz ; 
     emh->Nz = em->Nz;
     
@@ -937,15 +955,16 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     
     istart = iend+1; 
     iend   = istart+3; 
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); 
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); 
     
     int  iRead=0 , iactual = 1 ;
     int  Polarity = 0 ;
     Double_t ImA, x0, y0, z0;
+    EdgePipeline pipe( tree , em ) ;
     for (Int_t iloop = 0 ; iloop < NumOfScans ; iloop++ ) {
       
-      getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
-      if ( in.eof() ) break;
+      if ( text.Eof() ) break;
+      text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
       if (version==1.0)
         myStream >> tms >> Dval >> Dval >>Dval >>Dval >>em->Temp >> Dval >> em->Vbias >> ImA >> em->x >> em->y >> em->z >> Ival ;
       if (version==1.1)
@@ -979,32 +998,29 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
       date.Set(yy, mm, ddi, hhi, mni, ssi) ;
       em->utc = date ;
       
-      getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
-      myStream >> em->At >> em->Nt ; em->At = em->At*1.e9 ; emh->At = em->At ;
+      //Waveforms read straight from the mapped file, one line each
+      text.Next( em->At ) ; text.Next( em->Nt ) ; em->At = em->At*1.e9 ; emh->At = em->At ;
       #if READONLYPDWVF==1
-        getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+        text.SkipLine() ;
       #endif
       for ( int i=0 ; i< em->Nt ; i++) {
-	myStream >> em->volt[i] ;
+	text.Next( em->volt[i] ) ;
 	em->time[i]=i*em->At ; 
       }
+      text.SkipLine() ;
 
       //----------------- Photodiode -------------------------------
-      //getline(in, line);    
+      //text.GetLine(line);    
       
       Double_t LPower = 0. , LNph = 0. ;
       Double_t Vpd , Qpd = 0. , Bline = 0. , Vpdmax = -999999.9 , Eph;
 
-      //All photodiode's voltages
-      #if READONLYPDWVF==0  //If we only study the PD, we already read this line
-        getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
-      #endif
-
+      //All photodiode's voltages, in the next line
       //Baseline of photodiode
       Int_t Nbl = TMath::Nint(5.0/em->At) ;
       for ( int i=0 ; i< Nbl ; i++) {
         #if READONLYPDWVF==0  //If we only study the PD, we have already read this line
-	  myStream >> Vpd ;
+	  text.Next( Vpd ) ;
 	  Bline+= Vpd ;  
 	#else
 	  Bline+= em->volt[i] ;  
@@ -1016,7 +1032,7 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
       for ( int i=Nbl ; i< em->Nt ; i++) {
 
         #if READONLYPDWVF==0  //If we only study the PD, we have already read this line
-	  myStream >> Vpd ;
+	  text.Next( Vpd ) ;
 	  Vpd = Vpd - Bline ;
 	#else
 	  Vpd = em->volt[i] - Bline ;
@@ -1025,6 +1041,9 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
 	if ( Vpd > 0. ) Qpd+=Vpd ; //This is really only an approximation to the total charge !!!
 
       }
+      #if READONLYPDWVF==0
+        text.SkipLine() ;
+      #endif
 
       //Power and number of photons
       LPower = (emh->Lambda==1064.0)? Vpdmax/(ROSC*AWIR) : Vpdmax/(ROSC*AWRED) ;
@@ -1050,35 +1069,22 @@ int parse_tctplus( const char *filename, TMeas *em , TTree *tree , Double_t Cend
 
       em->event=iRead ;
       
-      //Now postprocess this entry (find out baseline, rtime and so on
-      TWaveform *wv = new TWaveform( em ) ;
-	
-      if (iRead==0) tree->Branch("proc" , &wv , 32000 , 1 );
-       
-      if ( LPower!=0. ) {
-        wv->LPower = LPower ;
-        //wv->LPower = Pavg ;
-	wv->LNph   = LNph ;
-      }
-      
-      tree->Fill() ;
+      //Postprocessed (baseline, rtime and so on) and filled by the pipeline
+      pipe.Push( em , LPower , LNph ) ;
       iRead++   ;
-      //if (iRead%1000 == 0) tree->AutoSave();
 
       if (iRead%100==0) cout << "Read " << iRead << flush <<"\r" ;
-      delete wv ; 
 
       iactual++ ;
       
     }
     
+    pipe.Close() ;
     emh->Polarity = (Polarity>1) ? 1 : -1 ;
-    tree->GetUserInfo()->Add( emh ) ;
+    edgelayout::AddHeader( tree , emh ) ;
     cout << endl ;
     cout << "Total read:" << iRead << endl ;
     em->Ntevent=iRead ; //It does not go into the tree, only in the class!
-    
-    in.close() ;
         
     //delete emh ;
 
@@ -1281,9 +1287,10 @@ int parse_TPA( const char *filename, TMeas *em , TTree *tree , Double_t Cend ) {
       em->event=iRead ;
       
       //Now postprocess this entry (find out baseline, rtime and so on
-      TWaveform *wv = new TWaveform( em ) ;
+      TWaveform *wv = new TWaveform( em , kTRUE ) ;
+      wv->Evaluate( em ) ;
 	
-      if (iRead==0) tree->Branch("proc" , &wv , 32000 , 1 );
+      if (iRead==0) edgelayout::Branch( tree , "proc" , &wv ) ;
        
       if ( LPower!=0. ) {
         wv->LPower = LPower ;
@@ -1297,9 +1304,9 @@ int parse_TPA( const char *filename, TMeas *em , TTree *tree , Double_t Cend ) {
       }
       
       #if SPACORR==0
-        tree->Fill() ;
+        edgelayout::Fill( tree , em ) ;
       #else
-	if (iRead!=SPAEVENT) tree->Fill() ;
+	if (iRead!=SPAEVENT) edgelayout::Fill( tree , em ) ;
       #endif
 
       
@@ -1314,7 +1321,7 @@ int parse_TPA( const char *filename, TMeas *em , TTree *tree , Double_t Cend ) {
     }
     
     emh->Polarity = (Polarity>1) ? 1 : -1 ;
-    tree->GetUserInfo()->Add( emh ) ;
+    edgelayout::AddHeader( tree , emh ) ;
     cout << endl ;
     cout << "Total read:" << iRead << endl ;
     em->Ntevent=iRead ; //It does not go into the tree, only in the class!
@@ -1517,17 +1524,18 @@ int parse_tctUHH( const char *filename, TMeas *em , TTree *tree , Double_t Cend
       em->event=iRead ;
       
       //Now postprocess this entry (find out baseline, rtime and so on
-      TWaveform *wv = new TWaveform( em ) ;
+      TWaveform *wv = new TWaveform( em , kTRUE ) ;
+      wv->Evaluate( em ) ;
 	
       if (iRead==0) {
          emh->At = em->At ;
-         tree->Branch("proc" , &wv , 32000 , 1 );
+         edgelayout::Branch( tree , "proc" , &wv ) ;
       }
        
       wv->LPower = 0. ;
       wv->LNph   = 0. ;
       
-      tree->Fill() ;
+      edgelayout::Fill( tree , em ) ;
       iRead++   ;
       //if (iRead%1000 == 0) tree->AutoSave();
 
@@ -1539,7 +1547,7 @@ int parse_tctUHH( const char *filename, TMeas *em , TTree *tree , Double_t Cend
     }
     
     emh->Polarity = (Polarity>1) ? 1 : -1 ;
-    tree->GetUserInfo()->Add( emh ) ;
+    edgelayout::AddHeader( tree , emh ) ;
     cout << endl ;
     cout << "Total read:" << iRead << endl ;
     em->Ntevent=iRead ; //It does not go into the tree, only in the class!
@@ -1556,27 +1564,26 @@ int parse_tctUHH( const char *filename, TMeas *em , TTree *tree , Double_t Cend
 /*----------------------------------------------------------*/
 /**
  *
- * @param filename
+ * @param text
  * @param em
  * @param tree
  * @param Cend
  * @return
  */
-int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend ) {
+int parse_TRACS( MappedFile &text , TMeas *em , TTree *tree , Double_t Cend ) {
     
     //Note that there is a difference in the coordinates. He calls X to my Y.
-    //Open file
-    ifstream in( filename );    
+    //File already mapped, from its start
 
     string line, what ;
-    for (Int_t iloop = 1 ; iloop<= 3 ; iloop ++ ) getline(in, line);
+    for (Int_t iloop = 1 ; iloop<= 3 ; iloop ++ ) text.GetLine(line);
     stringstream myStream(line);
     Double_t version ; myStream >> what >> version ;
 
     
     //StartTime
     Int_t istart=4 , iend = 6 ;
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line);
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line);
     TString sdate = TString( line ) ;
     UShort_t  dd, mm, yy , hh , mn, ss;
     yy=atoi( sdate(11,4).Data() );
@@ -1591,7 +1598,7 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
 
     
     //Wavelength
-    getline(in, line); 
+    text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     Double_t wvlength ; myStream >> what >>  wvlength ;
     
@@ -1600,7 +1607,7 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     Int_t Illum ;
     istart=iend+1; //11
     iend=istart;   //11
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); 
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     string direction ; myStream >> what >>  direction ;
     if      ( direction.find("edge") == 1  ) Illum = 1 ;
@@ -1609,7 +1616,7 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     
     //Amp gain
     Double_t Gain ;
-    getline(in, line);  
+    text.GetLine(line);  
     myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> Gain ;
 
@@ -1618,25 +1625,25 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     Double_t Phi =0., iann =0. ;
 
     //Fluence
-    getline(in, line); 
+    text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> Phi ;
 
     //Annealing
-    getline(in, line); 
+    text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> iann ;
       
         
     //Total number of Scans
-    getline(in, line); 
+    text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     Int_t NumOfScans ; myStream >> what >> NumOfScans ;
     
     
     // NVoltages
     Int_t Ival /*, t0s , tms*/ ;
-    for (Int_t iloop = 1 ; iloop<= 9 ; iloop ++ ) getline(in, line); 
+    for (Int_t iloop = 1 ; iloop<= 9 ; iloop ++ ) text.GetLine(line); 
     myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what ; myStream >> Ival ;
     em->NV = Ival ; 
@@ -1655,14 +1662,14 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
   
     
     //Vbias vector
-    getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what ; for ( int i=0 ; i< em->NV ; i++) myStream >> emh->vVbias[i] ;
     
     //Ax
     istart = 1; 
     iend   = istart+12; 
     Double_t Dval ;
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> Dval ;
     em->Ax  = Dval *1000. ; 
     emh->Ax = em->Ax;
@@ -1670,14 +1677,14 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     //Nx
     istart = iend+1; 
     iend   = istart; 
-    getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> em->Nx ; 
     emh->Nx = em->Nx;
 
     //Ay
     istart = iend+1; 
     iend   = istart+2; 
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream>> what  >> Dval ;
     em->Ay  = Dval *1000. ; 
     emh->Ay = em->Ay;
@@ -1685,14 +1692,14 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     //Ny
     istart = iend+1; 
     iend   = istart; 
-    getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> em->Ny ; 
     emh->Ny = em->Ny;
 
     //Az
     istart = iend+1; 
     iend   = istart+3; 
-    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    for (Int_t iloop = istart ; iloop<= iend ; iloop ++ ) text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream>> what  >> Dval ;
     em->Az  = Dval *1000. ; 
     emh->Az = em->Az;
@@ -1700,38 +1707,39 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     //Nz
     istart = iend+1; 
     iend   = istart; 
-    getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> em->Nz ; 
     emh->Nz = em->Nz;
 
     //At
-    getline(in, line); getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> em->At ; 
     em->At  = em->At*1.e9;
     emh->At = em->At ;
     
     //Capacitance
-    getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
+    text.GetLine(line); myStream.str(""); myStream.clear() ; myStream << line ;
     myStream >> what >> Cend ; 
     emh->Cend = Cend*1.e12 ;
   
     //remaining info (useful for logging, not in the trees)    
-    for (Int_t iloop = 1 ; iloop<= 7 ; iloop ++ ) getline(in, line) ;
+    for (Int_t iloop = 1 ; iloop<= 7 ; iloop ++ ) text.GetLine(line) ;
     
     if ( emh->Illum == 1  ) cout << "TRACS: top illumination"   << endl ;
     if ( emh->Illum == 0  ) cout << "TRACS: edgeTCT" << endl ;
     if ( emh->Illum == -1 ) cout << "TRACS: bottom illumination"  << endl ;
     
-    for (Int_t iloop = 1 ; iloop<= 4 ; iloop ++ ) getline(in, line); 
+    for (Int_t iloop = 1 ; iloop<= 4 ; iloop ++ ) text.GetLine(line); 
     
     int  iRead=0 , iactual = 1 ;
     int  Polarity = 0 ;
     Double_t /*ImA,*/x0,y0,z0;
+    EdgePipeline pipe( tree , em ) ;
     for (Int_t iloop = 0 ; iloop < NumOfScans ; iloop++ ) {
       
-      getline(in, line); myStream.str(""); myStream.clear() ; myStream << line ;
-      if ( in.eof() ) break;
-      myStream >> em->Nt >> em->Temp >> em->Vbias >> em->x >> em->y >> em->z  ;
+      //Each row read straight from the mapped file
+      if ( text.Eof() ) break;
+      text.Next( em->Nt ) ; text.Next( em->Temp ) ; text.Next( em->Vbias ) ; text.Next( em->x ) ; text.Next( em->y ) ; text.Next( em->z ) ;
             
       //Calculate the bin slice along each coordinate
       if (iloop==0) { x0=em->x ;y0=em->y ;z0=em->z ; }
@@ -1740,9 +1748,10 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
       em->iz = (em->Az!=0.)? 1 + TMath::Nint((em->z - z0)/em->Az):1 ;
       
       for ( int i=0 ; i< em->Nt ; i++) {
-	myStream >> em->volt[i] ;
+	text.Next( em->volt[i] ) ;
 	em->time[i]=i*em->At ; 
       }
+      text.SkipLine() ;
 
       //Estimate polarity
       if ( TMath::Abs(TMath::MaxElement(em->Nt,em->volt)) > TMath::Abs(TMath::MinElement(em->Nt,em->volt)) ) Polarity++ ;
@@ -1750,29 +1759,22 @@ int parse_TRACS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
 
       em->event=iRead ;
       
-      //Now postprocess this entry (find out baseline, rtime and so on
-      TWaveform *wv = new TWaveform( em ) ;
-	
-      if (iRead==0) tree->Branch("proc" , &wv , 32000 , 1 );
-             
-      tree->Fill() ;
+      //Postprocessed (baseline, rtime and so on) and filled by the pipeline
+      pipe.Push( em ) ;
       iRead++   ;
-      //if (iRead%1000 == 0) tree->AutoSave();
 
       if (iRead%100==0) cout << "Read " << iRead << flush <<"\r" ;
-      delete wv ; 
 
       iactual++ ;
       
     }
     
+    pipe.Close() ;
     emh->Polarity = (Polarity>1) ? 1 : -1 ;
-    tree->GetUserInfo()->Add( emh ) ;
+    edgelayout::AddHeader( tree , emh ) ;
     cout << endl ;
     cout << "Total read:" << iRead << endl ;
     em->Ntevent=iRead ; //It does not go into the tree, only in the class!
-    
-    in.close() ;
         
     //delete emh ;
 
@@ -2090,9 +2092,10 @@ int parse_IDLTS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
       em->event=iRead ;
       
       //Now postprocess this entry (find out baseline, rtime and so on
-      TWaveform *wv = new TWaveform( em ) ;
+      TWaveform *wv = new TWaveform( em , kTRUE ) ;
+      wv->Evaluate( em ) ;
 	
-      if (iRead==0) tree->Branch("proc" , &wv , 32000 , 1 );
+      if (iRead==0) edgelayout::Branch( tree , "proc" , &wv ) ;
        
       if ( LPower!=0. ) {
         wv->LPower = LPower ;
@@ -2100,7 +2103,7 @@ int parse_IDLTS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
 	wv->LNph   = LNph ;
       }
       
-      tree->Fill() ;
+      edgelayout::Fill( tree , em ) ;
       iRead++   ;
       //if (iRead%1000 == 0) tree->AutoSave();
 
@@ -2112,7 +2115,7 @@ int parse_IDLTS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
     }
     
     emh->Polarity = (Polarity>1) ? 1 : -1 ;
-    tree->GetUserInfo()->Add( emh ) ;
+    edgelayout::AddHeader( tree , emh ) ;
     cout << endl ;
     cout << "Total read:" << iRead << endl ;
     em->Ntevent=iRead ; //It does not go into the tree, only in the class!
@@ -2127,32 +2130,28 @@ int parse_IDLTS( const char *filename, TMeas *em , TTree *tree , Double_t Cend )
 /*----------------------------------------------------------*/
 /**
  *
- * @param filename
+ * @param text
  * @return
  */
-int ReadNerOfBins( const char *filename ) {
+int ReadNerOfBins( MappedFile &text ) {
    
      Int_t Ner = 0;
   
-    //Open file
-    ifstream in( filename );
-    if (!in || in.bad()) {
-      cout << "Error opening " << filename << endl ;
-      exit(1);
-    }
+    //Header of the mapped file
+    text.Rewind() ;
         
     //Read header
     string what , line , Type , Dfnm ;
-    getline(in,line) ;  
+    text.GetLine(line) ;  
     stringstream myStream(line);
     Int_t Nskip ;
     if        ( line.find("================") == 0 ) {
-       getline(in,line) ;  
+       text.GetLine(line) ;  
        if        ( line.find("SSD simulation") == 0 ) { 
          Nskip=60;
        } else {
 
-	 getline(in,line) ;  
+	 text.GetLine(line) ;  
 	 Double_t version ; 
 	 myStream.str(""); myStream.clear() ; myStream << line ;
 	 myStream >> what >> version ;
@@ -2161,13 +2160,13 @@ int ReadNerOfBins( const char *filename ) {
 	 if (version == 1.3 ) Nskip=58;
 	 
 	 //Only IDLTS
-	 getline(in,line) ;getline(in,line) ;
+	 text.GetLine(line) ;text.GetLine(line) ;
 	 myStream.str(""); myStream.clear() ; myStream << line ; 
 	 myStream >> what >> Type ;
 	 if ( Type.find("DLTS")==0 ) {
 	   //Get filename where number of points is stored
 	   Nskip=55;
-	   for (int i=5 ; i<=Nskip ; i++) getline(in,line) ;myStream.str(""); 
+	   for (int i=5 ; i<=Nskip ; i++) text.GetLine(line) ;myStream.str(""); 
 	   myStream.clear() ; myStream << line ;  
 	   myStream>>Dfnm;
            ifstream din( Dfnm );
@@ -2179,39 +2178,37 @@ int ReadNerOfBins( const char *filename ) {
 	   myStream.str(""); myStream.clear() ; myStream << line ;
 	   char c ;
 	   myStream >> what >> c>>Ner>>c>>Ner;
-	   in.ignore() ;
-	   in.close() ;
+	   text.Rewind() ;
 	   din.ignore() ;
 	   din.close() ;
            return(Ner) ;
 	 }
 	 
-         for (int i=4 ; i<Nskip ; i++) getline(in,line) ; 
+         for (int i=4 ; i<Nskip ; i++) text.GetLine(line) ; 
        }
        
     } else if ( line.find("----------------")      == 0 ) {        //TPA
        Nskip=17;  //TPA
-       for (int i=2 ; i<Nskip ; i++) getline(in,line) ; 
+       for (int i=2 ; i<Nskip ; i++) text.GetLine(line) ; 
 
     } else if ( line.find("MTCT Header")      == 0 ) {             //UHH
        Nskip=69;  //UHH
-       for (int i=2 ; i<Nskip ; i++) getline(in,line) ; 
+       for (int i=2 ; i<Nskip ; i++) text.GetLine(line) ; 
 
     } else if ( line.find("* t0      :")      == 0 ) {             //IFCA
-       getline(in,line) ;  getline(in,line) ;  
+       text.GetLine(line) ;  text.GetLine(line) ;  
        myStream.str(""); myStream.clear() ; myStream << line ;
        char c ;
        myStream >> c >> what >> c >> Ner >> c ;
        cout << "Waveforms have " << Ner << " bins." <<endl ;
 
-       in.ignore() ;
-       in.close() ;
+       text.Rewind() ;
 
        return(Ner) ;
       
     } else {
       Nskip= 15;                                              //Standard eTCT
-      for (int i=2 ; i<Nskip ; i++) getline(in,line) ; 
+      for (int i=2 ; i<Nskip ; i++) text.GetLine(line) ; 
     }
     
        
@@ -2231,7 +2228,7 @@ int ReadNerOfBins( const char *filename ) {
     } else if (Nskip==53 ){
       myStream  >> Ner ;	     //14 NTimePoints:  10003
     } else if (Nskip==60 ){
-      for (int i=2 ; i<Nskip ; i++) getline(in,line) ; 
+      for (int i=2 ; i<Nskip ; i++) text.GetLine(line) ; 
       myStream.str(""); myStream.clear() ; myStream << line ;
       myStream  >> Ner ;	     //TRACS
     } else {
@@ -2239,8 +2236,7 @@ int ReadNerOfBins( const char *filename ) {
     }
     cout << "Waveforms have " << Ner << " bins." <<endl ;
 
-    in.ignore() ;
-    in.close() ;
+    text.Rewind() ;
     
     return(Ner) ;
 }
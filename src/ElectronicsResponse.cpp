@@ -0,0 +1,236 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************ElectronicsResponse***********************************
+ *
+ * RC:            y[j] = y[j-1] + alfa ( x[j] - y[j-1] ), alfa = dt/(RC+dt), y[0] = 0, as TRACSInterface::shape_rc
+ * Transfer:      y = x * tf (sum over bins, as H1DConvolution), tf resampled at dt if needed
+ * Bandwidth:     second order Butterworth low pass at f3dB (bilinear transform, prewarped)
+ *
+ */
+
+#include <ElectronicsResponse.h>
+
+#include <iostream>
+#include <cmath>
+
+/**
+ *
+ * @param dt
+ */
+ElectronicsResponse::ElectronicsResponse( double dt ) : dt( dt ) { }
+
+/**
+ * RC low pass, RC in seconds
+ * @param RC
+ */
+void ElectronicsResponse::AddRC( double RC ) {
+
+	Stage s ;
+	s.type = kRC ;
+	s.par = RC ;
+	Coefficients( s ) ;
+	stages.push_back( s ) ;
+
+}
+
+/**
+ * Amplifier transfer function, sampled every tfdt seconds
+ * @param tf
+ * @param tfdt
+ */
+void ElectronicsResponse::AddTransferFunction( const std::vector<double> & tf , double tfdt ) {
+
+	Stage s ;
+	s.type = kTransfer ;
+	s.par = tfdt ;
+	s.tf = tf ;
+	Coefficients( s ) ;
+	stages.push_back( s ) ;
+
+}
+
+/**
+ * Bandwidth limit, f3dB in Hz
+ * @param f3dB
+ */
+void ElectronicsResponse::AddBandwidth( double f3dB ) {
+
+	Stage s ;
+	s.type = kBandwidth ;
+	s.par = f3dB ;
+	Coefficients( s ) ;
+	stages.push_back( s ) ;
+
+}
+
+void ElectronicsResponse::Clear( ) {
+
+	stages.clear() ;
+
+}
+
+/**
+ * New time step of the waveforms (e.g. after TRACSInterface::set_Fidelity)
+ * @param newdt
+ */
+void ElectronicsResponse::SetTimeStep( double newdt ) {
+
+	if ( newdt == dt ) return ;
+	dt = newdt ;
+	for ( size_t i = 0 ; i < stages.size() ; i++ ) Coefficients( stages[i] ) ;
+
+}
+
+/**
+ * New RC of the RC stages (e.g. after TRACSInterface::set_Fit_Norm changes C)
+ * @param RC
+ */
+void ElectronicsResponse::SetRC( double RC ) {
+
+	for ( size_t i = 0 ; i < stages.size() ; i++ ) {
+		if ( stages[i].type != kRC || stages[i].par == RC ) continue ;
+		stages[i].par = RC ;
+		Coefficients( stages[i] ) ;
+	}
+
+}
+
+void ElectronicsResponse::Coefficients( Stage & s ) const {
+
+	if ( s.type == kRC ) s.c[0] = dt/( s.par + dt ) ;
+
+	else if ( s.type == kBandwidth ) {
+		double K = std::tan( M_PI*s.par*dt ) ;
+		if ( !( s.par*dt < 0.5 ) ) K = 0. ; //Above Nyquist: nothing to limit
+		double norm = 1./( 1. + std::sqrt(2.)*K + K*K ) ;
+		s.c[0] = K*K*norm ;                               //b0 = b2, b1 = 2 b0
+		s.c[1] = 2.*s.c[0] ;
+		s.c[2] = s.c[0] ;
+		s.c[3] = 2.*( K*K - 1. )*norm ;                   //a1
+		s.c[4] = ( 1. - std::sqrt(2.)*K + K*K )*norm ;    //a2
+		if ( K == 0. ) { s.c[0] = 1. ; s.c[1] = s.c[2] = s.c[3] = s.c[4] = 0. ; }
+	}
+
+	else if ( s.type == kTransfer ) {
+		//Resample keeping the sum of the kernel, which sets the gain
+		double r = dt/s.par ;
+		std::vector<double> k ;
+		if ( std::fabs( r - 1. ) < 1.e-9 ) k = s.tf ;
+		else {
+			int n = (int) std::floor( ( s.tf.size() - 1 )/r ) + 1 ;
+			for ( int i = 0 ; i < n ; i++ ) {
+				double x = i*r ;
+				int j = (int) x ;
+				double v = ( j+1 < (int) s.tf.size() ) ? s.tf[j] + ( x-j )*( s.tf[j+1] - s.tf[j] ) : s.tf[j] ;
+				k.push_back( r*v ) ;
+			}
+		}
+		s.kernel = std::make_shared<fft::Kernel>( k ) ;
+	}
+
+}
+
+/*
+ * All the stages on the time-major matrix w (nt rows of nw waveforms).
+ */
+/**
+ *
+ * @param w
+ * @param nw
+ * @param nt
+ */
+void ElectronicsResponse::Apply( std::vector<double> & w , int nw , int nt ) const {
+
+	for ( size_t is = 0 ; is < stages.size() ; is++ ) {
+
+		const Stage & s = stages[is] ;
+
+		if ( s.type == kRC ) {
+			const double alfa = s.c[0] ;
+			for ( int iw = 0 ; iw < nw ; iw++ ) w[iw] = 0. ; //Starts at rest, as shape_rc
+			for ( int it = 1 ; it < nt ; it++ ) {
+				double * __restrict__ y = &w[it*nw] ;
+				const double * __restrict__ yp = &w[(it-1)*nw] ;
+				for ( int iw = 0 ; iw < nw ; iw++ ) y[iw] = yp[iw] + alfa*( y[iw] - yp[iw] ) ;
+			}
+		}
+
+		else if ( s.type == kBandwidth ) {
+			const double b0 = s.c[0] , b1 = s.c[1] , b2 = s.c[2] , a1 = s.c[3] , a2 = s.c[4] ;
+			std::vector<double> x1( nw , 0. ) , x2( nw , 0. ) , y1( nw , 0. ) , y2( nw , 0. ) ;
+			for ( int it = 0 ; it < nt ; it++ ) {
+				double * __restrict__ y = &w[it*nw] ;
+				for ( int iw = 0 ; iw < nw ; iw++ ) {
+					double x0 = y[iw] ;
+					double y0 = b0*x0 + b1*x1[iw] + b2*x2[iw] - a1*y1[iw] - a2*y2[iw] ;
+					x2[iw] = x1[iw] ; x1[iw] = x0 ;
+					y2[iw] = y1[iw] ; y1[iw] = y0 ;
+					y[iw] = y0 ;
+				}
+			}
+		}
+
+		else if ( s.type == kTransfer ) {
+			std::vector<double> col( nt ) , out ;
+			for ( int iw = 0 ; iw < nw ; iw++ ) {
+				for ( int it = 0 ; it < nt ; it++ ) col[it] = w[it*nw+iw] ;
+				s.kernel->Apply( col , nt , out ) ;
+				for ( int it = 0 ; it < nt ; it++ ) w[it*nw+iw] = out[it] ;
+			}
+		}
+
+	}
+
+}
+
+/**
+ *
+ * @param waves
+ * @param irows
+ */
+void ElectronicsResponse::Apply( WaveformStore & waves , const std::vector<int> & irows ) const {
+
+	std::vector<int> rows = irows ;
+	if ( rows.empty() ) for ( size_t i = 0 ; i < waves.GetNRows() ; i++ ) rows.push_back( i ) ;
+	if ( rows.empty() || stages.empty() ) return ;
+
+	int nw = rows.size() , nt = waves[rows[0]].size() ;
+	std::vector<double> w( (size_t) nw*nt ) ;
+	for ( int iw = 0 ; iw < nw ; iw++ ) {
+		WaveformStore::View v = waves[rows[iw]] ;
+		for ( int it = 0 ; it < nt ; it++ ) w[it*nw+iw] = v[it] ;
+	}
+
+	Apply( w , nw , nt ) ;
+
+	//Column iw of the matrix back to its row
+	for ( int iw = 0 ; iw < nw ; iw++ ) waves.Set( rows[iw] , &w[iw] , nt , nw ) ;
+
+}
+
+/**
+ *
+ * @param wave
+ * @param dt
+ * @param name
+ * @param title
+ * @return
+ */
+TH1D * ElectronicsResponse::Histogram( const std::valarray<double> & wave , double dt , TString name , TString title ) {
+
+	TH1D * h = new TH1D( name , title , wave.size() , 0. , wave.size()*dt ) ;
+	for ( size_t i = 0 ; i < wave.size() ; i++ ) h->SetBinContent( i+1 , wave[i] ) ;
+	return h ;
+
+}
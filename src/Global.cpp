@@ -19,14 +19,20 @@
 #include <TRACSInterface.h>
 
 //Main variables of TRACS to store the induced current during the whole execution
-std::valarray<std::valarray <double> > vItotals;
-vector<vector <TH1D*> >  i_ramo_array, i_conv_array, i_rc_array;
+//(V,Y,Z) map of shaped currents and, if enabled, of their convolution with the amplifier
+WaveformStore vItotals, vIconv;
+//Keep them in single precision (large maps)
+bool floatStore = false;
+//If set, vItotals is not filled: the shaped currents are streamed to the output file
+ResultSink * resultSink = nullptr;
 
 //Define here the steering file you want to use. Store it in myApp folder.
 std::string fnm="MyConfigTRACS";
 //For mutex areas
 std::mutex mtx;
 int num_threads;
+//Fidelity of the simulations launched by call_from_thread_FitPar/FitNorm (1 = full)
+int fidelity = 1;
 std::ofstream fileDiffDrift;
 
 
@@ -0,0 +1,345 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************HetctWriter***********************************
+ *
+ * write_to_file_row opened the file, wrote one row through iostreams and closed it again
+ * for every waveform. Here the file is opened once and whole batches of rows go out in
+ * a few large writes.
+ *
+ */
+
+#include <HetctWriter.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <stdint.h>
+
+/**
+ *
+ * @param filename
+ * @param bufsize
+ */
+HetctWriter::HetctWriter( std::string filename , size_t bufsize ) : buffer( bufsize ) {
+
+	fp = fopen( filename.c_str() , "a" ) ;
+	if ( fp == NULL ) {
+		std::cout << "Error: cannot open " << filename << std::endl ;
+		std::cout << "Exiting!"<< std::endl ;
+		exit(-1);
+	}
+	setvbuf( fp , buffer.data() , _IOFBF , buffer.size() ) ;
+
+}
+
+HetctWriter::~HetctWriter( ) {
+
+	fclose( fp ) ;
+
+}
+
+/*
+ * Floating point number f*2^e with a 64 bit significand
+ */
+struct DiyFp {
+	uint64_t f ;
+	int e ;
+	DiyFp( ) : f( 0 ) , e( 0 ) { }
+	DiyFp( uint64_t f , int e ) : f( f ) , e( e ) { }
+} ;
+
+static inline DiyFp Normalize( DiyFp x ) {
+	int s = __builtin_clzll( x.f ) ;
+	return DiyFp( x.f << s , x.e - s ) ;
+}
+
+//Upper 64 bits of the product, rounded
+static inline DiyFp Multiply( const DiyFp & a , const DiyFp & b ) {
+	unsigned __int128 p = (unsigned __int128) a.f * b.f ;
+	uint64_t h = (uint64_t)( p >> 64 ) , l = (uint64_t) p ;
+	if ( l >> 63 ) h++ ;
+	return DiyFp( h , a.e + b.e + 64 ) ;
+}
+
+/*
+ * 10^k, k = -348 + 8*i, i = 0..86, normalized to 64 bits. Computed once from 10^0 by
+ * steps of x10 and /10 carried with 128 bit significands, far more precise than needed.
+ */
+struct CachedPowers {
+	DiyFp p[87] ;
+	CachedPowers( ) {
+		for ( int dir = -1 ; dir <= 1 ; dir += 2 ) {
+			unsigned __int128 m = (unsigned __int128) 1 << 127 ;
+			int e = -127 ;
+			for ( int k = 0 ; k <= 348 ; k++ ) {
+				if ( k % 8 == 4 ) {   //10^(dir*k) with dir*k = -348 + 8*i
+					int i = ( dir*k + 348 )/8 ;
+					uint64_t h = (uint64_t)( m >> 64 ) ;
+					int ee = e + 64 ;
+					if ( (uint64_t) m >> 63 ) { h++ ; if ( h == 0 ) { h = (uint64_t) 1 << 63 ; ee++ ; } }
+					if ( i >= 0 && i < 87 ) p[i] = DiyFp( h , ee ) ;
+				}
+				if ( dir > 0 ) {
+					//m*10 takes up to 132 bits: keep the upper 128
+					uint64_t H = (uint64_t)( m >> 64 ) , L = (uint64_t) m ;
+					unsigned __int128 lo = (unsigned __int128) L*10 ;
+					unsigned __int128 hi = (unsigned __int128) H*10 + (uint64_t)( lo >> 64 ) ;  //up to 68 bits
+					int s = 0 ; while ( ( hi >> ( 64 + s ) ) != 0 ) s++ ;
+					m = ( hi << ( 64 - s ) ) | ( (uint64_t) lo >> s ) ;
+					e += s ;
+				}
+				else {
+					unsigned __int128 q = m/10 , r = m%10 ;
+					int s = 0 ; while ( !( ( q << s ) >> 127 ) ) s++ ;
+					m = ( q << s ) + ( r << s )/10 ;
+					e -= s ;
+				}
+			}
+		}
+	}
+} ;
+
+static const CachedPowers cached ;
+
+static const uint64_t kPow10[20] = { 1ULL , 10ULL , 100ULL , 1000ULL , 10000ULL , 100000ULL , 1000000ULL , 10000000ULL , 100000000ULL , 1000000000ULL ,
+	10000000000ULL , 100000000000ULL , 1000000000000ULL , 10000000000000ULL , 100000000000000ULL , 1000000000000000ULL ,
+	10000000000000000ULL , 100000000000000000ULL , 1000000000000000000ULL , 10000000000000000000ULL } ;
+
+/*
+ * Moves the last digit down while the number stays within the bounds and gets closer to v
+ */
+static inline void GrisuRound( char * buffer , int len , uint64_t delta , uint64_t rest , uint64_t ten_kappa , uint64_t wp_w ) {
+	while ( rest < wp_w && delta - rest >= ten_kappa &&
+	        ( rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w ) ) {
+		buffer[len-1]-- ;
+		rest += ten_kappa ;
+	}
+}
+
+/*
+ * Digits of Mp until the remainder falls below delta (the width of the rounding interval)
+ */
+static inline void DigitGen( const DiyFp & W , const DiyFp & Mp , uint64_t delta , char * buffer , int & len , int & K ) {
+	const DiyFp one( (uint64_t) 1 << -Mp.e , Mp.e ) ;
+	const uint64_t wp_w = Mp.f - W.f ;
+	uint32_t p1 = (uint32_t)( Mp.f >> -one.e ) ;
+	uint64_t p2 = Mp.f & ( one.f - 1 ) ;
+	int kappa = 1 ;
+	while ( kappa < 10 && p1 >= kPow10[kappa] ) kappa++ ;
+	len = 0 ;
+	while ( kappa > 0 ) {
+		uint32_t d = p1/kPow10[kappa-1] ;
+		p1 %= kPow10[kappa-1] ;
+		if ( d || len ) buffer[len++] = '0' + d ;
+		kappa-- ;
+		uint64_t tmp = ( (uint64_t) p1 << -one.e ) + p2 ;
+		if ( tmp <= delta ) {
+			K += kappa ;
+			GrisuRound( buffer , len , delta , tmp , kPow10[kappa] << -one.e , wp_w ) ;
+			return ;
+		}
+	}
+	for ( ;; ) {
+		p2 *= 10 ;
+		delta *= 10 ;
+		char d = (char)( p2 >> -one.e ) ;
+		if ( d || len ) buffer[len++] = '0' + d ;
+		p2 &= one.f - 1 ;
+		kappa-- ;
+		if ( p2 < delta ) {
+			K += kappa ;
+			GrisuRound( buffer , len , delta , p2 , one.f , wp_w*kPow10[-kappa] ) ;
+			return ;
+		}
+	}
+}
+
+/*
+ * Digits and decimal exponent (v = digits*10^K) of v = f*2^e, positive, with
+ * lowerCloser when the next smaller number is half as far as the next larger one
+ */
+static inline void Grisu2( uint64_t f , int e , bool lowerCloser , char * buffer , int & len , int & K ) {
+	DiyFp pl = Normalize( DiyFp( ( f << 1 ) + 1 , e - 1 ) ) ;
+	DiyFp mi = lowerCloser ? DiyFp( ( f << 2 ) - 1 , e - 2 ) : DiyFp( ( f << 1 ) - 1 , e - 1 ) ;
+	mi.f <<= mi.e - pl.e ;
+	mi.e = pl.e ;
+
+	double dk = ( -61 - pl.e )*0.30102999566398114 + 347 ;
+	int k = (int) dk ;
+	if ( dk - k > 0. ) k++ ;
+	unsigned index = (unsigned)( ( k >> 3 ) + 1 ) ;
+	K = -( -348 + (int)( index << 3 ) ) ;
+	const DiyFp & c = cached.p[index] ;
+
+	DiyFp W = Multiply( Normalize( DiyFp( f , e ) ) , c ) ;
+	DiyFp Wp = Multiply( pl , c ) ;
+	DiyFp Wm = Multiply( mi , c ) ;
+	Wm.f++ ;
+	Wp.f-- ;
+	DigitGen( W , Wp , Wp.f - Wm.f , buffer , len , K ) ;
+}
+
+/*
+ * digits*10^K as %g would write it: plain for exponents -5..16, scientific otherwise
+ */
+static inline char * Prettify( char * p , const char * digits , int len , int K ) {
+	int x = len + K - 1 ;           //Exponent of the first digit
+	if ( x >= -5 && x <= 16 ) {
+		if ( x < 0 ) {
+			*p++ = '0' ; *p++ = '.' ;
+			for ( int i = -1 ; i > x ; i-- ) *p++ = '0' ;
+			memcpy( p , digits , len ) ; p += len ;
+		}
+		else if ( len <= x+1 ) {
+			memcpy( p , digits , len ) ; p += len ;
+			for ( int i = len ; i <= x ; i++ ) *p++ = '0' ;
+		}
+		else {
+			memcpy( p , digits , x+1 ) ; p += x+1 ;
+			*p++ = '.' ;
+			memcpy( p , digits + x+1 , len - x-1 ) ; p += len - x-1 ;
+		}
+		return p ;
+	}
+	*p++ = digits[0] ;
+	if ( len > 1 ) {
+		*p++ = '.' ;
+		memcpy( p , digits+1 , len-1 ) ; p += len-1 ;
+	}
+	*p++ = 'e' ;
+	if ( x < 0 ) { *p++ = '-' ; x = -x ; }
+	else *p++ = '+' ;
+	if ( x >= 100 ) { *p++ = '0' + x/100 ; x %= 100 ; *p++ = '0' + x/10 ; }
+	else *p++ = '0' + x/10 ;
+	*p++ = '0' + x%10 ;
+	return p ;
+}
+
+/*
+ * Shortest decimal of v reading back to the same value (as a float if single), written at
+ * p by Grisu2: always exact, and the shortest but for a few numbers in a thousand, which
+ * get one digit more. Returns the end of the text.
+ */
+/**
+ *
+ * @param p
+ * @param v
+ * @param single
+ * @return
+ */
+char * HetctWriter::Shortest( char * p , double v , bool single ) {
+	if ( v == 0. ) {
+		*p++ = '0' ;
+		return p ;
+	}
+	if ( !std::isfinite( v ) ) return p + sprintf( p , "%g" , v ) ;
+	if ( v < 0. ) { *p++ = '-' ; v = -v ; }
+
+	uint64_t f ; int e ; bool lowerCloser ;
+	if ( single ) {
+		float x = (float) v ;
+		uint32_t u ; memcpy( &u , &x , 4 ) ;
+		int be = u >> 23 ; f = u & 0x7FFFFF ;
+		lowerCloser = ( f == 0 && be > 1 ) ;
+		if ( be ) { f |= 0x800000 ; e = be - 150 ; } else e = 1 - 150 ;
+	}
+	else {
+		uint64_t u ; memcpy( &u , &v , 8 ) ;
+		int be = (int)( u >> 52 ) ; f = u & 0xFFFFFFFFFFFFFULL ;
+		lowerCloser = ( f == 0 && be > 1 ) ;
+		if ( be ) { f |= 0x10000000000000ULL ; e = be - 1075 ; } else e = 1 - 1075 ;
+	}
+
+	char digits[32] ; int len , K ;
+	Grisu2( f , e , lowerCloser , digits , len , K ) ;
+	return Prettify( p , digits , len , K ) ;
+}
+
+/*
+ * Appends the text of row, new line included, to text
+ */
+/**
+ *
+ * @param row
+ * @param text
+ */
+void HetctWriter::Format( const Row & row , std::string & text ) {
+
+	size_t nt = row.wave.size() ;
+	size_t start = text.size() ;
+	text.resize( start + 32*( nt + 6 ) ) ;   //Room for the longest numbers
+	char * p = &text[start] , * p0 = p ;
+
+	p += sprintf( p , "%lu " , (unsigned long) nt ) ;
+	p += sprintf( p , "%g %g 0  %g %g " , row.temp - 273. , row.voltage , row.yShift/1000. , row.height/1000. ) ;
+
+	bool single = row.wave.IsSingle() ;
+	for ( size_t i = 0 ; i < nt ; i++ ) {
+		p = Shortest( p , row.wave[i] , single ) ;
+		*p++ = ' ' ;
+	}
+	*p++ = '\n' ;
+
+	text.resize( start + ( p - p0 ) ) ;
+
+}
+
+/*
+ * Rows go in batches of 64 per thread, so the text held in memory stays small. A batch
+ * is split in nthreads consecutive blocks formatted at once and written in order.
+ */
+/**
+ *
+ * @param rows
+ * @param nthreads
+ */
+void HetctWriter::Write( const std::vector<Row> & rows , int nthreads ) {
+
+	if ( nthreads < 1 ) nthreads = 1 ;
+	std::vector<std::string> text( nthreads ) ;
+
+	size_t batch = 64*nthreads ;
+	for ( size_t b0 = 0 ; b0 < rows.size() ; b0 += batch ) {
+
+		size_t nb = std::min( batch , rows.size() - b0 ) ;
+		auto job = [&] ( int it ) {
+			text[it].clear() ;
+			size_t first = b0 + nb*it/nthreads , last = b0 + nb*( it+1 )/nthreads ;
+			for ( size_t ir = first ; ir < last ; ir++ ) Format( rows[ir] , text[it] ) ;
+		} ;
+
+		std::vector<std::thread> th ;
+		for ( int it = 1 ; it < nthreads ; it++ ) th.push_back( std::thread( job , it ) ) ;
+		job( 0 ) ;
+		for ( size_t it = 0 ; it < th.size() ; it++ ) th[it].join() ;
+
+		for ( int it = 0 ; it < nthreads ; it++ )
+			if ( fwrite( text[it].data() , 1 , text[it].size() , fp ) != text[it].size() ) {
+				std::cout << "Error: write to .hetct file failed" << std::endl ;
+				std::cout << "Exiting!"<< std::endl ;
+				exit(-1);
+			}
+
+	}
+
+}
+
+void HetctWriter::Flush( ) {
+
+	fflush( fp ) ;
+
+}
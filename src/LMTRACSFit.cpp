@@ -0,0 +1,238 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+  Same fit as MfgTRACSFit (same parameters, stages and output.root) but minimizing
+  with Levenberg-Marquardt on the residual vector. The Jacobian columns are simulated
+  concurrently, each one in its own simulation context.
+
+  Example
+
+    LMTRACSFit NumberOfThreads MeasurementFile TRACS.conf "Vbias==200 && Tset == 20"
+
+ */
+
+#include <Minuit2/MnUserParameters.h>
+#include <Minuit2/MnPrint.h>
+
+#include <boost/asio.hpp>
+
+#include <TRACSFit.h>
+#include <TRACSInterface.h>
+#include <TRACSContext.h>
+#include <TRACSLMFit.h>
+#include <TString.h>
+#include <EdgeLayout.h>
+#include <stdio.h>
+
+#include "../include/Global.h"
+
+std::vector<TRACSInterface*> TRACSsim;
+std::vector<std::thread> t;
+TRACSFit *fit ;
+TRACSEvaluator *evaluator ;
+bool irradiated;
+
+using namespace ROOT::Minuit2;
+
+/*
+ * Prints the outcome of a stage the way MfgTRACSFit does.
+ */
+void LMReport( TRACSLMFit & lm , boost::posix_time::ptime start ) {
+
+	MnUserParameters upar( lm.Parameters() , lm.Errors() ) ;
+	for ( int i=0 ; i < (int) lm.Parameters().size() ; i++ ) {
+		char pname[10]; sprintf( pname , "p%d" , i);
+		upar.SetName( i , pname );
+		if ( lm.IsFixed(i) ) upar.Fix(i) ;
+	}
+
+	boost::posix_time::time_duration timeTaken = boost::posix_time::second_clock::local_time() - start ;
+	if (lm.IsValid()) std::cout << "Fit success"         << std::endl ;
+	else              std::cout << "Fit failed"   << std::endl ;
+	std::cout << "Total time: " << timeTaken.total_seconds() << std::endl ;
+	std::cout << "MINIMIZATION OUTCOME: " << std::endl ;
+	std::cout << "  chi2= " << lm.Chi2() << "  edm= " << lm.Edm() << "  iterations= " << lm.NIterations() << "  simulations= " << lm.NFcn() << std::endl ;
+	std::cout << upar << std::endl ;
+
+}
+
+int main( int argc, char *argv[]) {
+
+	std::vector<Double_t> parIni, parErr;
+	std::vector<int> parFix;
+	int nfree;
+
+	//Number of threads
+	num_threads = atoi(argv[1]);
+
+	//Measurement file
+	TString FileMeas = TString( argv[2] ) ;
+
+	//Configuration file
+	TString FileConf = TString( argv[3] ) ;
+	std::string lfnm(argv[3]) ;
+	fnm = lfnm;
+
+	//Restrictions for fits
+	TString how="";
+	if (argc>4) how = TString( argv[4] ) ;
+
+	//First simulation, needed to build the TRACSFit object
+	TRACSsim.resize(num_threads);
+	t.resize(num_threads);
+	t[0] = std::thread(call_from_thread, 0);
+	t[0].join();
+
+	TRACSsim.resize(num_threads);
+	t.resize(num_threads);
+	for (int i = 1; i < num_threads; ++i) {
+		t[i] = std::thread(call_from_thread, i);
+	}
+	for (int i = 1; i < num_threads; ++i) {
+		t[i].join();
+	}
+
+	fit = new TRACSFit( FileMeas, FileConf , how ) ;
+
+	double vBias = TRACSsim[0]->get_vBias();
+	double vDep = TRACSsim[0]->get_vDep();
+	double fluence = TRACSsim[0]->get_fluence();
+	double tolerance = TRACSsim[0]->GetTolerance();
+	irradiated = (fluence > 0) || (vBias < vDep) ;
+
+	if (irradiated) {
+		//Neff, normalizator and depth. Neff parameters 4-7 stay fixed in all stages
+		parIni = TRACSsim[0]->get_NeffParam();
+		parIni.push_back(TRACSsim[0]->get_fitNorm());
+		parIni.push_back(TRACSsim[0]->get_depth());
+		parFix = {4, 5, 6, 7};
+		nfree = 6;
+	}
+	else {
+		//Normalizator, Vdep, depth, Capacitance. Depletion voltage fixed
+		parIni = {TRACSsim[0]->get_fitNorm(), TRACSsim[0]->get_vDep(), TRACSsim[0]->get_depth(), TRACSsim[0]->get_capacitance()};
+		parFix = {1};
+		nfree = 3;
+	}
+	parErr.assign(parIni.size(), 60.);
+
+	std::cout << "=============================================" << std::endl;
+	std::cout << "tolerance= " << tolerance    << std::endl;
+	std::cout << "chiFinal= " << TRACSsim[0]->GetchiFinal()      << std::endl;
+	std::cout << "residuals= " << fit->GetNResiduals()      << std::endl;
+	std::cout << "=============================================" << std::endl;
+
+	//The warm contexts replace the per-evaluation TRACSInterface objects
+	for (uint i = 0; i < TRACSsim.size(); i++) {
+		delete TRACSsim[i];
+		TRACSsim[i] = nullptr;
+	}
+	evaluator = new TRACSEvaluator( fnm , fit , irradiated , nfree , num_threads ) ;
+
+	TRACSLMFit lm( [] ( const std::vector< std::vector<double> > & pars , std::vector< std::vector<double> > & res ) { evaluator->Residuals( pars , res ) ; } ,
+			parIni , parErr ) ;
+	lm.SetTolerance( tolerance ) ;
+	for (uint i = 0; i < parFix.size(); i++) lm.Fix(parFix[i]);
+
+	boost::posix_time::ptime start = boost::posix_time::second_clock::local_time();
+
+	if (irradiated) {
+
+		//Same stages as MfgTRACSFit: first 3, norm and depth; then 0, norm and depth; then all
+		lm.Fix(0) ; lm.Fix(1) ; lm.Fix(2) ;
+		std::cout << "=============================================" << std::endl;
+		std::cout << "First Minimization" << std::endl;
+		std::cout << "=============================================" << std::endl;
+		lm.Minimize() ;
+		LMReport( lm , start ) ;
+
+		lm.Fix(3) ; lm.Release(0) ; lm.SetError(0,60.) ;
+		std::cout << "=============================================" << std::endl;
+		std::cout << "Second Minimization" << std::endl;
+		std::cout << "=============================================" << std::endl;
+		lm.Minimize() ;
+		LMReport( lm , start ) ;
+
+		for ( int i=0 ; i < 4 ; i++ ) { lm.Release(i) ; lm.SetError(i,60.); }
+		std::cout << "=============================================" << std::endl;
+		std::cout << "0-3 par free" << std::endl;
+		std::cout << "=============================================" << std::endl;
+		lm.Minimize() ;
+		LMReport( lm , start ) ;
+
+	}
+	else {
+
+		lm.Minimize() ;
+		LMReport( lm , start ) ;
+
+	}
+
+	//Get the fitting parameters
+	parIni = lm.Parameters() ;
+	parErr = lm.Errors() ;
+	std::cout << "Simulations used by the fit: " << evaluator->GetNCalls() << std::endl ;
+	delete evaluator ;
+
+	//Calculate TCT pulses with the fit output parameters
+	for (int i = 0; i < num_threads; ++i) {
+		if (irradiated) t[i] = std::thread(call_from_thread_FitPar, i, parIni);
+		else t[i] = std::thread(call_from_thread_FitNorm, i, parIni);
+	}
+
+	for (int i = 0; i < num_threads; ++i) {
+		t[i].join();
+	}
+
+	//Dump tree to disk
+	TFile fout("output.root","RECREATE") ;
+	edgelayout::SetCompression( &fout ) ;
+	TTree *tout = new TTree("edge","Fitting results");
+
+	TMeas *emo = new TMeas( );
+	emo->Nt   = TRACSsim[0]->GetnSteps() ;
+	emo->volt = new Double_t [emo->Nt] ;
+	emo->time = new Double_t [emo->Nt] ;
+	emo->Qt   = new Double_t [emo->Nt] ;
+
+	// Create branches
+	edgelayout::Setup( tout ) ;
+	edgelayout::Branch( tout , "raw" , &emo ) ;
+
+	//Read RAW file
+	TRACSsim[0]->DumpToTree( emo , tout ) ;
+
+	fout.Write();
+	delete tout ;
+	fout.Close();
+	delete emo ;
+
+	//Clean
+	for (uint i = 0; i < TRACSsim.size(); i++)	{
+		delete TRACSsim[i];
+	}
+
+	delete fit;
+	std::quick_exit(1);
+}
+
+//_____________________________________________________________________
+
+Double_t TRACSFit::operator() ( const std::vector<Double_t>& par  ) const {
+
+	std::vector<Double_t> chi2 ;
+	evaluator->Chi2( std::vector< std::vector<Double_t> >( 1 , par ) , chi2 ) ;
+	return chi2[0] ;
+
+}
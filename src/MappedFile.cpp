@@ -0,0 +1,275 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************MappedFile***********************************
+ *
+ * The file is mapped once and read sequentially; the kernel is told so, to read ahead.
+ *
+ */
+
+#include <MappedFile.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//Exact powers of ten in a double
+static const double Pow10[] = { 1e0 , 1e1 , 1e2 , 1e3 , 1e4 , 1e5 , 1e6 , 1e7 , 1e8 , 1e9 , 1e10 , 1e11 ,
+		1e12 , 1e13 , 1e14 , 1e15 , 1e16 , 1e17 , 1e18 , 1e19 , 1e20 , 1e21 , 1e22 } ;
+
+static inline bool IsBlank( char c ) {
+
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f' ;
+
+}
+
+/**
+ *
+ * @param filename
+ */
+MappedFile::MappedFile( std::string filename ) : fd( -1 ) , begin( nullptr ) , end( nullptr ) , p( nullptr ) {
+
+	fd = open( filename.c_str() , O_RDONLY ) ;
+	if ( fd < 0 ) return ;
+
+	struct stat st ;
+	if ( fstat( fd , &st ) != 0 ) { close( fd ) ; fd = -1 ; return ; }
+	if ( st.st_size == 0 ) return ;
+
+	void * map = mmap( nullptr , st.st_size , PROT_READ , MAP_PRIVATE , fd , 0 ) ;
+	if ( map == MAP_FAILED ) { close( fd ) ; fd = -1 ; return ; }
+	madvise( map , st.st_size , MADV_SEQUENTIAL ) ;
+
+	begin = p = (const char *) map ;
+	end = begin + st.st_size ;
+
+}
+
+MappedFile::~MappedFile( ) {
+
+	if ( begin != nullptr ) munmap( (void *) begin , end - begin ) ;
+	if ( fd >= 0 ) close( fd ) ;
+
+}
+
+void MappedFile::SkipBlanks( ) {
+
+	while ( p < end && IsBlank( *p ) ) p++ ;
+
+}
+
+/**
+ *
+ * @return
+ */
+bool MappedFile::Eof( ) {
+
+	SkipBlanks( ) ;
+	return p >= end ;
+
+}
+
+/**
+ *
+ * @param line
+ * @return
+ */
+bool MappedFile::GetLine( std::string & line ) {
+
+	if ( p >= end ) { line.clear() ; return false ; }
+	const char * nl = (const char *) memchr( p , '\n' , end - p ) ;
+	if ( nl == nullptr ) nl = end ;
+	line.assign( p , nl ) ;
+	p = ( nl < end ) ? nl+1 : end ;
+	return true ;
+
+}
+
+void MappedFile::SkipLine( ) {
+
+	const char * nl = (const char *) memchr( p , '\n' , end - p ) ;
+	p = ( nl != nullptr ) ? nl+1 : end ;
+
+}
+
+/**
+ *
+ * @param word
+ * @return
+ */
+bool MappedFile::Word( std::string & word ) {
+
+	SkipBlanks( ) ;
+	if ( p >= end ) return false ;
+	const char * s = p ;
+	while ( p < end && !IsBlank( *p ) ) p++ ;
+	word.assign( s , p ) ;
+	return true ;
+
+}
+
+/**
+ *
+ * @param c
+ * @return
+ */
+bool MappedFile::Char( char & c ) {
+
+	SkipBlanks( ) ;
+	if ( p >= end ) return false ;
+	c = *p++ ;
+	return true ;
+
+}
+
+/**
+ *
+ * @param v
+ * @return
+ */
+bool MappedFile::Next( double & v ) {
+
+	SkipBlanks( ) ;
+	const char * q = Parse( p , end , v ) ;
+	if ( q == p ) return false ;
+	p = q ;
+	return true ;
+
+}
+
+/**
+ *
+ * @param v
+ * @return
+ */
+bool MappedFile::Next( int & v ) {
+
+	SkipBlanks( ) ;
+	const char * q = p ;
+	bool neg = false ;
+	if ( q < end && ( *q == '-' || *q == '+' ) ) neg = ( *q++ == '-' ) ;
+	if ( q >= end || *q < '0' || *q > '9' ) return false ;
+	long n = 0 ;
+	while ( q < end && *q >= '0' && *q <= '9' ) n = 10*n + ( *q++ - '0' ) ;
+	v = neg ? -n : n ;
+	p = q ;
+	return true ;
+
+}
+
+/**
+ *
+ * @param v
+ * @return
+ */
+bool MappedFile::Next( unsigned short & v ) {
+
+	int n ;
+	if ( !Next( n ) ) return false ;
+	v = n ;
+	return true ;
+
+}
+
+/*
+ * For what Parse does not convert itself: inf, nan, hexadecimal or not a number at all
+ */
+static const char * Strtod( const char * s , const char * e , double & v ) {
+
+	char buf[64] ;
+	size_t n = 0 ;
+	while ( s+n < e && n < sizeof( buf ) - 1 && !IsBlank( s[n] ) ) { buf[n] = s[n] ; n++ ; }
+	buf[n] = '\0' ;
+	char * stop ;
+	double d = strtod( buf , &stop ) ;
+	if ( stop == buf ) return s ;
+	v = d ;
+	return s + ( stop - buf ) ;
+
+}
+
+/*
+ * Mantissa and exponent are gathered as integers. If the mantissa fits in the 53 bits
+ * of a double and the power of ten is exact, one correctly rounded operation gives the
+ * result (Clinger's fast path); otherwise the token goes to strtod.
+ */
+/**
+ *
+ * @param s
+ * @param e
+ * @param v
+ * @return
+ */
+const char * MappedFile::Parse( const char * s , const char * e , double & v ) {
+
+	const char * q = s ;
+	bool neg = false ;
+	if ( q < e && ( *q == '-' || *q == '+' ) ) neg = ( *q++ == '-' ) ;
+
+	//Hexadecimal
+	if ( q+1 < e && q[0] == '0' && ( q[1] == 'x' || q[1] == 'X' ) ) return Strtod( s , e , v ) ;
+
+	uint64_t m = 0 ;
+	int ndig = 0 , exp10 = 0 ;
+	bool any = false ;
+	while ( q < e && *q >= '0' && *q <= '9' ) {
+		if ( ndig < 19 ) { m = 10*m + ( *q - '0' ) ; if ( m ) ndig++ ; }
+		else exp10++ ;
+		q++ ; any = true ;
+	}
+	if ( q < e && *q == '.' ) {
+		q++ ;
+		while ( q < e && *q >= '0' && *q <= '9' ) {
+			if ( ndig < 19 ) { m = 10*m + ( *q - '0' ) ; if ( m ) ndig++ ; exp10-- ; }
+			q++ ; any = true ;
+		}
+	}
+
+	if ( !any ) return Strtod( s , e , v ) ;
+
+	if ( q < e && ( *q == 'e' || *q == 'E' ) ) {
+		const char * r = q+1 ;
+		bool eneg = false ;
+		if ( r < e && ( *r == '-' || *r == '+' ) ) eneg = ( *r++ == '-' ) ;
+		if ( r < e && *r >= '0' && *r <= '9' ) {
+			int x = 0 ;
+			while ( r < e && *r >= '0' && *r <= '9' ) { if ( x < 100000 ) x = 10*x + ( *r - '0' ) ; r++ ; }
+			exp10 += eneg ? -x : x ;
+			q = r ;
+		}
+	}
+
+	if ( m < ( (uint64_t) 1 << 53 ) && exp10 >= -22 && exp10 <= 22 ) {
+		double d = (double) m ;
+		d = ( exp10 < 0 ) ? d / Pow10[-exp10] : d * Pow10[exp10] ;
+		v = neg ? -d : d ;
+		return q ;
+	}
+
+	//Long mantissa or large exponent
+	char buf[128] ;
+	size_t n = q - s ;
+	if ( n < sizeof( buf ) ) {
+		memcpy( buf , s , n ) ;
+		buf[n] = '\0' ;
+		v = strtod( buf , nullptr ) ;
+	}
+	else v = strtod( std::string( s , q ).c_str() , nullptr ) ;
+	return q ;
+
+}
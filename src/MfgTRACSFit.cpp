@@ -16,6 +16,50 @@
 
     DoTRACSFit MeasurementFile TRACS.conf "Vbias==200 && Tset == 20"
 
+  Adding "minos" (and optionally the number of points of the chi2 scans) after the
+  condition runs the Minos errors and chi2 scans of the free parameters, in parallel
+
+    MfgTRACSFit NumberOfThreads MeasurementFile TRACS.conf "Vbias==200" minos 21
+
+  With journal=FileName every chi2 evaluation of Migrad and the outcome of every stage
+  are appended to FileName. Running the same command after an interruption takes the
+  stages completed from their records (the last one is replayed if minos is asked for)
+  and the evaluations found there are not simulated again, so the interrupted stage
+  picks up where it stopped. The evaluations of gradient, global, surrogate and minos
+  are not journaled.
+
+    MfgTRACSFit NumberOfThreads MeasurementFile TRACS.conf "Vbias==200" journal=fit.jrn
+
+  With ladder=N every minimization starts with quick simulations (mesh cells and
+  time step coarsened, carriers subsampled by N, then N/2, ... 2) and is polished at
+  full fidelity, which alone gives the reported minimum.
+
+    MfgTRACSFit NumberOfThreads MeasurementFile TRACS.conf "Vbias==200" ladder=4
+
+  With global=N the fix/release stages are replaced by a differential evolution search
+  (at most N generations, each one simulated concurrently on all the threads) over all
+  the parameters of the last stage, followed by Migrad from the best point found.
+
+    MfgTRACSFit NumberOfThreads MeasurementFile TRACS.conf "Vbias==200" global=50
+
+  With surrogate=N the stages are replaced by a search on an emulator of the residuals
+  trained on at most N simulations (see TRACSSurrogate), followed by Migrad from its
+  minimum. It can follow global=N, refining the point the global search found.
+
+    MfgTRACSFit NumberOfThreads MeasurementFile TRACS.conf "Vbias==200" surrogate=100
+
+  With gradient Migrad is given the gradient of chi2, all its finite differences
+  simulated at once on npar+1 simulation contexts, instead of computing them one
+  after the other. These evaluations do not go to the journal.
+
+    MfgTRACSFit NumberOfThreads MeasurementFile TRACS.conf "Vbias==200" gradient
+
+  With align=global (or align=event) the simulation is shifted in time to the measurement
+  before every chi2, by the delay maximizing their cross-correlation: one delay for all
+  the events (or one per event). align=global:2.5 limits the search to +-2.5 ns.
+
+    MfgTRACSFit NumberOfThreads MeasurementFile TRACS.conf "Vbias==200" align=global
+
  */
 
 //#include <TApplication.h>
@@ -34,11 +78,21 @@
 #include <Math/MinimizerOptions.h>
 
 #include <boost/asio.hpp>
+#include <cmath>
 
 #include <TRACSFit.h>
 #include <TRACSInterface.h>
+#include <TRACSErrors.h>
+#include <TRACSJournal.h>
+#include <TRACSContext.h>
+#include <TRACSDE.h>
+#include <TRACSSurrogate.h>
 #include <TString.h>
+#include <EdgeLayout.h>
 #include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 
 #include "../include/Global.h"
 
@@ -48,9 +102,192 @@ boost::posix_time::time_duration total_timeTaken ;
 TRACSFit *fit ;
 std::string neffType;
 bool irradiated;
+TRACSJournal *journal = nullptr;
+int fitStage = 0;
+int ladder = 1;
+int global = 0;
+int surrogate = 0;
+bool gradient = false;
+TRACSEvaluator *gradEv = nullptr;
+TRACSGradientFCN *gradFCN = nullptr;
 
 using namespace ROOT::Minuit2;
 
+/*
+ * Journals the outcome of a minimization stage.
+ */
+void JournalStage( const FunctionMinimum & min ) {
+
+	if (journal == nullptr) return;
+	const MnUserParameterState & st = min.UserState();
+	std::vector<bool> fixed;
+	for (uint i = 0; i < st.MinuitParameters().size(); i++) fixed.push_back(st.Parameter(i).IsFixed());
+	journal->RecordStage(fitStage, min.IsValid(), min.Fval(), min.Edm(), min.NFcn(), st.Params(), st.Errors(), fixed);
+
+}
+
+/*
+ * Values and errors stage fitStage ended with in a previous run on the same journal, if it
+ * got that far. Such a stage is not run again.
+ */
+bool ResumeStage( std::vector<double> & val , std::vector<double> & err ) {
+
+	if (journal == nullptr || !journal->GetStage(fitStage, val, err)) return false;
+	std::cout << "Stage " << fitStage << " completed in the journal: not run again" << std::endl;
+	return true;
+
+}
+
+/*
+ * Migrad with the FCN chosen: TRACSFit, or the parallel gradient one built on first use.
+ */
+FunctionMinimum RunMigrad( const MnUserParameters & upar , unsigned int strategy , double tolerance ) {
+
+	if (!gradient) {
+		MnMigrad mn( *fit , upar , MnStrategy(strategy)) ;
+		return mn( 0 , tolerance ) ;
+	}
+
+	if (gradFCN == nullptr) {
+		gradEv = new TRACSEvaluator( fnm , fit , irradiated , upar.Params().size()+1 , num_threads ) ;
+		gradFCN = new TRACSGradientFCN( gradEv ) ;
+	}
+	std::vector<bool> fixed ;
+	for (uint i = 0; i < upar.Params().size(); i++) fixed.push_back( upar.Parameter(i).IsFixed() ) ;
+	gradFCN->SetFixed( fixed ) ;
+	MnMigrad mn( *gradFCN , upar , MnStrategy(strategy)) ;
+	return mn( 0 , tolerance ) ;
+
+}
+
+/*
+ * Migrad on the fidelity ladder. Levels ladder, ladder/2, ... 2 use coarse simulations, each
+ * starting from the minimum of the previous one, with the same tolerance as the last one so that
+ * they stop close to the minimum the promotion test is about. A level moving no free parameter
+ * by more than a tenth of its error promotes straight to full fidelity, where the last
+ * minimization is done as without ladder. A level leaving a free parameter without a positive
+ * error (failed covariance) is not taken as settled.
+ */
+FunctionMinimum LadderMigrad( MnUserParameters upar , unsigned int strategy ) {
+
+	for (int level = ladder; level > 1; level /= 2) {
+
+		fidelity = level ;
+		std::cout << "=============================================" << std::endl;
+		std::cout << "Fidelity 1/" << fidelity << std::endl;
+		std::cout << "=============================================" << std::endl;
+		FunctionMinimum minl = RunMigrad( upar , strategy , 0.1 ) ;
+
+		double shift = 0. ;
+		bool settled = true ;
+		for (uint i = 0; i < upar.Params().size(); i++) {
+			if (upar.Parameter(i).IsFixed() || minl.UserState().Parameter(i).IsFixed()) continue ;
+			double err = minl.UserState().Error(i) ;
+			if ( err > 0. && std::isfinite( err ) ) {
+				double d = std::abs( minl.UserState().Value(i) - upar.Value(i) ) / err ;
+				if (d > shift) shift = d ;
+				upar.SetError( i , err ) ;
+			}
+			else settled = false ;
+			upar.SetValue( i , minl.UserState().Value(i) ) ;
+		}
+		std::cout << "Fidelity 1/" << level << " minimum: chi2= " << minl.Fval() << " edm= " << minl.Edm() << " largest shift (errors)= " << shift << std::endl;
+		if (settled && shift < 0.1) break ;
+
+	}
+
+	fidelity = 1 ;
+	return RunMigrad( upar , strategy , 0.1 ) ;
+
+}
+
+/*
+ * Differential evolution over the free parameters of upar, within +-max(|value|,error) of
+ * their values. upar is left at the best point, with the spread of the final population
+ * as errors.
+ */
+void GlobalSearch( MnUserParameters & upar ) {
+
+	boost::posix_time::ptime start = boost::posix_time::second_clock::local_time();
+
+	std::vector<double> low, high;
+	int nfree = 0;
+	for (uint i = 0; i < upar.Params().size(); i++) {
+		double w = std::max( std::abs( upar.Value(i) ) , upar.Error(i) ) ;
+		low.push_back( upar.Value(i) - w ) ;
+		high.push_back( upar.Value(i) + w ) ;
+		if (!upar.Parameter(i).IsFixed()) nfree++ ;
+	}
+
+	//One single-threaded context per thread, the population a multiple of them
+	TRACSEvaluator ev( fnm , fit , irradiated , num_threads , num_threads ) ;
+	int nc = ev.GetNContexts() ;
+	TRACSDE de( [&] ( const std::vector< std::vector<double> > & pars , std::vector<double> & chi2 ) { ev.Chi2( pars , chi2 ) ; } ,
+			upar.Params() , low , high ) ;
+	for (uint i = 0; i < upar.Params().size(); i++) if (upar.Parameter(i).IsFixed()) de.Fix(i) ;
+	de.SetPopulation( ( ( 10*nfree + nc - 1 ) / nc ) * nc ) ;
+	de.SetMaxGenerations( global ) ;
+	de.SetTolerance( TRACSsim[0]->GetTolerance() ) ;
+
+	std::cout << "=============================================" << std::endl;
+	std::cout << "Global search: " << upar << std::endl;
+	std::cout << "=============================================" << std::endl;
+	bool converged = de.Minimize() ;
+
+	std::vector<double> spread = de.Spread() ;
+	for (uint i = 0; i < upar.Params().size(); i++) {
+		if (upar.Parameter(i).IsFixed()) continue ;
+		upar.SetValue( i , de.Parameters()[i] ) ;
+		if (spread[i] > 0.) upar.SetError( i , spread[i] ) ;
+	}
+
+	boost::posix_time::time_duration timeTaken = boost::posix_time::second_clock::local_time() - start ;
+	if (converged) std::cout << "Global search converged" << std::endl ;
+	else           std::cout << "Global search stopped after " << de.NGenerations() << " generations" << std::endl ;
+	std::cout << "Total time: " << timeTaken.total_seconds() << std::endl ;
+	std::cout << "  chi2= " << de.Chi2() << "  simulations= " << de.NFcn() << std::endl ;
+
+}
+
+/*
+ * Minimization of the free parameters of upar on the emulator of the residuals, using at
+ * most surrogate simulations. upar is left at the minimum found, with the emulator errors.
+ */
+void SurrogateSearch( MnUserParameters & upar ) {
+
+	boost::posix_time::ptime start = boost::posix_time::second_clock::local_time();
+
+	int nfree = 0;
+	for (uint i = 0; i < upar.Params().size(); i++) if (!upar.Parameter(i).IsFixed()) nfree++ ;
+
+	//As many contexts as points in the initial design, each batch one point per context
+	TRACSEvaluator ev( fnm , fit , irradiated , 2*nfree+1 , num_threads ) ;
+	TRACSSurrogate sur( [&] ( const std::vector< std::vector<double> > & pars , std::vector< std::vector<double> > & res ) { ev.Residuals( pars , res ) ; } ,
+			upar.Params() , upar.Errors() ) ;
+	for (uint i = 0; i < upar.Params().size(); i++) if (upar.Parameter(i).IsFixed()) sur.Fix(i) ;
+	sur.SetBatch( ev.GetNContexts() ) ;
+	sur.SetMaxSimulations( surrogate ) ;
+	sur.SetTolerance( TRACSsim[0]->GetTolerance() ) ;
+
+	std::cout << "=============================================" << std::endl;
+	std::cout << "Surrogate search: " << upar << std::endl;
+	std::cout << "=============================================" << std::endl;
+	bool converged = sur.Minimize() ;
+
+	for (uint i = 0; i < upar.Params().size(); i++) {
+		if (upar.Parameter(i).IsFixed()) continue ;
+		upar.SetValue( i , sur.Parameters()[i] ) ;
+		if (sur.Errors()[i] > 0.) upar.SetError( i , sur.Errors()[i] ) ;
+	}
+
+	boost::posix_time::time_duration timeTaken = boost::posix_time::second_clock::local_time() - start ;
+	if (converged) std::cout << "Surrogate search converged" << std::endl ;
+	else           std::cout << "Surrogate search stopped after " << sur.NFcn() << " simulations" << std::endl ;
+	std::cout << "Total time: " << timeTaken.total_seconds() << std::endl ;
+	std::cout << "  chi2= " << sur.Chi2() << "  simulations= " << sur.NFcn() << std::endl ;
+
+}
+
 int main( int argc, char *argv[]) {
 
 	double fitParamVdep;
@@ -82,6 +319,42 @@ int main( int argc, char *argv[]) {
 	TString how="";
 	if (argc>2) how = TString( argv[4] ) ;
 
+	//Options after the condition: minos [points of the chi2 scans], journal=FileName, ladder=N, global=N, surrogate=N, gradient, align=global|event[:ns]
+	bool doErrors = false ;
+	unsigned int nScan = 21 ;
+	std::string journalFile = "" ;
+	std::string align = "" ;
+	for (int i = 5; i < argc; i++) {
+		std::string opt( argv[i] ) ;
+		if (opt == "minos") doErrors = true ;
+		else if (opt == "gradient") gradient = true ;
+		else if (opt.compare(0, 6, "align=") == 0) align = opt.substr(6) ;
+		else if (opt.compare(0, 8, "journal=") == 0) journalFile = opt.substr(8) ;
+		else if (opt.compare(0, 7, "ladder=") == 0) ladder = atoi(opt.substr(7).c_str()) ;
+		else if (opt.compare(0, 7, "global=") == 0) global = atoi(opt.substr(7).c_str()) ;
+		else if (opt.compare(0, 10, "surrogate=") == 0) surrogate = atoi(opt.substr(10).c_str()) ;
+		else if (doErrors) nScan = atoi(argv[i]) ;
+	}
+
+	//align=global|event[:ns]
+	std::string alignMode = align.substr(0, align.find(':')) ;
+	double maxShift = (align.find(':') == std::string::npos) ? 0. : atof(align.substr(align.find(':')+1).c_str()) ;
+	if (align != "" && alignMode != "global" && alignMode != "event") {
+		std::cout << "Unknown alignment " << align << " (align=global|event[:ns])" << std::endl ;
+		std::cout << "Exiting!" << std::endl ;
+		exit(-1) ;
+	}
+
+	//The journal only serves fits of the same measurement, condition, alignment and steering file
+	if (journalFile != "") {
+		std::ifstream fconf( fnm.c_str() ) ;
+		std::stringstream sconf ;
+		sconf << fconf.rdbuf() ;
+		std::stringstream salign ;
+		if (align != "") salign << "align=" << alignMode << ":" << maxShift << "\n" ;
+		journal = new TRACSJournal( journalFile , std::string( FileMeas.Data() ) + "\n" + how.Data() + "\n" + salign.str() + sconf.str() ) ;
+	}
+
 	TRACSsim.resize(num_threads);
 	t.resize(num_threads);
 	t[0] = std::thread(call_from_thread, 0);
@@ -97,6 +370,7 @@ int main( int argc, char *argv[]) {
 	}
 
 	fit = new TRACSFit( FileMeas, FileConf , how ) ;
+	if (align != "") fit->SetAlignment( (alignMode == "event") ? TRACSFit::kAlignEvent : TRACSFit::kAlignGlobal , maxShift ) ;
 
 	neffType = TRACSsim[0]->get_neff_type();
 	vBias = TRACSsim[0]->get_vBias();
@@ -153,28 +427,41 @@ int main( int argc, char *argv[]) {
 
 		ROOT::Math::MinimizerOptions::SetDefaultPrintLevel(1);
 		ROOT::Math::MinimizerOptions::SetDefaultTolerance(TRACSsim[0]->GetTolerance());
-		MnMigrad mn( *fit , upar , MnStrategy(1)) ;
-		FunctionMinimum min = mn() ;
-
-		//Status report
-		std::cout << "Total time: " << total_timeTaken.total_seconds() << std::endl ;
-		std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
-
-		//Release parameter 3, fix 0, minimize again
-		upar.SetValue(3, min.UserState().Value(3) ) ; upar.SetError(3, min.UserState().Error(3)) ; upar.Fix(3) ;
-		upar.Release(0) ; upar.SetError(0,60.);
-
-		std::cout << "=============================================" << std::endl;
-		std::cout<<"Second Minimization: "<<upar<<std::endl;
-		std::cout << "=============================================" << std::endl;
-		MnMigrad mnr( *fit , upar , MnStrategy(0)) ;
-		min = mnr() ;
+		if (global == 0 && surrogate == 0) {
+
+			fitStage = 1 ;
+			std::vector<double> val , err ;
+			if (!ResumeStage( val , err )) {
+				FunctionMinimum min = LadderMigrad( upar , 1 ) ;
+				JournalStage( min ) ;
+				val = min.UserState().Params() ;
+				err = min.UserState().Errors() ;
+
+				//Status report
+				std::cout << "Total time: " << total_timeTaken.total_seconds() << std::endl ;
+				std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
+			}
+
+			//Release parameter 3, fix 0, minimize again
+			upar.SetValue(3, val[3] ) ; upar.SetError(3, err[3]) ; upar.Fix(3) ;
+			upar.Release(0) ; upar.SetError(0,60.);
+
+			std::cout << "=============================================" << std::endl;
+			std::cout<<"Second Minimization: "<<upar<<std::endl;
+			std::cout << "=============================================" << std::endl;
+			fitStage = 2 ;
+			if (!ResumeStage( val , err )) {
+				FunctionMinimum min = LadderMigrad( upar , 0 ) ;
+				JournalStage( min ) ;
+
+				//Status report
+				if (min.IsValid()) std::cout << "Fit success"         << std::endl ;
+				else               std::cout << "Fit failed"   << std::endl ;
+				std::cout << "Total time: " << total_timeTaken.total_seconds() << std::endl ;
+				std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
+			}
 
-		//Status report
-		if (min.IsValid()) std::cout << "Fit success"         << std::endl ;
-		else               std::cout << "Fit failed"   << std::endl ;
-		std::cout << "Total time: " << total_timeTaken.total_seconds() << std::endl ;
-		std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
+		}
 
 		//Release parameter 0,1,2,3 minimize again
 		for ( int i=0 ; i < 4 ; i++ ) { upar.Release(i) ; upar.SetError(i,60.); }
@@ -182,21 +469,35 @@ int main( int argc, char *argv[]) {
 		std::cout << "=============================================" << std::endl;
 		std::cout<<"0-3 par free: "<<upar<<std::endl;
 		std::cout << "=============================================" << std::endl;
-		MnMigrad mn3( *fit , upar , MnStrategy(0)) ;
-		min = mn3() ;
-
-		//Status report
-		if (min.IsValid()) std::cout << "Fit success"         << std::endl ;
-		else               std::cout << "Fit failed"   << std::endl ;
-		std::cout << "Total time: " << total_timeTaken.total_seconds() << std::endl ;
-		std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
-
-
-
-		//Get the fitting parameters
-		for (uint i=0; i < parIniSize;i++) {
-			parIni[i]=min.UserState().Value(i);
-			parErr[i]=min.UserState().Error(i);
+		fitStage = 3 ;
+		std::vector<double> val , err ;
+		//Minos needs the FunctionMinimum: with minos the last stage is replayed from the journal
+		if (!doErrors && ResumeStage( val , err )) {
+			parIni = val ;
+			parErr = err ;
+		}
+		else {
+			//Or look for the minimum with the global and/or surrogate searches instead of the stages above
+			if (global > 0) GlobalSearch( upar ) ;
+			if (surrogate > 0) SurrogateSearch( upar ) ;
+
+			FunctionMinimum min = LadderMigrad( upar , 0 ) ;
+			JournalStage( min ) ;
+
+			//Status report
+			if (min.IsValid()) std::cout << "Fit success"         << std::endl ;
+			else               std::cout << "Fit failed"   << std::endl ;
+			std::cout << "Total time: " << total_timeTaken.total_seconds() << std::endl ;
+			std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
+
+			//Minos errors and chi2 scans
+			if (doErrors) ErrorAnalysis( fnm , fit , irradiated , min , num_threads , nScan ) ;
+
+			//Get the fitting parameters
+			for (uint i=0; i < parIniSize;i++) {
+				parIni[i]=min.UserState().Value(i);
+				parErr[i]=min.UserState().Error(i);
+			}
 		}
 	}
 	/*********Finish Irradiated/undepleted fit******************************************/
@@ -250,19 +551,32 @@ int main( int argc, char *argv[]) {
 
 		ROOT::Math::MinimizerOptions::SetDefaultPrintLevel(1);
 		ROOT::Math::MinimizerOptions::SetDefaultTolerance(TRACSsim[0]->GetTolerance());
-		MnMigrad mn( *fit , upar , MnStrategy(0)) ;
-		FunctionMinimum min = mn() ;
-
-		//Status report
-		if (min.IsValid()) std::cout << "Fit success"         << std::endl ;
-		else               std::cout << "Fit failed"   << std::endl ;
-		std::cout << "Total time: " << total_timeTaken.total_seconds() << std::endl ;
-		std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
-
-		//Get the fitting parameters
-		for (uint i=0; i < parIniSize;i++) {
-			parIni[i]=min.UserState().Value(i);
-			parErr[i]=min.UserState().Error(i);
+		fitStage = 4 ;
+		std::vector<double> val , err ;
+		if (!doErrors && ResumeStage( val , err )) {
+			parIni = val ;
+			parErr = err ;
+		}
+		else {
+			if (global > 0) GlobalSearch( upar ) ;
+			if (surrogate > 0) SurrogateSearch( upar ) ;
+			FunctionMinimum min = LadderMigrad( upar , 0 ) ;
+			JournalStage( min ) ;
+
+			//Status report
+			if (min.IsValid()) std::cout << "Fit success"         << std::endl ;
+			else               std::cout << "Fit failed"   << std::endl ;
+			std::cout << "Total time: " << total_timeTaken.total_seconds() << std::endl ;
+			std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
+
+			//Minos errors and chi2 scans
+			if (doErrors) ErrorAnalysis( fnm , fit , irradiated , min , num_threads , nScan ) ;
+
+			//Get the fitting parameters
+			for (uint i=0; i < parIniSize;i++) {
+				parIni[i]=min.UserState().Value(i);
+				parErr[i]=min.UserState().Error(i);
+			}
 		}
 	}
 
@@ -283,6 +597,7 @@ int main( int argc, char *argv[]) {
 
 	//Dump tree to disk
 	TFile fout("output.root","RECREATE") ;
+	edgelayout::SetCompression( &fout ) ;
 	TTree *tout = new TTree("edge","Fitting results");
 
 	TMeas *emo = new TMeas( );
@@ -292,7 +607,8 @@ int main( int argc, char *argv[]) {
 	emo->Qt   = new Double_t [emo->Nt] ;
 
 	// Create branches
-	tout->Branch("raw", &emo,32000,0);
+	edgelayout::Setup( tout ) ;
+	edgelayout::Branch( tout , "raw" , &emo ) ;
 
 	//Read RAW file
 	TRACSsim[0]->DumpToTree( emo , tout ) ;
@@ -308,7 +624,10 @@ int main( int argc, char *argv[]) {
 		delete TRACSsim[i];
 	}
 
+	delete gradFCN;
+	delete gradEv;
 	delete fit;
+	delete journal;
 	std::quick_exit(1);
 }
 
@@ -317,6 +636,16 @@ int main( int argc, char *argv[]) {
 Double_t TRACSFit::operator() ( const std::vector<Double_t>& par  ) const {
 
 	static int icalls ;
+
+	//Already evaluated, in this run or in the journaled ones. Coarse evaluations are kept apart
+	Double_t chi2 ;
+	std::vector<Double_t> jpar( par ) ;
+	if (fidelity > 1) jpar.push_back( fidelity ) ;
+	if (journal != nullptr && journal->Lookup( jpar , chi2 )) {
+		std::cout << "----------------------------> journal chi2=" << chi2 << std::endl;
+		return chi2 ;
+	}
+
 	boost::posix_time::ptime start = boost::posix_time::second_clock::local_time();
 
 	for (int i = 0; i < num_threads; ++i) {
@@ -328,7 +657,8 @@ Double_t TRACSFit::operator() ( const std::vector<Double_t>& par  ) const {
 		t[i].join();
 	}
 
-	Double_t chi2 = fit->LeastSquares( ) ;
+	chi2 = fit->LeastSquares( ) ;
+	if (journal != nullptr) journal->Record( fitStage , jpar , chi2 ) ;
 	boost::posix_time::ptime end = boost::posix_time::microsec_clock::local_time();
 	boost::posix_time::time_duration timeTaken = end - start;
 	total_timeTaken += timeTaken;
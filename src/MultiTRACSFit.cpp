@@ -0,0 +1,288 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+  Combined fit of several datasets (measurement file, steering file and condition,
+  typically one per bias voltage) sharing the same parameters. At every evaluation
+  the datasets are simulated at the same time, each one in its own simulation context,
+  and the chi2 minimized is the sum of their chi2. Parameters and stages are those
+  of MfgTRACSFit, taken from the steering file of the first dataset.
+
+  Example
+
+    MultiTRACSFit NumberOfThreads Datasets.txt
+
+  where Datasets.txt holds one dataset per line (lines starting with # are ignored):
+
+    MeasurementFile200.root  TRACS_200V.conf  Vbias==200 && Tset == 20
+    MeasurementFile300.root  TRACS_300V.conf  Vbias==300 && Tset == 20
+
+  Fitted pulses are written to output.root, tree edgeN for the N-th dataset.
+
+ */
+
+#include <Minuit2/FunctionMinimum.h>
+#include <Minuit2/MnUserParameters.h>
+#include <Minuit2/MnPrint.h>
+#include <Minuit2/MnMigrad.h>
+#include <Minuit2/MnStrategy.h>
+#include <Minuit2/FCNBase.h>
+#include <Math/MinimizerOptions.h>
+
+#include <boost/asio.hpp>
+
+#include <TRACSFit.h>
+#include <TRACSInterface.h>
+#include <TRACSContext.h>
+#include <TString.h>
+#include <EdgeLayout.h>
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+
+#include "../include/Global.h"
+
+std::vector<TRACSInterface*> TRACSsim;
+std::vector<std::thread> t;
+std::vector<TRACSContext*> contexts ;
+std::vector<TRACSFit*> fits ;
+bool irradiated;
+
+using namespace ROOT::Minuit2;
+
+/*
+ * Runs job(d) for every dataset d, all of them at once.
+ */
+void ForAllDatasets( std::function<void( int )> job ) {
+
+	std::vector<std::thread> th( contexts.size() ) ;
+	for ( uint d = 0 ; d < contexts.size() ; d++ ) th[d] = std::thread( job , d ) ;
+	for ( uint d = 0 ; d < contexts.size() ; d++ ) th[d].join() ;
+
+}
+
+/*
+ * Sum of the chi2 of all the datasets.
+ */
+class MultiTRACSFCN : public FCNBase {
+
+  public:
+
+     virtual Double_t operator( )( const std::vector<Double_t> & par ) const {
+
+        std::vector<Double_t> chi2( contexts.size() ) ;
+        ForAllDatasets( [&] ( int d ) { chi2[d] = contexts[d]->Chi2( fits[d] , par , irradiated ) ; } ) ;
+
+        Double_t sum = 0. ;
+        for ( uint d = 0 ; d < chi2.size() ; d++ ) sum += chi2[d] ;
+        return sum ;
+
+     } ;
+
+     virtual Double_t Up( ) const { return 1. ; } ;
+
+};
+
+/*
+ * Prints the outcome of a stage the way MfgTRACSFit does.
+ */
+void Report( const FunctionMinimum & min , boost::posix_time::ptime start ) {
+
+	boost::posix_time::time_duration timeTaken = boost::posix_time::second_clock::local_time() - start ;
+	if (min.IsValid()) std::cout << "Fit success"         << std::endl ;
+	else               std::cout << "Fit failed"   << std::endl ;
+	std::cout << "Total time: " << timeTaken.total_seconds() << std::endl ;
+	std::cout << "MINIMIZATION OUTCOME: " <<  min  << std::endl ;
+
+}
+
+int main( int argc, char *argv[]) {
+
+	std::vector<Double_t> parIni, parErr;
+	std::vector<TString> FileMeas, FileConf, how ;
+
+	//Number of threads
+	num_threads = atoi(argv[1]);
+
+	//Datasets: measurement file, configuration file and condition
+	std::ifstream in( argv[2] ) ;
+	if ( !in.good() ) {
+		std::cout << "Error: cannot open dataset list " << argv[2] << std::endl ;
+		std::cout << "Exiting!"<< std::endl ;
+		exit(-1);
+	}
+	std::string line ;
+	while ( std::getline( in , line ) ) {
+		std::istringstream ss( line ) ;
+		std::string meas , conf , cond ;
+		if ( !( ss >> meas >> conf ) || meas[0] == '#' ) continue ;
+		std::getline( ss , cond ) ;
+		size_t b = cond.find_first_not_of( " \t\"" ) , e = cond.find_last_not_of( " \t\"" ) ;
+		cond = ( b == std::string::npos ) ? "" : cond.substr( b , e-b+1 ) ;
+		FileMeas.push_back( TString( meas ) ) ;
+		FileConf.push_back( TString( conf ) ) ;
+		how.push_back( TString( cond ) ) ;
+	}
+	in.close() ;
+	int ndata = FileMeas.size() ;
+	if ( ndata == 0 ) {
+		std::cout << "Error: no datasets in " << argv[2] << std::endl ;
+		std::cout << "Exiting!"<< std::endl ;
+		exit(-1);
+	}
+	fnm = std::string( FileConf[0].Data() ) ;
+
+	//The threads are shared among the datasets
+	int nparts = ( num_threads / ndata > 0 ) ? num_threads / ndata : 1 ;
+	std::cout << "Fitting " << ndata << " datasets with " << nparts << " threads each" << std::endl;
+	for ( int d = 0 ; d < ndata ; d++ ) contexts.push_back( new TRACSContext( std::string( FileConf[d].Data() ) , nparts ) ) ;
+
+	TRACSInterface *sim0 = contexts[0]->GetInterface() ;
+	double vBias = sim0->get_vBias();
+	double vDep = sim0->get_vDep();
+	double fluence = sim0->get_fluence();
+	double tolerance = sim0->GetTolerance();
+	irradiated = (fluence > 0) || (vBias < vDep) ;
+
+	if (irradiated) {
+		parIni = sim0->get_NeffParam();
+		parIni.push_back(sim0->get_fitNorm());
+		parIni.push_back(sim0->get_depth());
+	}
+	else parIni = {sim0->get_fitNorm(), sim0->get_vDep(), sim0->get_depth(), sim0->get_capacitance()};
+	parErr.assign(parIni.size(), 60.);
+
+	//First simulation of every dataset, needed to build its TRACSFit object
+	ForAllDatasets( [&] ( int d ) { contexts[d]->Simulate( parIni , irradiated ) ; } ) ;
+	fits.resize( ndata ) ;
+	for ( int d = 0 ; d < ndata ; d++ ) fits[d] = new TRACSFit( FileMeas[d] , FileConf[d] , how[d] , contexts[d]->GetInterface() ) ;
+
+	MnUserParameters upar(parIni,parErr) ;
+	for ( int i=0 ; i < (int) parIni.size() ; i++ ) {
+		char pname[10]; sprintf( pname , "p%d" , i);
+		upar.SetName( i , pname );
+	}
+
+	std::cout << "=============================================" << std::endl;
+	std::cout << "tolerance= " << tolerance    << std::endl;
+	for ( int d = 0 ; d < ndata ; d++ ) std::cout << "dataset " << d << ": " << FileMeas[d] << " " << FileConf[d] << " \"" << how[d] << "\" residuals= " << fits[d]->GetNResiduals() << std::endl;
+	std::cout << "=============================================" << std::endl;
+
+	ROOT::Math::MinimizerOptions::SetDefaultPrintLevel(1);
+	ROOT::Math::MinimizerOptions::SetDefaultTolerance(tolerance);
+	boost::posix_time::ptime start = boost::posix_time::second_clock::local_time();
+	MultiTRACSFCN fcn ;
+
+	if (irradiated) {
+
+		//Same stages as MfgTRACSFit: first 3, norm and depth; then 0, norm and depth; then all
+		upar.Fix(0) ; upar.Fix(1) ; upar.Fix(2) ;
+		upar.Fix(4) ; upar.Fix(5); upar.Fix(6) ; upar.Fix(7);
+		std::cout << "=============================================" << std::endl;
+		std::cout << "Initial parameters: "<<upar<<std::endl;
+		std::cout << "=============================================" << std::endl;
+		//Strategies as in MfgTRACSFit: 1 for the first stage, 0 (fewer FCN calls) for the rest
+		MnMigrad mnm1( fcn , upar , MnStrategy(1) ) ;
+		FunctionMinimum min = mnm1() ;
+		Report( min , start ) ;
+
+		upar.SetValue(3, min.UserState().Value(3) ) ; upar.SetError(3, min.UserState().Error(3)) ; upar.Fix(3) ;
+		upar.Release(0) ; upar.SetError(0,60.);
+		std::cout << "=============================================" << std::endl;
+		std::cout<<"Second Minimization: "<<upar<<std::endl;
+		std::cout << "=============================================" << std::endl;
+		MnMigrad mnm2( fcn , upar , MnStrategy(0) ) ;
+		min = mnm2() ;
+		Report( min , start ) ;
+
+		for ( int i=0 ; i < 4 ; i++ ) { upar.Release(i) ; upar.SetError(i,60.); }
+		std::cout << "=============================================" << std::endl;
+		std::cout<<"0-3 par free: "<<upar<<std::endl;
+		std::cout << "=============================================" << std::endl;
+		MnMigrad mnm3( fcn , upar , MnStrategy(0) ) ;
+		min = mnm3() ;
+		Report( min , start ) ;
+
+		parIni = min.UserState().Params() ;
+		parErr = min.UserState().Errors() ;
+
+	}
+	else {
+
+		upar.Fix(1); //Depletion voltage
+		std::cout << "=============================================" << std::endl;
+		std::cout << "Initial parameters: "<<upar<<std::endl;
+		std::cout << "=============================================" << std::endl;
+		MnMigrad mnm( fcn , upar , MnStrategy(0) ) ;
+		FunctionMinimum min = mnm() ;
+		Report( min , start ) ;
+
+		parIni = min.UserState().Params() ;
+		parErr = min.UserState().Errors() ;
+
+	}
+
+	int nsim = 0 ;
+	for ( int d = 0 ; d < ndata ; d++ ) nsim += contexts[d]->GetNSimulations() ;
+	std::cout << "Simulations used by the fit: " << nsim << std::endl ;
+
+	//Calculate TCT pulses with the fit output parameters
+	ForAllDatasets( [&] ( int d ) { contexts[d]->Simulate( parIni , irradiated ) ; } ) ;
+
+	//Dump trees to disk, one per dataset
+	TFile fout("output.root","RECREATE") ;
+	edgelayout::SetCompression( &fout ) ;
+	for ( int d = 0 ; d < ndata ; d++ ) {
+
+		TTree *tout = new TTree( TString::Format( "edge%d" , d ) , "Fitting results" );
+
+		TMeas *emo = new TMeas( );
+		emo->Nt   = contexts[d]->GetInterface()->GetnSteps() ;
+		emo->volt = new Double_t [emo->Nt] ;
+		emo->time = new Double_t [emo->Nt] ;
+		emo->Qt   = new Double_t [emo->Nt] ;
+
+		// Create branches
+		edgelayout::Setup( tout ) ;
+		edgelayout::Branch( tout , "raw" , &emo ) ;
+
+		contexts[d]->GetInterface()->DumpToTree( emo , tout ) ;
+
+		tout->Write();
+		delete tout ;
+		delete emo ;
+
+	}
+	fout.Close();
+
+	//Clean
+	for ( int d = 0 ; d < ndata ; d++ ) {
+		delete fits[d] ;
+		delete contexts[d] ;
+	}
+
+	std::quick_exit(1);
+}
+
+//_____________________________________________________________________
+
+/*
+ * chi2 of this dataset alone
+ */
+Double_t TRACSFit::operator() ( const std::vector<Double_t>& par  ) const {
+
+	for ( uint d = 0 ; d < fits.size() ; d++ )
+		if ( fits[d] == this ) return contexts[d]->Chi2( fits[d] , par , irradiated ) ;
+	return 0. ;
+
+}
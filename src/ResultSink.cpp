@@ -0,0 +1,212 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************ResultSink***********************************
+ *
+ * The queue is a ring of slots, each one with a sequence number telling whether it is
+ * free for the push of turn pos (seq == pos) or holds the item of that push, ready to
+ * be popped (seq == pos+1). Producers claim a turn with a compare and swap on head;
+ * the only consumer is the writer thread, which sends the rows in batches to an
+ * EdgeTreeWriter and, for the text export, to a HetctWriter.
+ *
+ */
+
+#include <ResultSink.h>
+
+#include <iostream>
+#include <chrono>
+
+/**
+ *
+ * @param hetct
+ * @param single
+ * @param capacity
+ * @param window
+ */
+ResultSink::ResultSink( bool hetct , bool single , size_t capacity , size_t window ) : head( 0 ) , tail( 0 ) , next( 0 ) , window( window ) , hetct( hetct ) , single( single ) , out( nullptr ) ,
+	emh( nullptr ) , tree( nullptr ) , closing( false ) , nwritten( 0 ) {
+
+	size_t n = 2 ;
+	while ( n < capacity ) n *= 2 ;
+	slots = std::vector<Slot>( n ) ;
+	for ( size_t i = 0 ; i < n ; i++ ) slots[i].seq.store( i , std::memory_order_relaxed ) ;
+	mask = n-1 ;
+
+}
+
+ResultSink::~ResultSink( ) {
+
+	Close( ) ;
+
+}
+
+/*
+ * Waits while row is window or more past the next row to write, then while the queue
+ * is full.
+ */
+/**
+ *
+ * @param row
+ * @param w
+ * @param temp
+ * @param yShift
+ * @param height
+ * @param voltage
+ */
+void ResultSink::Push( size_t row , const std::valarray<double> & w , double temp , double yShift , double height , double voltage ) {
+
+	while ( row >= next.load( std::memory_order_acquire ) + window ) std::this_thread::sleep_for( std::chrono::microseconds( 200 ) ) ;
+
+	size_t pos = head.load( std::memory_order_relaxed ) ;
+	Slot * s ;
+	for ( ;; ) {
+		s = &slots[pos & mask] ;
+		size_t seq = s->seq.load( std::memory_order_acquire ) ;
+		long dif = (long) seq - (long) pos ;
+		if ( dif == 0 ) {
+			if ( head.compare_exchange_weak( pos , pos+1 , std::memory_order_relaxed ) ) break ;
+		}
+		else if ( dif < 0 ) {
+			std::this_thread::yield() ;   //Full
+			pos = head.load( std::memory_order_relaxed ) ;
+		}
+		else pos = head.load( std::memory_order_relaxed ) ;
+	}
+
+	Item & it = s->item ;
+	it.row = row ;
+	it.temp = temp ; it.yShift = yShift ; it.height = height ; it.voltage = voltage ;
+	if ( single ) it.ssamples.assign( std::begin( w ) , std::end( w ) ) ;
+	else          it.samples.assign( std::begin( w ) , std::end( w ) ) ;
+	s->seq.store( pos+1 , std::memory_order_release ) ;
+
+}
+
+/*
+ * Writer thread only. The samples of item and of the slot are swapped, so the slot
+ * keeps a vector to fill at the next turn.
+ */
+/**
+ *
+ * @param item
+ * @return
+ */
+bool ResultSink::Pop( Item & item ) {
+
+	size_t pos = tail.load( std::memory_order_relaxed ) ;
+	Slot & s = slots[pos & mask] ;
+	if ( s.seq.load( std::memory_order_acquire ) != pos+1 ) return false ;
+
+	item.row = s.item.row ;
+	item.temp = s.item.temp ; item.yShift = s.item.yShift ; item.height = s.item.height ; item.voltage = s.item.voltage ;
+	item.samples.swap( s.item.samples ) ;
+	item.ssamples.swap( s.item.ssamples ) ;
+
+	tail.store( pos+1 , std::memory_order_relaxed ) ;
+	s.seq.store( pos+mask+1 , std::memory_order_release ) ;
+	return true ;
+
+}
+
+/**
+ *
+ * @param filename
+ * @param emh
+ */
+void ResultSink::Open( std::string filename , TMeasHeader * emh ) {
+
+	size_t idot = filename.rfind( ".hetct" ) ;
+	rootname = filename.substr( 0 , idot ) + ".root" ;
+	this->emh = emh ;
+	if ( hetct ) out = new HetctWriter( filename ) ;
+	writer = std::thread( &ResultSink::Writer , this ) ;
+
+}
+
+void ResultSink::Close( ) {
+
+	if ( !writer.joinable() ) return ;
+	closing = true ;
+	writer.join() ;
+	delete tree ;
+	tree = nullptr ;
+	delete out ;
+	out = nullptr ;
+
+}
+
+void ResultSink::Writer( ) {
+
+	tree = new EdgeTreeWriter( rootname , emh ) ;
+
+	Item item ;
+	std::vector<Item> ready ;
+	bool dirty = false ;
+	for ( ;; ) {
+
+		if ( Pop( item ) ) {
+			if ( item.row != next ) {
+				pending[item.row] = std::move( item ) ;
+				continue ;
+			}
+			ready.push_back( std::move( item ) ) ;
+			next++ ;
+			std::map<size_t,Item>::iterator it ;
+			while ( ( it = pending.find( next ) ) != pending.end() ) {
+				ready.push_back( std::move( it->second ) ) ;
+				pending.erase( it ) ;
+				next++ ;
+			}
+			if ( ready.size() >= 64 ) Write( ready ) ;
+			dirty = true ;
+			continue ;
+		}
+
+		//Queue dry: make what is written safe, then wait for more
+		if ( closing && head.load() == tail.load( std::memory_order_relaxed ) ) break ;
+		if ( dirty ) { Write( ready ) ; if ( out ) out->Flush() ; dirty = false ; }
+		std::this_thread::sleep_for( std::chrono::microseconds( 200 ) ) ;
+
+	}
+
+	//Rows never pushed leave a gap: the rest go in order after it
+	for ( std::map<size_t,Item>::iterator it = pending.begin() ; it != pending.end() ; ++it ) ready.push_back( std::move( it->second ) ) ;
+	pending.clear() ;
+	Write( ready ) ;
+	if ( out ) out->Flush() ;
+	tree->Close() ;
+
+}
+
+/*
+ * Writes the items in ready and empties it
+ */
+/**
+ *
+ * @param ready
+ */
+void ResultSink::Write( std::vector<Item> & ready ) {
+
+	std::vector<HetctWriter::Row> rows( ready.size() ) ;
+	for ( size_t i = 0 ; i < ready.size() ; i++ ) {
+		const Item & it = ready[i] ;
+		rows[i].wave = single ? WaveformStore::View( it.ssamples.data() , it.ssamples.size() , true ) :
+		                        WaveformStore::View( it.samples.data() , it.samples.size() , false ) ;
+		rows[i].temp = it.temp ; rows[i].yShift = it.yShift ; rows[i].height = it.height ; rows[i].voltage = it.voltage ;
+	}
+	tree->Write( rows ) ;
+	if ( out ) out->Write( rows ) ;
+	nwritten += ready.size() ;
+	ready.clear() ;
+
+}
@@ -0,0 +1,339 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************ScanColumns***********************************
+ *
+ * Every thread reads a contiguous range of entries through its own TFile and TTree and
+ * writes into its own slice of the columns, which are sized before the threads start,
+ * so there is nothing to lock. The same split is used to evaluate the windows.
+ *
+ */
+
+#include "ScanColumns.h"
+
+#include <iostream>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TMath.h"
+#include "TROOT.h"
+
+#include "TMeas.h"
+#include "TMeasHeader.h"
+#include "TWaveform.h"
+
+/**
+ *
+ * @param fnm
+ * @param nthreads
+ */
+ScanColumns::ScanColumns( const char * fnm , int nthreads ) : fnm( fnm ) , nthreads( nthreads ) , n( 0 ) , nt( 0 ) {
+
+	TFile * f = new TFile( fnm ) ;
+	if ( !f->IsOpen() ) {
+		std::cout << "ScanColumns: cannot open " << fnm << std::endl ;
+		std::cout << "Exiting!" << std::endl ;
+		exit(-1) ;
+	}
+	TTree * tree = (TTree*) f->Get( "edge" ) ;
+	TMeasHeader * emh = (TMeasHeader *) tree->GetUserInfo()->At(0) ;
+
+	TMeas * em = 0 ;
+	TWaveform * wv = new TWaveform( ) ;
+	tree->GetBranch( "raw" )->SetAddress( &em ) ;
+	tree->GetBranch( "proc" )->SetAddress( &wv ) ;
+	tree->GetEntry( 0 ) ;
+	em->Expand( emh , wv->BlineGetMean() ) ;
+
+	n  = tree->GetEntries() ;
+	nt = em->Nt ;
+	time.assign( em->time , em->time + nt ) ;
+	x0 = em->x ; y0 = em->y ; z0 = em->z ;
+	dx = emh->Ax ; dy = emh->Ay ; dz = emh->Az ;
+	Nx = emh->Nx ; Ny = emh->Ny ; Nz = emh->Nz ;
+	NV = emh->NV ;
+	vb.resize( NV ) ;
+	for ( Int_t i = 0 ; i < NV ; i++ ) vb[i] = emh->vVbias[i] ;
+
+	tree->ResetBranchAddresses() ;
+	delete em ;
+	delete wv ;
+	delete f ;
+
+	Vbias.resize( n ) ; x.resize( n ) ; y.resize( n ) ; z.resize( n ) ; Itot.resize( n ) ; Temp.resize( n ) ;
+	BlineMean.resize( n ) ; LPower.resize( n ) ; Q50.resize( n ) ;
+	tleft.resize( n ) ; tright.resize( n ) ; Vmax.resize( n ) ; Vmin.resize( n ) ;
+	iV.resize( n ) ; ix.resize( n ) ; iy.resize( n ) ; iz.resize( n ) ;
+
+	if ( this->nthreads <= 0 ) this->nthreads = std::max( 1 , (int) std::thread::hardware_concurrency() ) ;
+	if ( this->nthreads > n ) this->nthreads = std::max( (Long64_t) 1 , n ) ;
+
+	if ( this->nthreads == 1 ) {
+		Read( 0 , n ) ;
+		return ;
+	}
+
+	ROOT::EnableThreadSafety() ;
+	std::vector<std::thread> t ;
+	for ( Int_t i = 0 ; i < this->nthreads ; i++ ) {
+		Long64_t first = n*i/this->nthreads , last = n*(i+1)/this->nthreads ;
+		t.push_back( std::thread( &ScanColumns::Read , this , first , last ) ) ;
+	}
+	for ( size_t i = 0 ; i < t.size() ; i++ ) t[i].join() ;
+
+}
+
+/*
+ * Thread body: entries [first,last)
+ */
+/**
+ *
+ * @param first
+ * @param last
+ */
+void ScanColumns::Read( Long64_t first , Long64_t last ) {
+
+	TFile * f = new TFile( fnm ) ;
+	TTree * tree = (TTree*) f->Get( "edge" ) ;
+
+	TMeas * em = 0 ;
+	TWaveform * wv = new TWaveform( ) ;
+	tree->GetBranch( "raw" )->SetAddress( &em ) ;
+	tree->GetBranch( "proc" )->SetAddress( &wv ) ;
+
+	//Split trees (EdgeLayout.h): only the columns kept here are decompressed, not volt, time or Qt
+	if ( tree->GetBranch( "volt" ) != 0 ) {
+		const char * on[] = { "raw" , "Vbias" , "x" , "y" , "z" , "Itot" , "Temp" ,
+		                      "proc" , "BlineMean" , "LPower" , "Q50" , "tleft" , "tright" , "Vmax" , "Vmin" } ;
+		tree->SetBranchStatus( "*" , 0 ) ;
+		for ( size_t i = 0 ; i < sizeof( on )/sizeof( on[0] ) ; i++ ) tree->SetBranchStatus( on[i] , 1 ) ;
+	}
+
+	for ( Long64_t i = first ; i < last ; i++ ) {
+
+		tree->GetEntry( i ) ;
+
+		Vbias[i] = em->Vbias ; x[i] = em->x ; y[i] = em->y ; z[i] = em->z ;
+		Itot[i]  = em->Itot  ; Temp[i] = em->Temp ;
+
+		BlineMean[i] = wv->BlineGetMean() ; LPower[i] = wv->LPower ; Q50[i] = wv->GetQ50() ;
+		tleft[i]     = wv->GetTleft()     ; tright[i] = wv->GetTright() ;
+		Vmax[i]      = wv->GetVmax()      ; Vmin[i]   = wv->GetVmin() ;
+
+		Int_t k = std::find( vb.begin() , vb.end() , em->Vbias ) - vb.begin() ;
+		iV[i] = ( k < NV ) ? k : -1 ;
+		ix[i] = Cell( em->x , x0 , dx , Nx ) ;
+		iy[i] = Cell( em->y , y0 , dy , Ny ) ;
+		iz[i] = Cell( em->z , z0 , dz , Nz ) ;
+
+	}
+
+	tree->ResetBranchAddresses() ;
+	delete em ;
+	delete wv ;
+	delete f ;
+
+}
+
+/*
+ * Index of v in the axis v0 + i*dv, i=0...nv-1. An axis that is not scanned is a single cell
+ */
+/**
+ *
+ * @param v
+ * @param v0
+ * @param dv
+ * @param nv
+ * @return
+ */
+Int_t ScanColumns::Cell( Double_t v , Double_t v0 , Double_t dv , Int_t nv ) const {
+
+	if ( TMath::Abs( dv ) == 0. ) return 0 ;
+	Int_t i = TMath::Nint( ( v-v0 )/dv ) ;
+	return ( i >= 0 && i < TMath::Max( nv , 1 ) ) ? i : -1 ;
+
+}
+
+/**
+ *
+ * @param vbias
+ * @return
+ */
+std::vector<Long64_t> ScanColumns::Select( Double_t vbias ) const {
+
+	std::vector<Long64_t> sel ;
+	for ( Long64_t i = 0 ; i < n ; i++ ) if ( Vbias[i] == vbias ) sel.push_back( i ) ;
+	return sel ;
+
+}
+
+/**
+ *
+ * @param vbias
+ * @param coord
+ * @return
+ */
+std::vector<Long64_t> ScanColumns::Select( Double_t vbias , Int_t coord ) const {
+
+	Double_t xm = x0 + TMath::Nint( Nx/2. )*dx , ym = y0 + TMath::Nint( Ny/2. )*dy , zm = z0 + TMath::Nint( Nz/2. )*dz ;
+	Bool_t cx = ( coord != 0 && TMath::Abs( dx ) > 0. ) ;
+	Bool_t cy = ( coord != 1 && TMath::Abs( dy ) > 0. ) ;
+	Bool_t cz = ( coord != 2 && TMath::Abs( dz ) > 0. ) ;
+
+	std::vector<Long64_t> sel ;
+	for ( Long64_t i = 0 ; i < n ; i++ ) {
+		if ( Vbias[i] != vbias ) continue ;
+		if ( cx && !( TMath::Abs( x[i]-xm ) < 0.5*dx ) ) continue ;
+		if ( cy && !( TMath::Abs( y[i]-ym ) < 0.5*dy ) ) continue ;
+		if ( cz && !( TMath::Abs( z[i]-zm ) < 0.5*dz ) ) continue ;
+		sel.push_back( i ) ;
+	}
+	return sel ;
+
+}
+
+/*
+ * Sum$ adds (volt-BlineMean)*0 for the samples out of the window, which leaves the
+ * partial sums as they are, so only the samples inside are added, in the same order
+ */
+/**
+ *
+ * @param ta
+ * @param tb
+ * @param i2corr
+ * @return
+ */
+std::vector<Double_t> ScanColumns::Window( Double_t ta , Double_t tb , Bool_t i2corr ) const {
+
+	Int_t i0 = 0 , i1 = 0 ;
+	while ( i0 < nt && !( time[i0] > ta ) ) i0++ ;
+	i1 = i0 ;
+	while ( i1 < nt && time[i1] > ta && time[i1] < tb ) i1++ ;
+
+	std::vector<Double_t> out( n ) ;
+	if ( nthreads == 1 || n < 2*nthreads ) {
+		WindowRange( i0 , i1 , 0 , n , i2corr , &out[0] ) ;
+		return out ;
+	}
+
+	std::vector<std::thread> t ;
+	for ( Int_t i = 0 ; i < nthreads ; i++ ) {
+		Long64_t first = n*i/nthreads , last = n*(i+1)/nthreads ;
+		t.push_back( std::thread( &ScanColumns::WindowRange , this , i0 , i1 , first , last , i2corr , &out[0] ) ) ;
+	}
+	for ( size_t i = 0 ; i < t.size() ; i++ ) t[i].join() ;
+	return out ;
+
+}
+
+/**
+ *
+ * @param i0
+ * @param i1
+ * @param first
+ * @param last
+ * @param i2corr
+ * @param out
+ */
+void ScanColumns::WindowRange( Int_t i0 , Int_t i1 , Long64_t first , Long64_t last , Bool_t i2corr , Double_t * out ) const {
+
+	std::vector<Long64_t> sel ;
+	for ( Long64_t i = first ; i < last ; i++ ) sel.push_back( i ) ;
+	Samples( sel , [&] ( Long64_t i , const Double_t * v ) {
+		Double_t bl = BlineMean[i] , sum = 0. ;
+		for ( Int_t j = i0 ; j < i1 ; j++ ) sum += v[j]-bl ;
+		out[i] = i2corr ? sum/(LPower[i]*LPower[i]) : sum ;
+	} ) ;
+
+}
+
+/**
+ *
+ * @param col
+ * @param sel
+ * @return
+ */
+Double_t ScanColumns::Mean( const std::vector<Double_t> & col , const std::vector<Long64_t> & sel ) {
+
+	if ( sel.empty() ) return 0. ;
+	Double_t sum = 0. ;
+	for ( size_t i = 0 ; i < sel.size() ; i++ ) sum += col[sel[i]] ;
+	return sum/sel.size() ;
+
+}
+
+/*
+ * Only the raw branch is read, and of split trees only its volt column
+ */
+/**
+ *
+ * @param sel
+ * @param fn
+ */
+void ScanColumns::Samples( const std::vector<Long64_t> & sel , std::function<void( Long64_t , const Double_t * )> fn ) const {
+
+	TFile * f = new TFile( fnm ) ;
+	TTree * tree = (TTree*) f->Get( "edge" ) ;
+
+	TMeas * em = 0 ;
+	TBranch * raw = tree->GetBranch( "raw" ) ;
+	raw->SetAddress( &em ) ;
+	if ( tree->GetBranch( "volt" ) != 0 ) {
+		const char * on[] = { "raw" , "Nt" , "volt" } ;
+		tree->SetBranchStatus( "*" , 0 ) ;
+		for ( size_t i = 0 ; i < sizeof( on )/sizeof( on[0] ) ; i++ ) tree->SetBranchStatus( on[i] , 1 ) ;
+	}
+
+	std::vector<Double_t> v( nt , 0. ) ;
+	for ( size_t k = 0 ; k < sel.size() ; k++ ) {
+		raw->GetEntry( sel[k] ) ;
+		Int_t m = TMath::Min( nt , em->Nt ) ;
+		std::copy( em->volt , em->volt + m , v.begin() ) ;
+		std::fill( v.begin() + m , v.end() , 0. ) ;
+		fn( sel[k] , &v[0] ) ;
+	}
+
+	tree->ResetBranchAddresses() ;
+	delete em ;
+	delete f ;
+
+}
+
+/*
+ * The jobs are taken in order from a shared counter, a thread takes the next one as soon
+ * as it is done with the previous
+ */
+/**
+ *
+ * @param njobs
+ * @param job
+ */
+void ScanColumns::ForEach( Int_t njobs , std::function<void( Int_t )> job ) const {
+
+	Int_t nw = std::min( nthreads , njobs ) ;
+	if ( nw <= 1 ) {
+		for ( Int_t i = 0 ; i < njobs ; i++ ) job( i ) ;
+		return ;
+	}
+
+	std::atomic<Int_t> next( 0 ) ;
+	std::vector<std::thread> t ;
+	for ( Int_t i = 0 ; i < nw ; i++ ) t.push_back( std::thread( [&] ( ) {
+		for ( Int_t j = next++ ; j < njobs ; j = next++ ) job( j ) ;
+	} ) ) ;
+	for ( size_t i = 0 ; i < t.size() ; i++ ) t[i].join() ;
+
+}
@@ -0,0 +1,103 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+
+   The edge tree of a scan read once, column by column, for TScan.
+
+   The constructor goes through the raw and proc branches of the whole file in a single
+   pass, split in ranges of entries, one thread per range with its own TFile. It keeps
+   one column per scalar (Vbias, x, y, z, Itot, Temp from raw; BlineMean, LPower, Q50,
+   tleft, tright, Vmax, Vmin from proc) and the cell (iV,ix,iy,iz) of every entry in
+   the scan grid. The voltage samples, n x Nt of them, are not kept: Samples reads the
+   volt column of the entries asked for again, one entry at a time, so that memory
+   does not grow with the size of the scan.
+
+   The reductions TScan used to ask tree->Draw for are then done in memory:
+
+     Select   entries with Vbias == V (optionally those at the middle of the other axes)
+     Window   Sum$((volt-BlineMean)*(time>ta && time<tb)) of every entry, in parallel
+     Samples  the samples of a selection of entries, handed one by one to a function
+     Mean     mean of a column over a selection
+
+   ForEach hands jobs (one per bias voltage in TScan) to the same threads, so that
+   the per-voltage histograms are built in parallel.
+
+   Window adds the samples in the order Sum$ does, so the results are the same as those
+   of the formula. All entries are assumed to share the time axis of the first one,
+   as TScan does with dt.
+
+*/
+
+#ifndef SCANCOLUMNS_H
+#define SCANCOLUMNS_H
+
+#include <vector>
+#include <functional>
+
+#include "TString.h"
+
+class ScanColumns {
+
+  public:
+
+     //nthreads <= 0: one per core
+     ScanColumns( const char * fnm , int nthreads = 0 ) ;
+
+     Long64_t GetN( ) const { return n ; } ;
+     Int_t    GetNt( ) const { return nt ; } ;
+     const Double_t * GetTime( ) const { return &time[0] ; } ;
+
+     /* Columns, one value per entry */
+     std::vector<Double_t> Vbias , x , y , z , Itot , Temp ;
+     std::vector<Double_t> BlineMean , LPower , Q50 , tleft , tright , Vmax , Vmin ;
+     std::vector<Int_t>    iV , ix , iy , iz ;   //Cell in the scan grid, -1 if off grid
+
+     //Entries with Vbias==vbias, in entry order
+     std::vector<Long64_t> Select( Double_t vbias ) const ;
+
+     //Same, keeping only those at the middle of the scanned axes other than coord
+     //(as the TMath::Abs(y-...)<0.5*dy cuts of TScan)
+     std::vector<Long64_t> Select( Double_t vbias , Int_t coord ) const ;
+
+     //Sum$((volt-BlineMean)*(time>ta && time<tb)), divided by LPower^2 if i2corr
+     std::vector<Double_t> Window( Double_t ta , Double_t tb , Bool_t i2corr = kFALSE ) const ;
+
+     static Double_t Mean( const std::vector<Double_t> & col , const std::vector<Long64_t> & sel ) ;
+
+     //fn( i , volt ) for every entry i of sel, in that order, with its nt samples (0 past its Nt).
+     //Each call has a TFile of its own: it can be called from the jobs of ForEach
+     void Samples( const std::vector<Long64_t> & sel , std::function<void( Long64_t , const Double_t * )> fn ) const ;
+
+     //Runs job(i) once for every i in [0,njobs), on up to nthreads threads. Returns when all are done
+     void ForEach( Int_t njobs , std::function<void( Int_t )> job ) const ;
+
+  private:
+
+     void Read( Long64_t first , Long64_t last ) ;
+     void WindowRange( Int_t i0 , Int_t i1 , Long64_t first , Long64_t last , Bool_t i2corr , Double_t * out ) const ;
+     Int_t Cell( Double_t v , Double_t v0 , Double_t dv , Int_t nv ) const ;
+
+     TString fnm ;
+     Int_t nthreads ;
+     Long64_t n ;
+     Int_t nt ;
+     std::vector<Double_t> time ;
+
+     Int_t NV , Nx , Ny , Nz ;
+     Double_t x0 , y0 , z0 , dx , dy , dz ;
+     std::vector<Double_t> vb ;
+
+};
+
+#endif
@@ -11,6 +11,7 @@
  * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
  */
 #include "TMeas.h"
+#include "TMeasHeader.h"
 
 ClassImp(TMeas)
 
@@ -23,7 +24,7 @@ TMeas::TMeas( ) {
      ix=iy=iz=0 ;
      
      Setup = 1 ;
-     Nt=0 ;
+     Nt=NtS=0 ;
      volt=0 ;
      time=0 ;
      Qt=0;
@@ -38,6 +39,26 @@ TMeas::~TMeas()
   delete [] Qt ;
 }
 
+/**
+ *
+ * @param emh
+ * @param BlineMean
+ */
+void TMeas::Expand( const TMeasHeader * emh , Double_t BlineMean ) {
+
+  if ( emh == 0 || emh->SharedT == 0 || NtS == Nt ) return ;
+
+  delete [] time ;
+  delete [] Qt ;
+  time = new Double_t [Nt] ;
+  Qt   = new Double_t [Nt] ;
+  for ( int i=0 ; i< Nt ; i++) time[i] = emh->Tstart + i*emh->At ;
+  if ( Nt > 0 ) Qt[0] = volt[0] - BlineMean ;
+  for ( int i=1 ; i< Nt ; i++) Qt[i] = Qt[i-1] + volt[i] - BlineMean ;
+  NtS = Nt ;
+
+}
+
 //____________________________________________________________________________
 
 
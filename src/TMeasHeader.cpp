@@ -25,6 +25,8 @@ TMeasHeader::TMeasHeader( ) {
      comment=TString("");
      vVbias = 0.0 ;
      Polarity=0;
+     SharedT=0;
+     Tstart=0.;
      Setup = 1;
      Hum = Illum = Power = Gain = 0.0;	 
      Lambda =1060.0 ;    
@@ -41,6 +43,8 @@ TMeasHeader::TMeasHeader( Int_t NV) {
      vIleak.ResizeTo(NV) ; //http://root.cern.ch/root/roottalk/roottalk09/1231.html
      vTemp.ResizeTo(NV) ;  //http://root.cern.ch/root/roottalk/roottalk09/1231.html
      Polarity=0;
+     SharedT=0;
+     Tstart=0.;
      Setup = 1;
      Hum = Illum = Power = Gain = 0.0;	 
      Lambda =1060.0 ;    
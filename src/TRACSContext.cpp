@@ -0,0 +1,283 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************TRACSContext***********************************
+ *
+ * call_from_thread builds new TRACSInterface objects (mesh, carriers...) at every chi2
+ * evaluation and all of them write to vItotals, so only one parameter set can be simulated
+ * at a time. A context owns its interfaces and its store of currents instead, so several
+ * of them can simulate different parameter sets at once (e.g. the columns of a Jacobian).
+ *
+ */
+
+#include <TRACSContext.h>
+
+#include <iostream>
+#include <cmath>
+#include "../include/Global.h"
+
+/**
+ *
+ * @param filename
+ * @param nparts
+ */
+TRACSContext::TRACSContext( std::string filename , int nparts ) {
+
+	nsim = 0 ;
+
+	//The interface may reduce nparts to the number of z points
+	mtx.lock();
+	sim.push_back( new TRACSInterface( filename , nparts , &store ) ) ;
+	int n = sim[0]->GetNparts() ;
+	for ( int i = 1 ; i < n ; i++ ) {
+		sim.push_back( new TRACSInterface( filename , n , &store ) ) ;
+		sim[i]->set_tcount(i) ;
+	}
+	mtx.unlock();
+
+}
+
+TRACSContext::~TRACSContext( ) {
+
+	for ( uint i = 0 ; i < sim.size() ; i++ ) delete sim[i] ;
+
+}
+
+/**
+ *
+ * @param tid
+ * @param par
+ * @param irradiated
+ */
+void TRACSContext::SimulatePart( int tid , const std::vector<Double_t> & par , bool irradiated ) {
+
+	//Detector creation is serialized as in call_from_thread
+	mtx.lock();
+	sim[tid]->set_Fidelity(fidelity) ;
+	if (irradiated) sim[tid]->set_FitParam(par) ;
+	else sim[tid]->set_Fit_Norm(par) ;
+	mtx.unlock();
+	sim[tid]->loop_on(tid) ;
+
+}
+
+/*
+ * Simulates the whole scan for the parameter set par, each part in its own thread.
+ */
+/**
+ *
+ * @param par
+ * @param irradiated
+ */
+void TRACSContext::Simulate( const std::vector<Double_t> & par , bool irradiated ) {
+
+	std::vector<std::thread> th( sim.size() - 1 ) ;
+	for ( uint i = 1 ; i < sim.size() ; i++ ) th[i-1] = std::thread( &TRACSContext::SimulatePart , this , i , std::cref(par) , irradiated ) ;
+	SimulatePart( 0 , par , irradiated ) ;
+	for ( uint i = 0 ; i < th.size() ; i++ ) th[i].join() ;
+	nsim++ ;
+
+}
+
+/**
+ *
+ * @param fit
+ * @param par
+ * @param irradiated
+ * @param res
+ */
+void TRACSContext::Residuals( TRACSFit * fit , const std::vector<Double_t> & par , bool irradiated , std::vector<Double_t> & res ) {
+
+	Simulate( par , irradiated ) ;
+	fit->Residuals( store , sim[0]->get_dt()*1.e9 , sim[0]->get_fitNorm() , res ) ;
+
+}
+
+/**
+ *
+ * @param fit
+ * @param par
+ * @param irradiated
+ * @return
+ */
+Double_t TRACSContext::Chi2( TRACSFit * fit , const std::vector<Double_t> & par , bool irradiated ) {
+
+	std::vector<Double_t> res ;
+	Residuals( fit , par , irradiated , res ) ;
+
+	Double_t chi2 = 0. ;
+	for ( uint i = 0 ; i < res.size() ; i++ ) chi2 += res[i]*res[i] ;
+	return chi2 ;
+
+}
+
+//---------------------------------------------------------------------------
+/*
+ * The nthreads available are shared among ncontexts contexts. Few contexts with many
+ * threads suit sequential minimizers, many contexts suit batches such as Jacobians.
+ */
+/**
+ *
+ * @param filename
+ * @param fit
+ * @param irradiated
+ * @param ncontexts
+ * @param nthreads
+ */
+TRACSEvaluator::TRACSEvaluator( std::string filename , TRACSFit * fit , bool irradiated , int ncontexts , int nthreads ) {
+
+	fitter = fit ;
+	irrad = irradiated ;
+	if ( ncontexts < 1 ) ncontexts = 1 ;
+	if ( ncontexts > nthreads ) ncontexts = nthreads ;
+	int nparts = ( nthreads / ncontexts > 0 ) ? nthreads / ncontexts : 1 ;
+
+	std::cout << "Building " << ncontexts << " simulation contexts with " << nparts << " threads each" << std::endl;
+	for ( int i = 0 ; i < ncontexts ; i++ ) ctx.push_back( new TRACSContext( filename , nparts ) ) ;
+
+}
+
+TRACSEvaluator::~TRACSEvaluator( ) {
+
+	for ( uint i = 0 ; i < ctx.size() ; i++ ) delete ctx[i] ;
+
+}
+
+/*
+ * Context ic takes the next pending job until all of them are done.
+ */
+void TRACSEvaluator::Worker( int ic , int njobs , std::function<void( int , TRACSContext * )> * job , std::atomic<int> * next ) {
+
+	for ( int i = (*next)++ ; i < njobs ; i = (*next)++ ) (*job)( i , ctx[ic] ) ;
+
+}
+
+/*
+ * Runs job(i, context) for i in [0,njobs), spreading the jobs over the contexts.
+ */
+/**
+ *
+ * @param njobs
+ * @param job
+ */
+void TRACSEvaluator::RunJobs( int njobs , std::function<void( int , TRACSContext * )> job ) {
+
+	std::atomic<int> next( 0 ) ;
+
+	int nw = ( njobs < (int) ctx.size() ) ? njobs : ctx.size() ;
+	std::vector<std::thread> th( nw ) ;
+	for ( int i = 0 ; i < nw ; i++ ) th[i] = std::thread( &TRACSEvaluator::Worker , this , i , njobs , &job , &next ) ;
+	for ( int i = 0 ; i < nw ; i++ ) th[i].join() ;
+
+}
+
+/**
+ *
+ * @param pars
+ * @param res
+ */
+void TRACSEvaluator::Residuals( const std::vector< std::vector<Double_t> > & pars , std::vector< std::vector<Double_t> > & res ) {
+
+	res.resize( pars.size() ) ;
+	RunJobs( pars.size() , [&] ( int i , TRACSContext * c ) {
+		c->Residuals( fitter , pars[i] , irrad , res[i] ) ;
+	} ) ;
+
+}
+
+/*
+ * Number of simulations run so far by all the contexts.
+ */
+int TRACSEvaluator::GetNCalls( ) {
+
+	int n = 0 ;
+	for ( uint i = 0 ; i < ctx.size() ; i++ ) n += ctx[i]->GetNSimulations() ;
+	return n ;
+
+}
+
+/**
+ *
+ * @param pars
+ * @param chi2
+ */
+void TRACSEvaluator::Chi2( const std::vector< std::vector<Double_t> > & pars , std::vector<Double_t> & chi2 ) {
+
+	std::vector< std::vector<Double_t> > res ;
+	Residuals( pars , res ) ;
+
+	chi2.assign( pars.size() , 0. ) ;
+	for ( uint j = 0 ; j < res.size() ; j++ )
+		for ( uint i = 0 ; i < res[j].size() ; i++ ) chi2[j] += res[j][i]*res[j][i] ;
+
+}
+
+//---------------------------------------------------------------------------
+/**
+ *
+ * @param par
+ * @return
+ */
+Double_t TRACSGradientFCN::operator( )( const std::vector<Double_t> & par ) const {
+
+	if ( par == lastPar && fidelity == lastFidelity ) return lastChi2 ;
+
+	std::vector<Double_t> chi2 ;
+	ev->Chi2( std::vector< std::vector<Double_t> >( 1 , par ) , chi2 ) ;
+	lastPar = par ;
+	lastChi2 = chi2[0] ;
+	lastFidelity = fidelity ;
+	return lastChi2 ;
+
+}
+
+/*
+ * Forward differences with the step of TRACSLMFit, 1e-3 of the parameter value (1e-3 if
+ * it is zero). The point itself goes in the same batch unless it was just evaluated at the
+ * same fidelity, so the whole gradient takes the time of one simulation given npar+1 contexts.
+ */
+/**
+ *
+ * @param par
+ * @return
+ */
+std::vector<Double_t> TRACSGradientFCN::Gradient( const std::vector<Double_t> & par ) const {
+
+	std::vector<int> ifree ;
+	for ( uint i = 0 ; i < par.size() ; i++ ) if ( i >= fixed.size() || !fixed[i] ) ifree.push_back( i ) ;
+
+	bool cached = ( par == lastPar && fidelity == lastFidelity ) ;
+	std::vector< std::vector<Double_t> > pars ;
+	if ( !cached ) pars.push_back( par ) ;
+	std::vector<Double_t> h( ifree.size() ) ;
+	for ( uint k = 0 ; k < ifree.size() ; k++ ) {
+		h[k] = 1.e-3*std::fabs( par[ifree[k]] ) ;
+		if ( h[k] == 0. ) h[k] = 1.e-3 ;
+		pars.push_back( par ) ;
+		pars.back()[ifree[k]] += h[k] ;
+	}
+
+	std::vector<Double_t> chi2 ;
+	ev->Chi2( pars , chi2 ) ;
+	if ( !cached ) {
+		lastPar = par ;
+		lastChi2 = chi2[0] ;
+		lastFidelity = fidelity ;
+	}
+
+	int off = cached ? 0 : 1 ;
+	std::vector<Double_t> grad( par.size() , 0. ) ;
+	for ( uint k = 0 ; k < ifree.size() ; k++ ) grad[ifree[k]] = ( chi2[k+off] - lastChi2 )/h[k] ;
+	return grad ;
+
+}
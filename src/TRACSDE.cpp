@@ -0,0 +1,159 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************TRACSDE***********************************
+ *
+ * Each member x of the population breeds a trial a + F (b - c), with a, b, c three
+ * other random members, crossed over component by component with x (probability CR,
+ * at least one component from the mutant). The trial replaces x if its chi2 is not
+ * worse. F is dithered in [0.5,1) every generation, which keeps the search from
+ * stalling without any tuning. Components leaving the box are put back halfway
+ * between the parent and the bound.
+ *
+ * The initial population is uniform in the box, except for the first member which
+ * is the starting point. The search stops when the chi2 of all the members agree
+ * within the tolerance or after the maximum number of generations.
+ *
+ */
+
+#include <TRACSDE.h>
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+/**
+ *
+ * @param fcn
+ * @param par
+ * @param low
+ * @param high
+ */
+TRACSDE::TRACSDE( BatchChi2 fcn , const std::vector<double> & par , const std::vector<double> & low , const std::vector<double> & high ) :
+	fcn( fcn ) , par( par ) , low( low ) , high( high ) , fixed( par.size() , false ) {
+
+	ibest = 0 ;
+	tolerance = 0.1 ;
+	npop = 0 ;
+	maxGen = 100 ;
+	nGen = 0 ;
+	nFcn = 0 ;
+	printLevel = 1 ;
+	rng.seed( 4357 ) ;
+
+}
+
+/**
+ *
+ * @param ipar
+ */
+void TRACSDE::Fix( int ipar ) {
+
+	fixed[ipar] = true ;
+
+}
+
+/*
+ * Standard deviation of each parameter over the population: a scale for the
+ * initial errors of a local minimizer started from the best member.
+ */
+/**
+ *
+ * @return
+ */
+std::vector<double> TRACSDE::Spread( ) const {
+
+	int n = par.size() ;
+	std::vector<double> s( n , 0. ) ;
+	for ( int j=0 ; j<n ; j++ ) {
+		double m = 0. , m2 = 0. ;
+		for ( size_t i=0 ; i<pop.size() ; i++ ) { m += pop[i][j] ; m2 += pop[i][j]*pop[i][j] ; }
+		m /= pop.size() ;
+		m2 = m2/pop.size() - m*m ;
+		s[j] = ( m2 > 0. ) ? std::sqrt( m2 ) : 0. ;
+	}
+	return s ;
+
+}
+
+/**
+ *
+ * @return true if the population converged before the maximum number of generations
+ */
+bool TRACSDE::Minimize( ) {
+
+	int n = par.size() ;
+	std::vector<int> ifree ;
+	for ( int j=0 ; j<n ; j++ ) if ( !fixed[j] && high[j] > low[j] ) ifree.push_back( j ) ;
+	int nfree = ifree.size() ;
+
+	if ( npop < 4 ) npop = std::max( 4 , 10*nfree ) ;
+	std::uniform_real_distribution<double> uni( 0. , 1. ) ;
+	std::uniform_int_distribution<int> pick( 0 , npop-1 ) ;
+
+	//Initial population
+	pop.assign( npop , par ) ;
+	for ( int i=1 ; i<npop ; i++ )
+		for ( int k=0 ; k<nfree ; k++ ) {
+			int j = ifree[k] ;
+			pop[i][j] = low[j] + uni( rng )*( high[j] - low[j] ) ;
+		}
+	fcn( pop , chi2 ) ;
+	nFcn += npop ;
+	ibest = std::min_element( chi2.begin() , chi2.end() ) - chi2.begin() ;
+
+	bool converged = false ;
+	std::vector< std::vector<double> > trial( npop , par ) ;
+	std::vector<double> tchi2 ;
+	const double CR = 0.9 ;
+
+	for ( nGen = 0 ; nGen < maxGen && nfree > 0 ; nGen++ ) {
+
+		double worst = *std::max_element( chi2.begin() , chi2.end() ) ;
+		if ( printLevel > 0 ) std::cout << "DE generation " << nGen << ": best chi2= " << chi2[ibest] << "  worst chi2= " << worst << std::endl ;
+		if ( worst - chi2[ibest] < tolerance ) { converged = true ; break ; }
+
+		double F = 0.5 + 0.5*uni( rng ) ;
+		for ( int i=0 ; i<npop ; i++ ) {
+			int a , b , c ;
+			do a = pick( rng ) ; while ( a == i ) ;
+			do b = pick( rng ) ; while ( b == i || b == a ) ;
+			do c = pick( rng ) ; while ( c == i || c == a || c == b ) ;
+
+			trial[i] = pop[i] ;
+			int kforce = std::uniform_int_distribution<int>( 0 , nfree-1 )( rng ) ;
+			for ( int k=0 ; k<nfree ; k++ ) {
+				if ( k != kforce && uni( rng ) >= CR ) continue ;
+				int j = ifree[k] ;
+				double v = pop[a][j] + F*( pop[b][j] - pop[c][j] ) ;
+				if ( v < low[j] ) v = 0.5*( pop[i][j] + low[j] ) ;
+				if ( v > high[j] ) v = 0.5*( pop[i][j] + high[j] ) ;
+				trial[i][j] = v ;
+			}
+		}
+
+		fcn( trial , tchi2 ) ;
+		nFcn += npop ;
+		for ( int i=0 ; i<npop ; i++ ) {
+			if ( tchi2[i] <= chi2[i] ) {
+				pop[i] = trial[i] ;
+				chi2[i] = tchi2[i] ;
+			}
+		}
+		ibest = std::min_element( chi2.begin() , chi2.end() ) - chi2.begin() ;
+
+	}
+
+	return converged || nfree == 0 ;
+
+}
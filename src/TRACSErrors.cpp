@@ -0,0 +1,143 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************TRACSErrors***********************************
+ *
+ * MnMinos::Minos(par) runs the lower and upper crossings of a parameter one after the
+ * other, and parameters one after the other, always with the same FCN. Here each side
+ * is a job of its own with a TRACSContextFCN bound to the context running it, so all of
+ * them proceed at once. The same applies to the points of a chi2 scan.
+ *
+ */
+
+#include <TRACSErrors.h>
+
+#include <iostream>
+
+#include <Minuit2/MnMinos.h>
+#include <Minuit2/MnCross.h>
+#include <Minuit2/MnPlot.h>
+#include <Minuit2/MnPrint.h>
+#include <Minuit2/MinuitParameter.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace ROOT::Minuit2;
+
+/*
+ * Minos errors of parameters ipars around min.
+ */
+/**
+ *
+ * @param ev
+ * @param min
+ * @param ipars
+ * @param strategy
+ * @return
+ */
+std::vector<MinosError> ParallelMinos( TRACSEvaluator & ev , const FunctionMinimum & min , const std::vector<unsigned int> & ipars , unsigned int strategy ) {
+
+	//Jobs 2k and 2k+1 are the lower and upper sides of parameter ipars[k]
+	int njobs = 2*ipars.size() ;
+	std::vector<MnCross> cross( njobs ) ;
+
+	ev.RunJobs( njobs , [&] ( int i , TRACSContext * c ) {
+		TRACSContextFCN fcn( c , ev.GetFit() , ev.IsIrradiated() ) ;
+		MnMinos minos( fcn , min , strategy ) ;
+		if ( i%2 == 0 ) cross[i] = minos.Loval( ipars[i/2] ) ;
+		else            cross[i] = minos.Upval( ipars[i/2] ) ;
+	} ) ;
+
+	std::vector<MinosError> me ;
+	for ( uint k = 0 ; k < ipars.size() ; k++ )
+		me.push_back( MinosError( ipars[k] , min.UserState().Value( ipars[k] ) , cross[2*k] , cross[2*k+1] ) ) ;
+
+	return me ;
+
+}
+
+/*
+ * Chi2 along parameter ipar in [low,high], the others staying at their values in state.
+ * With low == high the range is +-2 errors around the value, as for MnScan.
+ */
+/**
+ *
+ * @param ev
+ * @param state
+ * @param ipar
+ * @param npoints
+ * @param low
+ * @param high
+ * @return
+ */
+std::vector< std::pair<double,double> > ParallelScan( TRACSEvaluator & ev , const MnUserParameterState & state , unsigned int ipar , unsigned int npoints , double low , double high ) {
+
+	if ( low == high ) {
+		low  = state.Value( ipar ) - 2.*state.Error( ipar ) ;
+		high = state.Value( ipar ) + 2.*state.Error( ipar ) ;
+	}
+	if ( npoints < 2 ) npoints = 2 ;
+
+	std::vector< std::vector<Double_t> > pars( npoints , state.Params() ) ;
+	for ( uint i = 0 ; i < npoints ; i++ ) pars[i][ipar] = low + i*(high-low)/(npoints-1) ;
+
+	std::vector<Double_t> chi2 ;
+	ev.Chi2( pars , chi2 ) ;
+
+	std::vector< std::pair<double,double> > scan ;
+	for ( uint i = 0 ; i < npoints ; i++ ) scan.push_back( std::pair<double,double>( pars[i][ipar] , chi2[i] ) ) ;
+
+	return scan ;
+
+}
+
+/*
+ * Minos errors and chi2 scans of all the free parameters of min, printed as Minuit does.
+ * The contexts are built here, sharing nthreads among up to two per free parameter.
+ */
+/**
+ *
+ * @param filename
+ * @param fit
+ * @param irradiated
+ * @param min
+ * @param nthreads
+ * @param npoints
+ */
+void ErrorAnalysis( std::string filename , TRACSFit * fit , bool irradiated , const FunctionMinimum & min , int nthreads , unsigned int npoints ) {
+
+	boost::posix_time::ptime start = boost::posix_time::second_clock::local_time();
+
+	std::vector<unsigned int> ipars ;
+	const std::vector<MinuitParameter> & mp = min.UserState().MinuitParameters() ;
+	for ( uint i = 0 ; i < mp.size() ; i++ ) if ( !mp[i].IsFixed() ) ipars.push_back( i ) ;
+
+	TRACSEvaluator ev( filename , fit , irradiated , 2*ipars.size() , nthreads ) ;
+
+	std::vector<MinosError> me = ParallelMinos( ev , min , ipars ) ;
+	std::cout << "=============================================" << std::endl;
+	std::cout << "MINOS ERRORS: " << std::endl;
+	for ( uint k = 0 ; k < me.size() ; k++ ) std::cout << me[k] << std::endl ;
+	std::cout << "=============================================" << std::endl;
+
+	MnPlot plot ;
+	for ( uint k = 0 ; k < ipars.size() ; k++ ) {
+		std::vector< std::pair<double,double> > scan = ParallelScan( ev , min.UserState() , ipars[k] , npoints ) ;
+		std::cout << "Chi2 scan of p" << ipars[k] << std::endl ;
+		plot( scan ) ;
+	}
+
+	boost::posix_time::time_duration timeTaken = boost::posix_time::second_clock::local_time() - start ;
+	std::cout << "Total time for error analysis: " << timeTaken.total_seconds() << std::endl ;
+	std::cout << "Simulations used for error analysis: " << ev.GetNCalls() << std::endl ;
+
+}
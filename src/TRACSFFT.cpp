@@ -0,0 +1,197 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <TRACSFFT.h>
+
+#include <cmath>
+#include <algorithm>
+
+/**
+ *
+ * @param n
+ * @return
+ */
+size_t fft::NextPow2( size_t n ) {
+
+	size_t p = 1 ;
+	while ( p < n ) p <<= 1 ;
+	return p ;
+
+}
+
+/*
+ * Iterative Cooley-Tukey: bit reversal permutation, then log2(N) butterfly passes.
+ */
+/**
+ *
+ * @param a
+ * @param inverse
+ */
+void fft::Transform( std::vector< std::complex<double> > & a , bool inverse ) {
+
+	size_t n = a.size() ;
+	if ( n < 2 ) return ;
+
+	for ( size_t i = 1 , j = 0 ; i < n ; i++ ) {
+		size_t bit = n >> 1 ;
+		for ( ; j & bit ; bit >>= 1 ) j ^= bit ;
+		j ^= bit ;
+		if ( i < j ) std::swap( a[i] , a[j] ) ;
+	}
+
+	for ( size_t len = 2 ; len <= n ; len <<= 1 ) {
+		double ang = 2.*M_PI/len*( inverse ? 1. : -1. ) ;
+		std::complex<double> wl( std::cos( ang ) , std::sin( ang ) ) ;
+		for ( size_t i = 0 ; i < n ; i += len ) {
+			std::complex<double> w( 1. , 0. ) ;
+			for ( size_t k = 0 ; k < len/2 ; k++ ) {
+				std::complex<double> u = a[i+k] , v = a[i+k+len/2]*w ;
+				a[i+k] = u + v ;
+				a[i+k+len/2] = u - v ;
+				w *= wl ;
+			}
+		}
+	}
+
+	if ( inverse ) for ( size_t i = 0 ; i < n ; i++ ) a[i] /= (double) n ;
+
+}
+
+/*
+ * Both sequences zero padded to a common power of 2 long enough for the circular
+ * correlation not to wrap: r = IFFT( conj(FFT(a)) FFT(x) ).
+ */
+/**
+ *
+ * @param a
+ * @param x
+ * @param nlags
+ * @param r
+ */
+void fft::Correlate( const std::vector<double> & a , const std::vector<double> & x , int nlags , std::vector<double> & r ) {
+
+	size_t n = NextPow2( std::max( a.size() + nlags , x.size() ) + a.size() ) ;
+	std::vector< std::complex<double> > A( n ) , X( n ) ;
+	for ( size_t i = 0 ; i < a.size() ; i++ ) A[i] = a[i] ;
+	for ( size_t i = 0 ; i < x.size() ; i++ ) X[i] = x[i] ;
+	Transform( A , false ) ;
+	Transform( X , false ) ;
+	for ( size_t i = 0 ; i < n ; i++ ) X[i] *= std::conj( A[i] ) ;
+	Transform( X , true ) ;
+
+	r.resize( nlags ) ;
+	for ( int d = 0 ; d < nlags ; d++ ) r[d] = X[d].real() ;
+
+}
+
+/**
+ *
+ * @param r
+ * @param i
+ * @return
+ */
+double fft::ParabolicPeak( const std::vector<double> & r , int i ) {
+
+	if ( i <= 0 || i >= (int) r.size()-1 ) return 0. ;
+	double den = r[i-1] - 2.*r[i] + r[i+1] ;
+	if ( den >= 0. ) return 0. ;
+	double d = 0.5*( r[i-1] - r[i+1] )/den ;
+	return ( d > 0.5 ) ? 0.5 : ( ( d < -0.5 ) ? -0.5 : d ) ;
+
+}
+
+/*
+ * Direct sums cost na*nb products, the FFT path three transforms of the padded length.
+ */
+static bool DirectIsCheaper( size_t na , size_t nb , size_t n ) {
+
+	double lg = 0. ;
+	for ( size_t p = n ; p > 1 ; p >>= 1 ) lg++ ;
+	return (double) na*nb <= 3.*n*lg*4. ;
+
+}
+
+static void DirectConvolve( const std::vector<double> & a , const std::vector<double> & b , size_t nc , std::vector<double> & c ) {
+
+	c.assign( nc , 0. ) ;
+	for ( size_t k = 0 ; k < a.size() ; k++ ) {
+		if ( a[k] == 0. ) continue ;
+		for ( size_t j = 0 ; j < b.size() && k+j < nc ; j++ ) c[k+j] += a[k]*b[j] ;
+	}
+
+}
+
+/**
+ *
+ * @param a
+ * @param b
+ * @param nc
+ * @param c
+ */
+void fft::Convolve( const std::vector<double> & a , const std::vector<double> & b , size_t nc , std::vector<double> & c ) {
+
+	if ( a.empty() || b.empty() ) { c.assign( nc , 0. ) ; return ; }
+	size_t n = NextPow2( a.size() + b.size() - 1 ) ;
+	if ( DirectIsCheaper( a.size() , b.size() , n ) ) { DirectConvolve( a , b , nc , c ) ; return ; }
+
+	std::vector< std::complex<double> > A( n ) , B( n ) ;
+	for ( size_t i = 0 ; i < a.size() ; i++ ) A[i] = a[i] ;
+	for ( size_t i = 0 ; i < b.size() ; i++ ) B[i] = b[i] ;
+	Transform( A , false ) ;
+	Transform( B , false ) ;
+	for ( size_t i = 0 ; i < n ; i++ ) A[i] *= B[i] ;
+	Transform( A , true ) ;
+
+	c.assign( nc , 0. ) ;
+	for ( size_t i = 0 ; i < nc && i < n ; i++ ) c[i] = A[i].real() ;
+
+}
+
+/*
+ * Spectra are computed on first use of each padded length and never change after,
+ * so the lock is only held to look them up.
+ */
+/**
+ *
+ * @param x
+ * @param nc
+ * @param y
+ */
+void fft::Kernel::Apply( const std::vector<double> & x , size_t nc , std::vector<double> & y ) const {
+
+	if ( x.empty() || h.empty() ) { y.assign( nc , 0. ) ; return ; }
+	size_t n = NextPow2( x.size() + h.size() - 1 ) ;
+	if ( DirectIsCheaper( x.size() , h.size() , n ) ) { DirectConvolve( x , h , nc , y ) ; return ; }
+
+	const std::vector< std::complex<double> > * H ;
+	{
+		std::lock_guard<std::mutex> lock( smtx ) ;
+		std::vector< std::complex<double> > & S = spectra[n] ;
+		if ( S.empty() ) {
+			S.assign( n , 0. ) ;
+			for ( size_t i = 0 ; i < h.size() ; i++ ) S[i] = h[i] ;
+			Transform( S , false ) ;
+		}
+		H = &S ;
+	}
+
+	std::vector< std::complex<double> > X( n ) ;
+	for ( size_t i = 0 ; i < x.size() ; i++ ) X[i] = x[i] ;
+	Transform( X , false ) ;
+	for ( size_t i = 0 ; i < n ; i++ ) X[i] *= (*H)[i] ;
+	Transform( X , true ) ;
+
+	y.assign( nc , 0. ) ;
+	for ( size_t i = 0 ; i < nc && i < n ; i++ ) y[i] = X[i].real() ;
+
+}
@@ -14,6 +14,9 @@
 #include <TRACSFit.h>
 
 #include <cmath>
+#include <algorithm>
+#include <TRACSFFT.h>
+#include <EdgeLayout.h>
 #include <linear.h>
 
 //ClassImp(TRACSFit)
@@ -56,6 +59,8 @@ TRACSFit::TRACSFit() {
 	emh = 0;
 	emhs = 0;
 	fitNorm = 0;
+	nRes = 0;
+	chiNorm = 1.;
 }
 /**
  *
@@ -63,7 +68,25 @@ TRACSFit::TRACSFit() {
  * @param FileConf
  * @param howstr
  */
-TRACSFit::TRACSFit( TString FileMeas , TString FileConf ,  TString howstr ) {
+TRACSFit::TRACSFit( TString FileMeas , TString FileConf ,  TString howstr ) : TRACSFit( FileMeas , FileConf , howstr , TRACSsim[0] ) { }
+
+/*
+ * Same, taking the simulation from sim instead of from the threads of TRACSsim,
+ * so that several TRACSFit objects (one per measurement) can live together.
+ */
+/**
+ *
+ * @param FileMeas
+ * @param FileConf
+ * @param howstr
+ * @param sim
+ */
+TRACSFit::TRACSFit( TString FileMeas , TString FileConf ,  TString howstr , TRACSInterface * sim ) {
+
+	static int nfits = 0 ;
+	TString listm_name = TString::Format( "myListMeas%d" , nfits ) ;
+	TString lists_name = TString::Format( "myListSim%d" , nfits ) ;
+	nfits++ ;
 
 	//Create simulation tree
 	ntm = 0;
@@ -95,7 +118,7 @@ TRACSFit::TRACSFit( TString FileMeas , TString FileConf ,  TString howstr ) {
 
     raw->GetEntry(0) ;
 
-    wv = new TWaveform( em ) ;
+    wv = new TWaveform( ) ;     //Only holds the proc branch
     TBranch *proc = tmeas->GetBranch("proc") ;
     proc->SetAddress(&wv) ;
     emh = (TMeasHeader *) tmeas->GetUserInfo()->At(0) ;
@@ -103,10 +126,13 @@ TRACSFit::TRACSFit( TString FileMeas , TString FileConf ,  TString howstr ) {
 
 
 	//MEASUREMENT: Subset of entries fulfilling "how" condition
-	tmeas->Draw( ">>myListMeas" , (char*) how.Data() , "entrylistarray" ) ;
-	listm=(TEntryListArray*)gDirectory->Get("myListMeas") ;
+	tmeas->Draw( ">>"+listm_name , (char*) how.Data() , "entrylistarray" ) ;
+	listm=(TEntryListArray*)gDirectory->Get(listm_name) ;
 	tmeas->SetEntryList( listm ) ; //Use tree->SetEventList(0) to switch off
 
+	//From here on only the samples and the baseline are read (see EdgeLayout.h)
+	edgelayout::Activate( tmeas , edgelayout::TimeColumns( tmeas ) + ",volt,BlineMean" ) ;
+
 	//MEASUREMENT: Time vector
 	Nevm = listm->GetN() ;
     if ( Nevm == 0 ) {
@@ -116,7 +142,8 @@ TRACSFit::TRACSFit( TString FileMeas , TString FileConf ,  TString howstr ) {
     }
     Int_t iev = listm->GetEntry(0) ;
 	tmeas->GetEntry( iev );
-	ntm = wv->GetNbins() ;
+	em->Expand( emh , wv->BlineGetMean() ) ;
+	ntm = em->Nt ;
 	std::vector<Double_t> timem(ntm);
 
 	//Dump time information into timem
@@ -130,28 +157,30 @@ TRACSFit::TRACSFit( TString FileMeas , TString FileConf ,  TString howstr ) {
 	//Create objects TWaveform and TMeas for SIMULATION
 	//Convert simulation data into a TTree
 	tsim = new TTree("edge","TRACS simulation");
-	TRACSsim[0]->GetTree( tsim );
+	sim->GetTree( tsim );
 
     ems = 0 ;
 	TBranch *raws  = tsim->GetBranch("raw") ;
 	raws->SetAddress(&ems) ;
 	raws->GetEntry(0) ;
-	wvs = new TWaveform( ems ) ;
+	wvs = new TWaveform( ) ;
 	TBranch *procs  = tsim->GetBranch("proc") ;
 	procs->SetAddress(&wvs) ;
-	emhs=0;
+	emhs = (TMeasHeader *) tsim->GetUserInfo()->At(0) ;
 
 	//SIMULATION: Subset of entries fulfilling "how" condition
 	//tsim->Draw("volt-BlineMean:time","event==0","l"); gPad->Modified();gPad->Update();
-	tsim->Draw( ">>myListSim" ,  (char*) how.Data() , "entrylistarray" ) ;
+	tsim->Draw( ">>"+lists_name ,  (char*) how.Data() , "entrylistarray" ) ;
 	//tsim->Draw( ">>myListSim" ,  (char*) how.Data()  ) ;
-	lists=(TEntryListArray*) gDirectory->Get("myListSim") ;
+	lists=(TEntryListArray*) gDirectory->Get(lists_name) ;
 	tsim->SetEntryList( lists ) ; //Use tree->SetEventList(0) to switch off
+	edgelayout::Activate( tsim , edgelayout::TimeColumns( tsim ) + ",volt,BlineMean" ) ;
 
 	//SIMULATION: Get time vector
 	iev = lists->GetEntry(0) ;
 	tsim->GetEntry( iev );
-	nts = wvs->GetNbins() ;
+	ems->Expand( emhs , wvs->BlineGetMean() ) ;
+	nts = ems->Nt ;
 	vector<Double_t> tims(nts);
 	Nevs  = lists->GetN() ;
 
@@ -181,12 +210,33 @@ TRACSFit::TRACSFit( TString FileMeas , TString FileConf ,  TString howstr ) {
 	Double_t tmax = (tims[nts-1]<=timem[ntm-1])? tims[nts-1] : timem[ntm-1] ;
 	tsim->GetEntry( lists->GetEntry(0) );
 	tmeas->GetEntry( listm->GetEntry(0) );
-	Double_t Ats=wvs->time[2]-wvs->time[1] , Atm=wv->time[2]-wv->time[1];
+	ems->Expand( emhs , wvs->BlineGetMean() ) ; em->Expand( emh , wv->BlineGetMean() ) ;
+	Double_t Ats=ems->time[2]-ems->time[1] , Atm=em->time[2]-em->time[1];
 
 	//Common maximum and minimum indexes
 	imins = TMath::Nint( (tmin-tims[0])/Ats ) , imaxs =TMath::Nint( (tmax-tims[0])/Ats );
 	iminm = TMath::Nint( (tmin-timem[0])/Atm ) , imaxm =TMath::Nint( (tmax-timem[0])/Atm );
 
+	/*-------------  M E A S U R E M E N T   C A C H E  --------------------------*/
+	//The measured samples entering the chi2 do not change during the fit: read them once
+	nRes = 0 ;
+	simEntry.resize( Nevm ) ;
+	timem_c.resize( Nevm ) ;
+	voltm_c.resize( Nevm ) ;
+	for ( Int_t ii=0 ; ii < Nevm ; ii++ ) {
+		simEntry[ii] = lists->GetEntry(ii) ;
+		tmeas->GetEntry( listm->GetEntry(ii) );
+		em->Expand( emh , wv->BlineGetMean() ) ;
+		for ( Int_t iv = iminm ; iv< imaxm ; iv++ ) {
+			timem_c[ii].push_back( em->time[iv] ) ;
+			voltm_c[ii].push_back( -1*(em->volt[iv] - wv->BlineGetMean()) ) ; //Change sign of Meas *******
+		}
+		nRes += timem_c[ii].size() ;
+	}
+	chiNorm = sim->GetchiFinal() ;
+	alignMode = kNoAlign ;
+	maxShift = 0. ;
+
 
 }
 //---------------------------------------------------------------------------
@@ -214,68 +264,133 @@ Double_t TRACSFit::LeastSquares( ) {
      (number of points in the waveform).
 	 */
 
-	tsim = new TTree("edge","TRACS simulation");
-	TRACSsim[0]->GetTree( tsim );
-    ems = 0 ;
-	TBranch *raws  = tsim->GetBranch("raw") ;
-	raws->SetAddress(&ems) ;
-	raws->GetEntry(0) ;
-	TWaveform *wvit = new TWaveform( ems ) ;
-	TBranch *procs  = tsim->GetBranch("proc") ;
-	procs->SetAddress(&wvit) ;
-	emhs=0;
-	tsim->SetEntryList(  lists ) ;
-	tmeas->SetEntryList( listm ) ;
-
+	std::vector<Double_t> res ;
+	fitNorm = TRACSsim[0]->get_fitNorm();
+	Residuals( vItotals , TRACSsim[0]->get_dt()*1.e9 , fitNorm , res ) ;
 
-	vector<Double_t>  timem, voltm , tims, volts ;
-    tims.resize(nts);
-    volts.resize(nts);
-    timem.resize(ntm);
-    voltm.resize(ntm);
 	Double_t chi2 = 0.;
-	//Int_t Nt_iterm = imaxm - iminm + 1 ;
+	for ( size_t ir = 0 ; ir < res.size() ; ir++ ) chi2 += res[ir]*res[ir] ;
+
+	return chi2 ;
+
+}
+
+//---------------------------------------------------------------------------
+/*
+ * Simulation sampled at i*At, linearly interpolated at x*At (constant beyond the ends)
+ */
+static inline Double_t Interpolate( const WaveformStore::View & volts , Double_t x ) {
+
+	Int_t ns = volts.size() ;
+	Int_t is = (Int_t) std::floor( x ) ;
+	if ( is < 0 )            return volts[0] ;
+	else if ( is >= ns-1 )   return volts[ns-1] ;
+	else                     return volts[is] + (x-is)*(volts[is+1]-volts[is]) ;
+
+}
+
+/**
+ * Residuals (meas - norm*sim)/chiFinal of every selected sample, so that the sum of
+ * their squares is LeastSquares( ). The simulation is read from itotals, sampled at
+ * i*At (ns), and linearly interpolated at the measured times. Samples where the
+ * simulation is exactly zero do not enter the chi2 and get a null residual, which
+ * keeps the length of res fixed to GetNResiduals( ). With an alignment set, the
+ * simulation is first delayed by the shift found by TimeShifts( ).
+ *
+ * @param itotals
+ * @param At
+ * @param norm
+ * @param res
+ */
+void TRACSFit::Residuals( const WaveformStore & itotals , Double_t At , Double_t norm , std::vector<Double_t> & res ) const {
+
+	res.assign( nRes , 0. ) ;
+
+	std::vector<Double_t> shift( Nevm , 0. ) ;
+	if ( alignMode != kNoAlign ) TimeShifts( itotals , At , shift ) ;
+
+	Int_t ir = 0 ;
 	for ( Int_t ii=0 ; ii < Nevm ; ii++ ) {
 
-		//Retrieve simulated waveform fulfilling condition "how"
-		Int_t iev = lists->GetEntry(ii) ;
-		tsim->GetEntry( iev );
+		WaveformStore::View volts = itotals[ simEntry[ii] ] ;
 
-		for ( Int_t iv = 0 ; iv< nts ; iv++ ) {
-			volts[iv] = ems->volt[iv] ;
-			tims[iv]  = ems->time[iv] ;
-		}
+		for ( size_t iv = 0 ; iv < timem_c[ii].size() ; iv++ , ir++ ) {
 
-		//Prepare interpolator for simulation data in case it has not been simulated in the right time grid
-		ROOT::Math::Interpolator itp1( tims , volts , ROOT::Math::Interpolation::kLINEAR);
-		itp1.SetData(tims , volts);
-
-		//Retrieve measured waveform fulfilling condition "how"
-		iev = listm->GetEntry(ii) ;
-		tmeas->GetEntry( iev );
-		fitNorm = TRACSsim[0]->get_fitNorm();
-		for ( Int_t iv = 0 ; iv< ntm ; iv++ ) {
-			voltm[iv] = em->volt[iv] - wv->BlineGetMean();
-			voltm[iv] = -1 *voltm[iv]; //Change sign of Meas *******
- 			timem[iv] = em->time[iv] ;
+			Double_t simulation = Interpolate( volts , ( timem_c[ii][iv] - shift[ii] )/At ) ;
+
+			if (simulation != 0) //For not to fit the 0's part!.********
+				res[ir] = ( voltm_c[ii][iv]-norm*simulation )/chiNorm ;
 		}
-		double simulation; //, norm=TRACSsim[0]->get_fitNorm();
-		for ( Int_t iv = iminm ; iv< imaxm ; iv++ ) {
-			simulation = itp1.Eval(timem[iv]);
 
-		if (simulation != 0) //For not to fit the 0's part!.********
-			//std::cout << "Scan="<<ii<<" Iteration= "<<iv<<" m=" << voltm[iv] << " s=" << simulation << " X2=" << chi2 << std::endl;
-			chi2+=( voltm[iv]-fitNorm*simulation )*(voltm[iv]-fitNorm*simulation) ;
+	}
+
+}
+
+//---------------------------------------------------------------------------
+/**
+ * Enables the alignment of the simulation to the measurement: one time shift for all
+ * the events (kAlignGlobal) or one per event (kAlignEvent), searched within +-maxshift
+ * ns. With maxshift 0 the search covers a quarter of the common time window.
+ *
+ * @param mode
+ * @param maxshift
+ */
+void TRACSFit::SetAlignment( Int_t mode , Double_t maxshift ) {
+
+	alignMode = mode ;
+	maxShift = maxshift ;
+	if ( maxShift <= 0. && timem_c.size() > 0 && timem_c[0].size() > 1 )
+		maxShift = 0.25*( timem_c[0].back() - timem_c[0].front() ) ;
+
+}
+
+/**
+ * Delay (ns) of the simulation maximizing its cross-correlation with the measurement.
+ * The simulation is resampled on the measured time grid, extended by the largest shift
+ * on both sides, and correlated by FFT with the measured samples. The peak is refined
+ * to a fraction of the sampling step with a parabola through its neighbours. In global
+ * mode the correlations of all the events are added before looking for the peak.
+ *
+ * @param itotals
+ * @param At
+ * @param shift
+ */
+void TRACSFit::TimeShifts( const WaveformStore & itotals , Double_t At , std::vector<Double_t> & shift ) const {
+
+	shift.assign( Nevm , 0. ) ;
+
+	std::vector<Double_t> rsum ;
+	Double_t Atsum = 0. ;
+	for ( Int_t ii=0 ; ii < Nevm ; ii++ ) {
+
+		Int_t N = timem_c[ii].size() ;
+		if ( N < 2 ) continue ;
+		Double_t Atm = ( timem_c[ii][N-1] - timem_c[ii][0] )/( N-1 ) ;
+		Int_t L = TMath::Nint( maxShift/Atm ) ;
+
+		//x[j] = sim( t_0 + (j-L) Atm ), so that delaying by lag samples pairs meas[k] with x[k+L-lag]
+		WaveformStore::View volts = itotals[ simEntry[ii] ] ;
+		std::vector<Double_t> x( N + 2*L ) , r ;
+		for ( Int_t j = 0 ; j < N + 2*L ; j++ ) x[j] = Interpolate( volts , ( timem_c[ii][0] + (j-L)*Atm )/At ) ;
+		fft::Correlate( voltm_c[ii] , x , 2*L+1 , r ) ;
+
+		if ( alignMode == kAlignGlobal ) {
+			if ( rsum.size() < r.size() ) rsum.resize( r.size() , 0. ) ;
+			for ( size_t d = 0 ; d < r.size() ; d++ ) rsum[d] += r[d] ;
+			Atsum = Atm ;
+			continue ;
 		}
 
+		Int_t dmax = std::max_element( r.begin() , r.end() ) - r.begin() ;
+		shift[ii] = ( L - ( dmax + fft::ParabolicPeak( r , dmax ) ) )*Atm ;
 
 	}
 
-	chi2 = chi2/(TRACSsim[0]->GetchiFinal()*TRACSsim[0]->GetchiFinal());
-
-	//thechi2??
-	delete wvit ;
-	return chi2 ;
+	if ( alignMode == kAlignGlobal && rsum.size() > 0 ) {
+		Int_t L = ( rsum.size() - 1 )/2 ;
+		Int_t dmax = std::max_element( rsum.begin() , rsum.end() ) - rsum.begin() ;
+		shift.assign( Nevm , ( L - ( dmax + fft::ParabolicPeak( rsum , dmax ) ) )*Atsum ) ;
+	}
 
 }
 
@@ -19,30 +19,73 @@
 
 
 #include <TRACSInterface.h>
+#include <HetctWriter.h>
+#include <EdgeLayout.h>
 #include <mutex>          // std::mutex
+#include <map>
+#include <TDirectory.h>
 
 
 std::mutex mtx2;
 
+/*
+ * Transfer function of the readout (histogram shtf of file, as H1DConvolution), read
+ * once for all the interfaces, leaving gDirectory untouched.
+ */
+static void read_transfer_function(const std::string & file, std::vector<double> & tf, double & tfdt)
+{
+	static std::mutex mtx_tf;
+	static std::map<std::string, std::pair<std::vector<double>, double> > read;
+	std::lock_guard<std::mutex> lock(mtx_tf);
+
+	if (read.count(file) == 0)
+	{
+		TDirectory::TContext ctx;
+		TFile * ftf = TFile::Open(file.c_str());
+		TH1D * htf = (ftf != nullptr) ? (TH1D *) ftf->Get("shtf") : nullptr;
+		if (htf == nullptr)
+		{
+			std::cout << "Error: cannot read transfer function shtf from " << file << std::endl;
+			std::cout << "Exiting!" << std::endl;
+			exit(-1);
+		}
+		std::vector<double> v;
+		for (int i = 1; i <= htf->GetNbinsX(); i++) v.push_back(htf->GetBinContent(i));
+		read[file] = std::make_pair(v, htf->GetBinCenter(2) - htf->GetBinCenter(1));
+		ftf->Close();
+		delete ftf;
+	}
+
+	tf = read[file].first;
+	tfdt = read[file].second;
+}
+
 /*
  * The constructor mainly initializes all the values that will be used during the execution. Firstly it read most of them from the steering file by means of a parsing method inside utilities class.
  * Another important task carrying out here is the definition of the vectors and coordinates. Vectors to store currents and coordinates to define the scanning, positions, steps...
  * When the information is set up, a new instance of a detector can be launched, one per TRACSInterface object, avoiding data races and concurrent access to same positions memory when solving field equations in the
  * detector. Making copy constructor and passing copies of detector instances is expensive for the program and do not work, neither improve the performance. Same behavior is used with the current collection.
- * The only global variable shared by threads is the one that stores the total induce current vItotals, but it is important to note that threads access uniquely to their tid position in the vector.
+ * The only global variable shared by threads is the one that stores the total induce current vItotals, but it is important to note that threads access uniquely to the rows of their own z positions.
+ * A private store and number of z partitions can be given instead, so that several independent simulations (e.g. the points of a fit Jacobian) can run at once
+ * without touching vItotals.
  */
 /**
  *
  * @param filename
+ * @param nparts
+ * @param store
  */
-TRACSInterface::TRACSInterface(std::string filename)
+TRACSInterface::TRACSInterface(std::string filename, int nparts, WaveformStore * store)
 {
 	neff_param = std::vector<double>(8,0);
 	total_crosses = 0;
+	int conv = 0;
+	std::string tfFile = "none";
+	double bandwidth = 0.;
 
 	utilities::parse_config_file(filename, carrierFile, depth, width,  pitch, nns, temp, trapping, fluence, nThreads, n_cells_x, n_cells_y, bulk_type,
 			implant_type, waveLength, scanType, C, dt, max_time, vInit, deltaV, vMax, vDepletion, zInit, zMax, deltaZ, yInit, yMax, deltaY, neff_param, neffType,
-			tolerance, chiFinal, diffusion, fitNorm/*, gen_time*/);
+			tolerance, chiFinal, diffusion, fitNorm, conv, tfFile, bandwidth/*, gen_time*/);
 
 	// Initialize vectors / n_Steps / detector / set default zPos, yPos, vBias / carrier_collection
 
@@ -65,14 +108,16 @@ TRACSInterface::TRACSInterface(std::string filename)
 	n_zSteps2 = (int) std::floor (n_zSteps - n_zSteps1);
 
 	// if more threads than points
-	if(num_threads>n_zSteps+1)
+	n_parts = (nparts > 0) ? nparts : num_threads;
+	if(n_parts>n_zSteps+1)
 	{
-		num_threads = n_zSteps+1;
-		std::cout << "No. of threads > No. of z points! reducing No. of threads to."<< num_threads << std::endl;
+		n_parts = n_zSteps+1;
+		if (nparts <= 0) num_threads = n_parts;
+		std::cout << "No. of threads > No. of z points! reducing No. of threads to."<< n_parts << std::endl;
 	}
 
-	n_zSteps_array = (int) std::floor ((n_zSteps+1) / num_threads);
-	n_zSteps_iter = (int) std::round ((n_zSteps+1) / (num_threads)*1.0);
+	n_zSteps_array = (int) std::floor ((n_zSteps+1) / n_parts);
+	n_zSteps_iter = (int) std::round ((n_zSteps+1) / (n_parts)*1.0);
 	n_vSteps = (int) std::floor((vMax-vInit)/deltaV);
 	n_ySteps = (int) std::floor((yMax-yInit)/deltaY);
 	//WRITING TO FILES!
@@ -91,6 +136,22 @@ TRACSInterface::TRACSInterface(std::string filename)
 
 	n_tSteps = (int) std::floor(max_time / dt);
 
+	fidelity = 1;
+	convolution = false;
+	electronics = new ElectronicsResponse(dt);
+	electronics->AddRC(50.*C);
+	if (!tfFile.empty() && tfFile != "none")
+	{
+		std::vector<double> tf;
+		double tfdt;
+		read_transfer_function(tfFile, tf, tfdt);
+		electronics->AddTransferFunction(tf, tfdt);
+	}
+	if (bandwidth > 0.) electronics->AddBandwidth(bandwidth);
+	n_cells_x0 = n_cells_x;
+	n_cells_y0 = n_cells_y;
+	dt0 = dt;
+
 	carrierCollection = new CarrierCollection(detector);
 	QString carrierFileName = QString::fromUtf8(carrierFile.c_str());
 	carrierCollection->add_carriers_from_file(carrierFileName, scanType, depth);
@@ -108,11 +169,11 @@ TRACSInterface::TRACSInterface(std::string filename)
 	z_shifts2.resize((size_t) n_zSteps2+1,0.);
 
 	//distribute z coordinates evenly between threads
-	z_shifts_array.resize(num_threads);
+	z_shifts_array.resize(n_parts);
 	int t_sum = 0;
-	for (int i = 0; i < num_threads; i++)
+	for (int i = 0; i < n_parts; i++)
 	{
-		n_zSteps_iter = (int) (std::ceil (((float)(n_zSteps+1-t_sum) / (num_threads-i))));
+		n_zSteps_iter = (int) (std::ceil (((float)(n_zSteps+1-t_sum) / (n_parts-i))));
 		z_shifts_array[i].resize(n_zSteps_iter, 0.);
 		t_sum += n_zSteps_iter;
 	}
@@ -135,12 +196,12 @@ TRACSInterface::TRACSInterface(std::string filename)
 	//"sampling" z array
 	int l = 0;
 
-	for (int i = 0; i < num_threads; i++)
+	for (int i = 0; i < n_parts; i++)
 	{	l = i;
 	for (uint j = 0; j < z_shifts_array[i].size(); j++ )
 	{
 		z_shifts_array[i][j] = z_shifts[l];
-		l+=num_threads;
+		l+=n_parts;
 	}
 	}
 
@@ -152,7 +213,11 @@ TRACSInterface::TRACSInterface(std::string filename)
 
 	vBias = vInit;
 	set_tcount(0);
-	vItotals.resize(voltages.size()*z_shifts.size());
+	itotals = (store != nullptr) ? store : &vItotals;
+	//Streaming output: the global store only gives the row numbers, no room for samples
+	itotals->Resize(voltages.size(), y_shifts.size(), z_shifts.size(), (itotals == &vItotals && resultSink != nullptr) ? 0 : n_tSteps, floatStore);
+	//Steering "convolution = 1": convolved currents of the scan kept in vIconv (private stores skip it)
+	if (itotals == &vItotals) set_Convolution(conv == 1);
 	i_ramo  = NULL;
 	i_rc    = NULL;
 	i_conv  = NULL;
@@ -168,6 +233,7 @@ TRACSInterface::~TRACSInterface()
 	delete i_conv;
 	delete carrierCollection;
 	delete detector;
+	delete electronics;
 }
 
 /*
@@ -218,13 +284,10 @@ TH1D * TRACSInterface::GetItRc()
 		hname.Form("Ramo_current_%d_%d", tcount, count2);
 		i_rc    = new TH1D(htit,hname, n_tSteps, 0.0, max_time);
 
-		double RC = 50.*C; // Ohms*Farad
-		double alfa = dt/(RC+dt);
-
+		shape_rc();
 
 		for (int j = 1; j <n_tSteps; j++)
 		{
-			i_shaped[j]=i_shaped[j-1]+alfa*(i_total[j]-i_shaped[j-1]);
 			i_rc->SetBinContent(j+1, i_shaped[j]);
 		}
 		count2++;
@@ -233,6 +296,21 @@ TH1D * TRACSInterface::GetItRc()
 	return i_rc;
 }
 
+/*
+ * Simulates a simple RC circuit on i_total and leaves the result in i_shaped.
+ * No histogram is created.
+ */
+void TRACSInterface::shape_rc()
+{
+	double RC = 50.*C; // Ohms*Farad
+	double alfa = dt/(RC+dt);
+
+	for (int j = 1; j <n_tSteps; j++)
+	{
+		i_shaped[j]=i_shaped[j-1]+alfa*(i_total[j]-i_shaped[j-1]);
+	}
+}
+
 /*
  * Convert i_total to TH1D after convolution with the amplifier TransferFunction. ROOT based method.
  */
@@ -245,14 +323,9 @@ TH1D * TRACSInterface::GetItConv()
 	{
 		//TF1 *f1 = new TF1("f1","abs(sin(x)/x)*sqrt(x)",0,10);
 		//float r = f1->GetRandom();
-		TString htit, hname;
-		htit.Form("ramo_conv_%d_%d", tcount, count3);
-		hname.Form("Ramo current_%d_%d", tcount, count3);
-		i_conv  = new TH1D(htit,hname,n_tSteps, 0.0, max_time);
+		//H1DConvolution books its own histogram and is thread safe
 		i_ramo = GetItRamo();
-		//mtx2.lock();
 		i_conv = H1DConvolution( i_ramo , C*1.e12, tcount );
-		//mtx2.unlock();
 		count3++;
 	}
 	return i_conv;
@@ -328,6 +401,13 @@ std::vector<double>TRACSInterface::get_NeffParam()
 	return neff_param;
 } 
 
+/*
+ * Output file named by write_header
+ */
+std::string TRACSInterface::get_hetctFilename(){
+	return hetct_rc_filename;
+}
+
 int TRACSInterface::GetnSteps(){
 	return n_tSteps;
 }
@@ -344,6 +424,18 @@ int TRACSInterface::GettotalCrosses(){
 	return total_crosses;
 }
 
+int TRACSInterface::GetNparts(){
+	return n_parts;
+}
+
+int TRACSInterface::get_Fidelity(){
+	return fidelity;
+}
+
+bool TRACSInterface::get_Convolution(){
+	return convolution;
+}
+
 UShort_t TRACSInterface::GetYear(){
 	time_t currentTime;
 	struct tm *localTime;
@@ -481,6 +573,8 @@ void TRACSInterface::set_tcount(int tid)
  * Sets the desired Neff parameters in the detector. Fields should be calculated
  * again before simulating any current. Note that different neff parametrizations
  * use different parameters so not all may be used at once.
+ * The carrier collection keeps pointers to the detector, so it is rebuilt
+ * together with it.
  */
 /**
  *
@@ -489,18 +583,26 @@ void TRACSInterface::set_tcount(int tid)
 void TRACSInterface::set_FitParam(std::vector<double> newFitParam)
 {
 
-	for (uint i = 0 ; neff_param.size(); i++)
+	for (uint i = 0 ; i < neff_param.size(); i++)
 	{
 		neff_param[i] = newFitParam[i];
 	}
 	fitNorm = newFitParam[8];
-	depth = newFitParam[9];
+	if (newFitParam.size() > 9) depth = newFitParam[9]; //Fits of the Neff and the norm only keep the depth
+	delete carrierCollection;
 	delete detector;
 	detector = new SMSDetector(pitch, width, depth, nns, bulk_type, implant_type, n_cells_x, n_cells_y, temp, trapping, fluence, neff_param, neffType, diffusion, dt);
 	//detector->setFitParameters(newFitParam);
+	carrierCollection = new CarrierCollection(detector);
+	QString carrierFileName = QString::fromUtf8(carrierFile.c_str());
+	carrierCollection->add_carriers_from_file(carrierFileName, scanType, depth, fidelity);
 
 }
 
+/**
+ *
+ * @param vector_fitTri
+ */
 void TRACSInterface::set_Fit_Norm(std::vector<double> vector_fitTri)
 {
 
@@ -508,13 +610,68 @@ void TRACSInterface::set_Fit_Norm(std::vector<double> vector_fitTri)
 	vDepletion = vector_fitTri[1];
 	depth = vector_fitTri[2];
 	C = vector_fitTri[3];
+	electronics->SetRC(50.*C);
+	delete carrierCollection;
 	delete detector;
 	detector = new SMSDetector(pitch, width, depth, nns, bulk_type, implant_type, n_cells_x, n_cells_y, temp, trapping, fluence, neff_param, neffType, diffusion, dt);
+	carrierCollection = new CarrierCollection(detector);
+	QString carrierFileName = QString::fromUtf8(carrierFile.c_str());
+	carrierCollection->add_carriers_from_file(carrierFileName, scanType, depth, fidelity);
 
 }
 
 
 
+/*
+ * Enables the convolution of every current with the amplifier transfer function
+ * during loop_on, kept in vIconv. To be called before loop_on.
+ */
+/**
+ *
+ * @param on
+ */
+void TRACSInterface::set_Convolution(bool on)
+{
+	//Same shape for every thread of the scan: only the first call allocates
+	convolution = on;
+	if (convolution) vIconv.Resize(voltages.size(), y_shifts.size(), z_shifts.size(), 2*n_tSteps, floatStore);
+}
+
+/*
+ * Readout chain applied to every current of loop_on: the RC, then the TransferFunction
+ * and Bandwidth stages of the steering file. More stages can be added.
+ */
+ElectronicsResponse * TRACSInterface::GetElectronics()
+{
+	return electronics;
+}
+
+/*
+ * Sets a reduced fidelity for quick simulations: the mesh cells (CellsX, CellsY)
+ * are divided and the time step (TimeStep) multiplied by factor, and only one
+ * carrier out of factor is drifted. factor = 1 restores the steering file values.
+ * The detector and the carriers are rebuilt at the next set_FitParam or set_Fit_Norm.
+ */
+/**
+ *
+ * @param factor
+ */
+void TRACSInterface::set_Fidelity(int factor)
+{
+	if (factor < 1) factor = 1;
+	fidelity = factor;
+	n_cells_x = std::max(1, n_cells_x0 / fidelity);
+	n_cells_y = std::max(1, n_cells_y0 / fidelity);
+	dt = dt0 * fidelity;
+	electronics->SetTimeStep(dt);
+
+	n_tSteps = (int) std::floor(max_time / dt);
+	i_elec.resize((size_t) n_tSteps);
+	i_hole.resize ((size_t) n_tSteps);
+	i_total.resize((size_t) n_tSteps);
+	i_shaped.resize((size_t) n_tSteps);
+}
+
 /*
  * Calculates the electric field and potential inside the detector. It is 
  * required after any modification of the Neff or the bias voltage applied. 
@@ -575,6 +732,9 @@ void TRACSInterface::set_carrierFile(std::string newCarrFile)
 
 void TRACSInterface::loop_on(int tid)
 {
+	std::vector<int> rows; //Currents of this part in the store, shaped all together at the end
+	std::vector<double> shaped; //Current streamed to the sink, shaped alone
+	std::vector<double> conv;
 
 
 	for (int vPos = 0; vPos < n_vSteps + 1; vPos++)
@@ -597,17 +757,26 @@ void TRACSInterface::loop_on(int tid)
 						  << " of " << y_shifts.back() << " || Voltage " << voltages[vPos] << " of " << voltages.back() << std::endl;
 				set_zPos(z_shifts_array[tid][zPos]);
 				simulate_ramo_current();
-				if (num_threads > 1)
-					i_rc_array[tid][zPos] = GetItRc();
-				else i_rc_array[vPos][zPos] = GetItRc();
 
 				//-------------------------
 				//Build and sort the final array of currents.
 				//First, get the position of the Z.
 				std::vector<double>::iterator it = find(z_shifts.begin(), z_shifts.end(), z_shifts_array[tid][zPos]);
 				auto pos = it - z_shifts.begin();
-				int ind = vPos*z_shifts.size() + pos;
-				vItotals[ind] = i_shaped;
+				int ind = itotals->Index(vPos, yPos, pos);
+				if (itotals == &vItotals && resultSink != nullptr)
+				{
+					shaped.assign(std::begin(i_total), std::end(i_total));
+					electronics->Apply(shaped, 1, n_tSteps);
+					std::copy(shaped.begin(), shaped.end(), std::begin(i_shaped));
+					resultSink->Push(ind, i_shaped, detector->get_temperature(), y_shifts[yPos], z_shifts_array[tid][zPos], voltages[vPos]);
+				}
+				else
+				{
+					//Raw current, shaped after the loop
+					itotals->Set(ind, i_total);
+					rows.push_back(ind);
+				}
 				//-------------------------
 				//Filling histograms-------> commented for Fitting
 				//i_ramo = GetItRamo();
@@ -616,22 +785,70 @@ void TRACSInterface::loop_on(int tid)
 				//i_rc = GetItRc();
 				//i_rc_array[tid][zPos] = i_rc; // for output
 
-				//Check this: Pbm with TFile opened many times. Commented 8.11.2016 cause we don't need conv for the moment
-				//mtx2.lock();
-				//i_conv = GetItConv();
-				//i_conv_array[tid][zPos] = i_conv; // for output
-				//mtx2.unlock();
+				//Transfer function read once and convolution lock free: no need of mtx2 any more
+				if (convolution && itotals == &vItotals)
+				{
+					H1DConvolution(i_total, dt, conv); // for output
+					vIconv.Set(ind, conv.data(), conv.size());
+				}
 
 			}
 
 
 		}
-		if (tid == 0) fields_hist_to_file(tid, vPos);
+		if (tid == 0 && itotals == &vItotals) fields_hist_to_file(tid, vPos);
+
+	}
 
+	//No rows would mean all of them
+	if (!rows.empty())
+	{
+		electronics->Apply(*itotals, rows);
+		check_electronics((*itotals)[rows.back()]);
 	}
+	else if (!shaped.empty()) check_electronics(WaveformStore::View(shaped.data(), shaped.size(), false));
 
 }
 
+/*
+ * Checks that the readout chain, when it is only the RC, shaped v as shape_rc does
+ * with the current C (v holds the shaped i_total, i.e. the last current simulated).
+ */
+/**
+ *
+ * @param v
+ */
+void TRACSInterface::check_electronics(const WaveformStore::View & v)
+{
+	if (electronics->GetNStages() != 1) return;
+
+	shape_rc();
+	double dmax = 0., imax = 0.;
+	for (int j = 0; j < n_tSteps && j < (int) v.size(); j++)
+	{
+		dmax = std::max(dmax, std::fabs(v[j] - i_shaped[j]));
+		imax = std::max(imax, std::fabs(i_shaped[j]));
+	}
+
+	//Float stores keep about 7 digits
+	if (dmax > 1.e-5*imax)
+	{
+		std::cout << "Readout chain and shape_rc differ by " << dmax << " (C = " << C << " F)" << std::endl;
+		std::cout << "Exiting!" << std::endl;
+		exit(-1);
+	}
+}
+
+/*
+ * Name of the output files of the scan (.hetct; the tree takes the same name, .root)
+ */
+void TRACSInterface::set_hetctFilename()
+{
+	// filename for data analysis
+	hetct_conv_filename = start+"_dt"+dtime+"ps_"+cap+"pF_t"+trap+"ns_dz"+stepZ+"um_dy"+stepY+"dV"+stepV+"V_"+neigh+"nns_"+scanType+"_"+std::to_string(tcount)+"_conv.hetct";
+	//hetct_noconv_filename = start+"_dt"+dtime+"ps_"+cap+"pF_t"+trap+"ns_dz"+stepZ+"um_dy"+stepY+"dV"+stepV+"V_"+neigh+"nns_"+scanType+"_"+std::to_string(tcount)+"_noconv.hetct";
+	hetct_rc_filename = start+"_dt"+dtime+"ps_"+cap+"pF_t"+trap+"ns_dz"+stepZ+"um_dy"+stepY+"dV"+stepV+"V_"+neigh+"nns_"+scanType+"_"+std::to_string(tcount)+"_rc.hetct";
+}
 /*
  *
  * Write to file header. The input int is used to label files (multithreading)!
@@ -654,11 +871,9 @@ void TRACSInterface::write_header(int tid)
 	std::vector<double> aux_ysh(n_ySteps+1);
 	aux_ysh = y_shifts;
 	std::transform(aux_ysh.begin(), aux_ysh.end(), aux_ysh.begin(), std::bind1st(std::multiplies<double>(),(1./1000.)));
-	// filename for data analysis
-	//hetct_conv_filename = start+"_dt"+dtime+"ps_"+cap+"pF_t"+trap+"ns_dz"+stepZ+"um_dy"+stepY+"dV"+stepV+"V_"+neigh+"nns_"+scanType+"_"+std::to_string(tcount)+"_conv.hetct";
-	//hetct_noconv_filename = start+"_dt"+dtime+"ps_"+cap+"pF_t"+trap+"ns_dz"+stepZ+"um_dy"+stepY+"dV"+stepV+"V_"+neigh+"nns_"+scanType+"_"+std::to_string(tcount)+"_noconv.hetct";
-	hetct_rc_filename = start+"_dt"+dtime+"ps_"+cap+"pF_t"+trap+"ns_dz"+stepZ+"um_dy"+stepY+"dV"+stepV+"V_"+neigh+"nns_"+scanType+"_"+std::to_string(tcount)+"_rc.hetct";
 
+	// filename for data analysis
+	set_hetctFilename();
 
 	// write header for data analysis
 	//utilities::write_to_hetct_header(hetct_conv_filename, detector, C, dt, aux_ysh, aux_zsh, waveLength, scanType, carrierFile, voltages);
@@ -667,81 +882,95 @@ void TRACSInterface::write_header(int tid)
 
 }
 /*
- *Resizing for storing data in memory 
- *and using it later/writing to a single output file.
+ * Writing to a single file, one row per point of the scan taken from vItotals,
+ * in the order of its rows (the one of ResultSink)
+ *
+ *
+ */
+/**
  *
+ * @param tid
  */
-void TRACSInterface::resize_array()
+void TRACSInterface::write_to_file(int tid)
 {
-	i_ramo_array.resize(num_threads);
-	i_rc_array.resize(num_threads);
-	i_conv_array.resize(num_threads);
+	write_header(tid);
 
-	for (int i = 0; i < num_threads; i++)
-	{
-		i_ramo_array[i].resize(z_shifts_array[i].size());
-		i_rc_array[i].resize(z_shifts_array[i].size());
-		i_conv_array[i].resize(z_shifts_array[i].size());
-		std::cout << "i_ramo_array[xlen][ylen]   " << i_ramo_array.size()<<"  " <<i_ramo_array[i].size() <<std::endl;
-	}
+	std::cout << "Writing to file..." <<std::endl;
 
+	std::vector<HetctWriter::Row> rows;
+	HetctWriter::Row row;
+	row.temp = detector->get_temperature();
 
-	if(num_threads == 1){
-		i_rc_array.resize(n_vSteps + 1);
-		for (int i = 0; i <= n_vSteps; i++)
+	//loop
+	for (int vPos = 0; vPos < n_vSteps + 1; vPos++)
+	{
+		for (int yPos = 0; yPos < n_ySteps + 1; yPos++)
 		{
-			i_rc_array[i].resize(z_shifts_array[0].size());
+			for (uint zPos = 0; zPos < z_shifts.size(); zPos++)
+			{
+				row.wave = vItotals[vItotals.Index(vPos, yPos, zPos)];
+				row.yShift = y_shifts[yPos];
+				row.height = z_shifts[zPos];
+				row.voltage = voltages[vPos];
+				rows.push_back(row);
+			}
+
 		}
+
 	}
 
+	//File open once, rows formatted by all the threads
+	HetctWriter out(hetct_rc_filename);
+	out.Write(rows, num_threads);
 
+	write_conv_to_file(tid);
 
 }
 /*
- * Writing to a single file
- *
- *
+ * Writing the convolved currents of vIconv to the _conv.hetct file, header included and
+ * rows in the order of write_to_file. Called by write_to_file, or once the threads are
+ * joined when the shaped currents went to a ResultSink.
  */
 /**
  *
  * @param tid
  */
-void TRACSInterface::write_to_file(int tid)
+void TRACSInterface::write_conv_to_file(int tid)
 {
-	write_header(tid);
+	if (!convolution) return;
 
-	std::cout << "Writing to file..." <<std::endl;
+	// Convert Z and Y to milimeters
+	std::vector<double> aux_zsh = z_shifts;
+	std::transform(aux_zsh.begin(), aux_zsh.end(), aux_zsh.begin(), std::bind1st(std::multiplies<double>(),(1./1000.)));
+	std::vector<double> aux_ysh = y_shifts;
+	std::transform(aux_ysh.begin(), aux_ysh.end(), aux_ysh.begin(), std::bind1st(std::multiplies<double>(),(1./1000.)));
 
-	//n_par0 = (int) z_shifts_array[tid].size()-1;
-	params[0] = 0; //thread
-	params[1] = 0; //yPos;
-	params[2] = 0; //vPos;
-	n_par1 = n_ySteps;
-	n_par2 = n_vSteps;
-	//loop
-	for (params[2] = 0; (num_threads == 1) ? params[2] <= 0 : params[2] < n_par2 + 1; params[2]++)
+	set_hetctFilename();
+	utilities::write_to_hetct_header(hetct_conv_filename, detector, C, dt, aux_ysh, aux_zsh, waveLength, scanType, carrierFile, voltages);
+
+	std::cout << "Writing convolved currents to " << hetct_conv_filename << std::endl;
+
+	std::vector<HetctWriter::Row> rows;
+	HetctWriter::Row row;
+	row.temp = detector->get_temperature();
+
+	for (int vPos = 0; vPos < n_vSteps + 1; vPos++)
 	{
-		for (params[1] = 0; (num_threads == 1) ? params[1] <= 0 : params[1] < n_par1 + 1; params[1]++)
+		for (int yPos = 0; yPos < n_ySteps + 1; yPos++)
 		{
-			for (int i = 0; (num_threads == 1) ? i < n_vSteps + 1 : i < num_threads; i++)
+			for (uint zPos = 0; zPos < z_shifts.size(); zPos++)
 			{
-				for (params[0] = 0; (num_threads == 1) ? params[0] < i_rc_array[i].size() : params[0] < i_ramo_array[i].size(); params[0]++)
-				{
-					//utilities::write_to_file_row(hetct_noconv_filename, i_ramo_array[i][params[0]], detector->get_temperature(), y_shifts[params[1]], z_shifts_array[i][params[0]], voltages[params[2]]);
-					//utilities::write_to_file_row(hetct_conv_filename, i_conv_array[i][params[0]], detector->get_temperature(), y_shifts[params[1]], z_shifts_array[i][params[0]], voltages[params[2]]);
-					if(num_threads > 1)
-						utilities::write_to_file_row(hetct_rc_filename, i_rc_array[i][params[0]], detector->get_temperature(), y_shifts[params[1]], z_shifts_array[i][params[0]], voltages[params[2]]);
-					else utilities::write_to_file_row(hetct_rc_filename, i_rc_array[i][params[0]], detector->get_temperature(), y_shifts[0], z_shifts_array[0][params[0]], voltages[i]);
-
-				}
-
+				row.wave = vIconv[vIconv.Index(vPos, yPos, zPos)];
+				row.yShift = y_shifts[yPos];
+				row.height = z_shifts[zPos];
+				row.voltage = voltages[vPos];
+				rows.push_back(row);
 			}
-
 		}
-
 	}
 
-
+	HetctWriter out(hetct_conv_filename);
+	out.Write(rows, num_threads);
 
 }
 
@@ -795,8 +1024,8 @@ void TRACSInterface::GetTree( TTree *tree ) {
 	em->time = new Double_t [n_tSteps] ;
 	em->Qt = new Double_t [n_tSteps] ;
 
-	// Create branches
-	tree->Branch("raw", &em,32000,0);
+	// Create branches, split in columns (see EdgeLayout.h)
+	edgelayout::Branch( tree , "raw" , &em ) ;
 
 	//Read RAW file
 	DumpToTree( em , tree ) ;
@@ -913,9 +1142,9 @@ void TRACSInterface::DumpToTree( TMeas *em , TTree *tree ) {
 		em->utc = date ;
 
 		em->At = dt*1.e9 ; emh->At = em->At ;
-		std::valarray<double> I_tot = vItotals[iloop];//vectorObjetosSimuladosAlmacenadosCorrelativamente.Get_Itot[iloop] ;
+		WaveformStore::View I_tot = (*itotals)[iloop] ;
 		for ( int i=0 ; i< em->Nt ; i++) {
-			em->volt[i] = I_tot[i] ;
+			em->volt[i] = ( i < (int) I_tot.size() ) ? I_tot[i] : 0. ;
 			em->time[i] = i*em->At ;
 
 		}
@@ -928,12 +1157,13 @@ void TRACSInterface::DumpToTree( TMeas *em , TTree *tree ) {
 
 		//Now postprocess this entry (find out baseline, rtime and so on
 		//TWaveform *wvi = new TWaveform( em ) ;
-		TWaveform wvi = TWaveform( em ) ;
+		TWaveform wvi( em , kTRUE ) ;
+		wvi.Evaluate( em ) ;
 
-		if (iRead==0) tree->Branch("proc" , &wvi , 32000 , 0 );
+		if (iRead==0) tree->Branch("proc" , &wvi , edgelayout::kBasket , edgelayout::kSplit );
 
 
-		tree->Fill() ;
+		edgelayout::Fill( tree , em ) ;
 		iRead++   ;
 
 		//delete wvi ;
@@ -943,7 +1173,7 @@ void TRACSInterface::DumpToTree( TMeas *em , TTree *tree ) {
 	}
 
 	emh->Polarity = (Polarity>1) ? 1 : -1 ;
-	tree->GetUserInfo()->Add( emh ) ;
+	edgelayout::AddHeader( tree , emh ) ;
 	em->Ntevent=iRead ; //It does not go into the tree, only in the class!
 
 	//delete emh ;
@@ -952,3 +1182,46 @@ void TRACSInterface::DumpToTree( TMeas *em , TTree *tree ) {
 }
 
 
+/*
+ * Header of the tree of the scan, with the values parse_TRACS reads from the header
+ * of the .hetct file
+ */
+/**
+ *
+ * @return
+ */
+TMeasHeader * TRACSInterface::GetMeasHeader( ) {
+
+	Int_t NV = n_vSteps + 1 ;
+
+	TMeasHeader *emh=new TMeasHeader( NV ) ;
+	emh->Lambda = waveLength ;
+	emh->NV = NV ;
+	emh->comment = "" ;
+	emh->Setup = 5 ;
+	emh->Fluence = fluence ;
+	emh->Nav  = 1 ;
+	emh->Gain = 0. ;
+	emh->iann = 0. ;
+	if      ( scanType == "edge" ) emh->Illum = 0 ;
+	else if ( scanType == "top" )  emh->Illum = 1 ;
+	else                           emh->Illum = -1 ;
+
+	//Vbias vector
+	for ( int i=0 ; i< NV ; i++) emh->vVbias[i] = voltages[i] ;
+
+	//Steps in um
+	emh->Ax = 0. ;
+	emh->Nx = 1 ;
+	emh->Ay = ( n_ySteps > 0 ) ? deltaY : 0. ;
+	emh->Ny = n_ySteps + 1 ;
+	emh->Az = ( n_zSteps > 0 ) ? deltaZ : 0. ;
+	emh->Nz = n_zSteps + 1 ;
+
+	//ns and pF
+	emh->At = dt*1.e9 ;
+	emh->Cend = C*1.e12 ;
+
+	return emh ;
+
+}
@@ -0,0 +1,242 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************TRACSJournal***********************************
+ *
+ * Every record is flushed as soon as it is written, so a fit killed at any moment
+ * loses at most the simulation in progress. A last line cut by the kill is ignored
+ * when the journal is read back.
+ *
+ */
+
+#include <TRACSJournal.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+
+/*
+ * 64 bit FNV-1a of a block of bytes
+ */
+static uint64_t FNV1a( const void * data , size_t n , uint64_t h = 14695981039346656037ULL ) {
+
+	const unsigned char * c = (const unsigned char *) data ;
+	for ( size_t i = 0 ; i < n ; i++ ) {
+		h ^= c[i] ;
+		h *= 1099511628211ULL ;
+	}
+	return h ;
+
+}
+
+/*
+ * Hash of the bit patterns of the parameters (-0. taken as 0., since they compare equal)
+ */
+size_t TRACSJournal::ParHash::operator( )( const std::vector<double> & par ) const {
+
+	uint64_t h = 14695981039346656037ULL ;
+	for ( size_t i = 0 ; i < par.size() ; i++ ) {
+		double v = ( par[i] == 0. ) ? 0. : par[i] ;
+		h = FNV1a( &v , sizeof(double) , h ) ;
+	}
+	return (size_t) h ;
+
+}
+
+/*
+ * Opens the journal for appending. Evaluations already present are loaded into the cache.
+ * The key identifies the fit (measurement, condition, steering file...): a journal written
+ * for a different one is not used.
+ */
+/**
+ *
+ * @param filename
+ * @param key
+ */
+TRACSJournal::TRACSJournal( std::string filename , std::string key ) {
+
+	nhits = 0 ;
+	lastStage = 0 ;
+
+	Read( filename , key ) ;
+
+	fp = fopen( filename.c_str() , "a" ) ;
+	if ( fp == NULL ) {
+		std::cout << "Error: cannot open journal " << filename << std::endl ;
+		std::cout << "Exiting!"<< std::endl ;
+		exit(-1);
+	}
+	if ( ftell( fp ) == 0 ) fprintf( fp , "H %016llx\n" , (unsigned long long) FNV1a( key.data() , key.size() ) ) ;
+	fflush( fp ) ;
+
+	if ( cache.size() > 0 ) std::cout << "Journal " << filename << ": " << cache.size() << " evaluations, last completed stage " << lastStage << ". Resuming." << std::endl ;
+
+}
+
+TRACSJournal::~TRACSJournal( ) {
+
+	fclose( fp ) ;
+
+}
+
+/**
+ *
+ * @param filename
+ * @param key
+ */
+void TRACSJournal::Read( std::string filename , std::string key ) {
+
+	std::ifstream in( filename.c_str() ) ;
+	if ( !in.good() ) return ;
+
+	char hkey[32] ;
+	snprintf( hkey , sizeof(hkey) , "%016llx" , (unsigned long long) FNV1a( key.data() , key.size() ) ) ;
+
+	std::string line ;
+	bool complete = true ;
+	while ( std::getline( in , line ) ) {
+
+		complete = !in.eof() ; //Last line without '\n': interrupted while writing
+		if ( !complete ) break ;
+
+		std::istringstream ss( line ) ;
+		std::string type , tok ;
+		ss >> type ;
+
+		if ( type == "H" ) {
+			ss >> tok ;
+			if ( tok != hkey ) {
+				std::cout << "Error: journal " << filename << " belongs to a different fit" << std::endl ;
+				std::cout << "Exiting!"<< std::endl ;
+				exit(-1);
+			}
+		}
+		else if ( type == "E" ) {
+			int stage , npar ;
+			ss >> stage >> tok >> npar ;
+			double chi2 = strtod( tok.c_str() , NULL ) ;
+			std::vector<double> par ;
+			while ( (int) par.size() < npar && ( ss >> tok ) ) par.push_back( strtod( tok.c_str() , NULL ) ) ;
+			if ( (int) par.size() == npar ) cache[par] = chi2 ;
+		}
+		else if ( type == "S" ) {
+			int stage , valid , nfcn , npar ;
+			std::string fval , edm ;
+			if ( !( ss >> stage >> valid >> fval >> edm >> nfcn >> npar ) ) continue ;
+			std::vector<double> val , err ;
+			while ( (int) val.size() < npar && ( ss >> tok ) ) val.push_back( strtod( tok.c_str() , NULL ) ) ;
+			while ( (int) err.size() < npar && ( ss >> tok ) ) err.push_back( strtod( tok.c_str() , NULL ) ) ;
+			if ( (int) err.size() == npar ) {
+				stages[stage] = std::make_pair( val , err ) ;
+				lastStage = stage ;
+			}
+		}
+
+	}
+	in.close() ;
+
+	//Terminate a cut line so that the next record starts on its own line
+	if ( !complete ) {
+		std::ofstream out( filename.c_str() , std::ios::app ) ;
+		out << std::endl ;
+	}
+
+}
+
+/*
+ * chi2 of an already evaluated parameter vector
+ */
+/**
+ *
+ * @param par
+ * @param chi2
+ * @return
+ */
+bool TRACSJournal::Lookup( const std::vector<double> & par , double & chi2 ) {
+
+	std::lock_guard<std::mutex> lock( jmtx ) ;
+	std::unordered_map< std::vector<double> , double , ParHash >::const_iterator it = cache.find( par ) ;
+	if ( it == cache.end() ) return false ;
+	chi2 = it->second ;
+	nhits++ ;
+	return true ;
+
+}
+
+/**
+ *
+ * @param stage
+ * @param par
+ * @param chi2
+ */
+void TRACSJournal::Record( int stage , const std::vector<double> & par , double chi2 ) {
+
+	std::lock_guard<std::mutex> lock( jmtx ) ;
+	cache[par] = chi2 ;
+
+	fprintf( fp , "E %d %a %d" , stage , chi2 , (int) par.size() ) ;
+	for ( size_t i = 0 ; i < par.size() ; i++ ) fprintf( fp , " %a" , par[i] ) ;
+	fprintf( fp , "\n" ) ;
+	fflush( fp ) ;
+
+}
+
+/*
+ * State at the end of a minimization stage
+ */
+/**
+ *
+ * @param stage
+ * @param valid
+ * @param fval
+ * @param edm
+ * @param nfcn
+ * @param val
+ * @param err
+ * @param fixed
+ */
+void TRACSJournal::RecordStage( int stage , bool valid , double fval , double edm , int nfcn , const std::vector<double> & val , const std::vector<double> & err , const std::vector<bool> & fixed ) {
+
+	std::lock_guard<std::mutex> lock( jmtx ) ;
+	lastStage = stage ;
+	stages[stage] = std::make_pair( val , err ) ;
+
+	fprintf( fp , "S %d %d %a %a %d %d" , stage , (int) valid , fval , edm , nfcn , (int) val.size() ) ;
+	for ( size_t i = 0 ; i < val.size() ; i++ ) fprintf( fp , " %a" , val[i] ) ;
+	for ( size_t i = 0 ; i < err.size() ; i++ ) fprintf( fp , " %a" , err[i] ) ;
+	for ( size_t i = 0 ; i < fixed.size() ; i++ ) fprintf( fp , " %d" , (int) fixed[i] ) ;
+	fprintf( fp , "\n" ) ;
+	fflush( fp ) ;
+
+}
+
+/**
+ *
+ * @param stage
+ * @param val
+ * @param err
+ * @return
+ */
+bool TRACSJournal::GetStage( int stage , std::vector<double> & val , std::vector<double> & err ) {
+
+	std::lock_guard<std::mutex> lock( jmtx ) ;
+	std::map< int , std::pair< std::vector<double> , std::vector<double> > >::const_iterator it = stages.find( stage ) ;
+	if ( it == stages.end() ) return false ;
+	val = it->second.first ;
+	err = it->second.second ;
+	return true ;
+
+}
@@ -0,0 +1,287 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************TRACSLMFit***********************************
+ *
+ * Levenberg-Marquardt minimization of a sum of squared residuals.
+ *
+ * Each iteration needs the Jacobian (one batch of nfree residual vectors, forward
+ * differences), one residual vector for the trial step and, with geodesic acceleration,
+ * one more for the second directional derivative. The Jacobian is only recomputed
+ * after an accepted step. Errors are taken from (J^T J)^-1, which is the covariance
+ * Minuit would quote for Up=1 since the Hessian of chi2 is 2 J^T J.
+ *
+ */
+
+#include <TRACSLMFit.h>
+
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+/*
+ * Solves A x = b by Cholesky decomposition. Returns false if A is not positive definite.
+ */
+static bool CholeskySolve( const std::vector< std::vector<double> > & A , const std::vector<double> & b , std::vector<double> & x ) {
+
+	int n = b.size() ;
+	std::vector< std::vector<double> > L( n , std::vector<double>( n , 0. ) ) ;
+	for ( int i=0 ; i<n ; i++ ) {
+		for ( int j=0 ; j<=i ; j++ ) {
+			double s = A[i][j] ;
+			for ( int k=0 ; k<j ; k++ ) s -= L[i][k]*L[j][k] ;
+			if ( i==j ) {
+				if ( !(s>0.) ) return false ;
+				L[i][i] = std::sqrt( s ) ;
+			}
+			else L[i][j] = s/L[j][j] ;
+		}
+	}
+
+	x.assign( n , 0. ) ;
+	for ( int i=0 ; i<n ; i++ ) {
+		double s = b[i] ;
+		for ( int k=0 ; k<i ; k++ ) s -= L[i][k]*x[k] ;
+		x[i] = s/L[i][i] ;
+	}
+	for ( int i=n-1 ; i>=0 ; i-- ) {
+		double s = x[i] ;
+		for ( int k=i+1 ; k<n ; k++ ) s -= L[k][i]*x[k] ;
+		x[i] = s/L[i][i] ;
+	}
+	return true ;
+
+}
+
+static double SumSq( const std::vector<double> & v ) {
+	double s = 0. ;
+	for ( size_t i=0 ; i<v.size() ; i++ ) s += v[i]*v[i] ;
+	return s ;
+}
+
+/**
+ *
+ * @param fcn
+ * @param par
+ * @param err
+ */
+TRACSLMFit::TRACSLMFit( BatchResiduals fcn , const std::vector<double> & par , const std::vector<double> & err ) :
+	fcn( fcn ) , par( par ) , step( err ) , fixed( par.size() , false ) , errors( err ) {
+
+	chi2 = 0. ;
+	edm = std::numeric_limits<double>::max() ;
+	lambda = 1.e-3 ;
+	tolerance = 0.01 ;
+	maxIter = 100 ;
+	nIter = 0 ;
+	nFcn = 0 ;
+	printLevel = 1 ;
+	geodesic = true ;
+	valid = false ;
+
+}
+
+void TRACSLMFit::Fix( int ipar ) { fixed[ipar] = true ; }
+
+void TRACSLMFit::Release( int ipar ) { fixed[ipar] = false ; }
+
+void TRACSLMFit::SetValue( int ipar , double val ) { par[ipar] = val ; }
+
+void TRACSLMFit::SetError( int ipar , double err ) { step[ipar] = err ; errors[ipar] = err ; }
+
+//---------------------------------------------------------------------------
+
+void TRACSLMFit::Evaluate( const std::vector< std::vector<double> > & pars , std::vector< std::vector<double> > & res ) {
+
+	res.resize( pars.size() ) ;
+	fcn( pars , res ) ;
+	nFcn += pars.size() ;
+
+}
+
+//---------------------------------------------------------------------------
+/*
+ * Forward differences, all the free parameters displaced at once in a single batch.
+ * The step is 1e-3 of the parameter value, or of its initial error if it is zero.
+ */
+void TRACSLMFit::Jacobian( ) {
+
+	int nf = ifree.size() ;
+	std::vector< std::vector<double> > pars( nf , par ) , res ;
+	std::vector<double> h( nf ) ;
+	for ( int k=0 ; k<nf ; k++ ) {
+		h[k] = 1.e-3*std::fabs( par[ifree[k]] ) ;
+		if ( h[k] == 0. ) h[k] = 1.e-3*step[ifree[k]] ;
+		pars[k][ifree[k]] += h[k] ;
+	}
+	Evaluate( pars , res ) ;
+
+	J.assign( nf , std::vector<double>( r.size() , 0. ) ) ;
+	for ( int k=0 ; k<nf ; k++ )
+		for ( size_t i=0 ; i<r.size() ; i++ ) J[k][i] = ( res[k][i] - r[i] )/h[k] ;
+
+	JtJ.assign( nf , std::vector<double>( nf , 0. ) ) ;
+	Jtr.assign( nf , 0. ) ;
+	for ( int k=0 ; k<nf ; k++ ) {
+		for ( size_t i=0 ; i<r.size() ; i++ ) Jtr[k] += J[k][i]*r[i] ;
+		for ( int l=0 ; l<=k ; l++ ) {
+			double s = 0. ;
+			for ( size_t i=0 ; i<r.size() ; i++ ) s += J[k][i]*J[l][i] ;
+			JtJ[k][l] = JtJ[l][k] = s ;
+		}
+	}
+
+}
+
+//---------------------------------------------------------------------------
+
+void TRACSLMFit::CalcErrors( ) {
+
+	int nf = ifree.size() ;
+	cov.assign( par.size() , std::vector<double>( par.size() , 0. ) ) ;
+
+	for ( int k=0 ; k<nf ; k++ ) {
+		std::vector<double> e( nf , 0. ) , x ;
+		e[k] = 1. ;
+		if ( !CholeskySolve( JtJ , e , x ) ) {
+			std::cout << "TRACSLMFit: J^T J is singular, errors not available" << std::endl ;
+			valid = false ;
+			return ;
+		}
+		for ( int l=0 ; l<nf ; l++ ) cov[ifree[k]][ifree[l]] = x[l] ;
+	}
+	for ( int k=0 ; k<nf ; k++ ) errors[ifree[k]] = std::sqrt( cov[ifree[k]][ifree[k]] ) ;
+
+}
+
+//---------------------------------------------------------------------------
+/*
+ * Runs the minimization from the current parameter values. Converges when the
+ * estimated distance to the minimum, edm = (J^T r)^T (J^T J)^-1 (J^T r), falls
+ * below 0.002*tolerance as for Migrad with Up=1.
+ */
+bool TRACSLMFit::Minimize( ) {
+
+	valid = false ;
+	ifree.clear() ;
+	for ( size_t i=0 ; i<par.size() ; i++ ) if ( !fixed[i] ) ifree.push_back( i ) ;
+	int nf = ifree.size() ;
+
+	std::vector< std::vector<double> > pars( 1 , par ) , res ;
+	Evaluate( pars , res ) ;
+	r = res[0] ;
+	chi2 = SumSq( r ) ;
+
+	lambda = 1.e-3 ;
+	double nu = 2. ;
+	bool newJ = true ;
+
+	for ( nIter = 0 ; nIter < maxIter ; nIter++ ) {
+
+		if ( newJ ) {
+			Jacobian( ) ;
+			newJ = false ;
+			std::vector<double> x ;
+			edm = ( CholeskySolve( JtJ , Jtr , x ) ) ? 0. : std::numeric_limits<double>::max() ;
+			for ( size_t k=0 ; k<x.size() ; k++ ) edm += Jtr[k]*x[k] ;
+			if ( printLevel > 0 ) std::cout << "TRACSLMFit: iteration " << nIter << " chi2= " << chi2 << " edm= " << edm << " lambda= " << lambda << std::endl ;
+			if ( edm < 0.002*tolerance ) {
+				valid = true ;
+				break ;
+			}
+		}
+
+		//Damped normal equations ( J^T J + lambda diag(J^T J) ) delta = - J^T r
+		std::vector< std::vector<double> > A = JtJ ;
+		std::vector<double> mg( nf ) , delta ;
+		for ( int k=0 ; k<nf ; k++ ) {
+			A[k][k] += lambda*std::max( JtJ[k][k] , std::numeric_limits<double>::min() ) ;
+			mg[k] = -Jtr[k] ;
+		}
+		if ( !CholeskySolve( A , mg , delta ) ) {
+			lambda *= nu ; nu *= 2. ;
+			continue ;
+		}
+
+		std::vector<double> dp = delta ;
+		if ( geodesic ) {
+
+			//Second directional derivative of r along delta, then acceleration -(A)^-1 J^T r_vv
+			double h = 0.1 ;
+			std::vector<double> ph = par ;
+			for ( int k=0 ; k<nf ; k++ ) ph[ifree[k]] += h*delta[k] ;
+			pars.assign( 1 , ph ) ;
+			Evaluate( pars , res ) ;
+
+			std::vector<double> mJrvv( nf , 0. ) , acc ;
+			for ( size_t i=0 ; i<r.size() ; i++ ) {
+				double Jd = 0. ;
+				for ( int k=0 ; k<nf ; k++ ) Jd += J[k][i]*delta[k] ;
+				double rvv = 2./h*( ( res[0][i] - r[i] )/h - Jd ) ;
+				for ( int k=0 ; k<nf ; k++ ) mJrvv[k] -= J[k][i]*rvv ;
+			}
+
+			if ( CholeskySolve( A , mJrvv , acc ) ) {
+				//Acceleration must stay small compared to the velocity, otherwise damp more
+				if ( 2.*std::sqrt( SumSq( acc ) ) > 0.75*std::sqrt( SumSq( delta ) ) ) {
+					lambda *= nu ; nu *= 2. ;
+					continue ;
+				}
+				for ( int k=0 ; k<nf ; k++ ) dp[k] += 0.5*acc[k] ;
+			}
+
+		}
+
+		std::vector<double> pnew = par ;
+		for ( int k=0 ; k<nf ; k++ ) pnew[ifree[k]] += dp[k] ;
+		pars.assign( 1 , pnew ) ;
+		Evaluate( pars , res ) ;
+		double chi2new = SumSq( res[0] ) ;
+
+		//Decrease predicted by the linear model |r + J dp|^2
+		double pred = 0. ;
+		for ( int k=0 ; k<nf ; k++ ) {
+			pred -= 2.*dp[k]*Jtr[k] ;
+			for ( int l=0 ; l<nf ; l++ ) pred -= dp[k]*JtJ[k][l]*dp[l] ;
+		}
+
+		if ( chi2new < chi2 ) {
+			double rho = ( pred > 0. ) ? ( chi2 - chi2new )/pred : 1. ;
+			par = pnew ;
+			r = res[0] ;
+			chi2 = chi2new ;
+			lambda *= std::max( 1./3. , 1. - std::pow( 2.*rho - 1. , 3 ) ) ;
+			nu = 2. ;
+			newJ = true ;
+		}
+		else {
+			lambda *= nu ; nu *= 2. ;
+		}
+
+		if ( lambda > 1.e16 ) {
+			std::cout << "TRACSLMFit: no further decrease of chi2 is possible" << std::endl ;
+			break ;
+		}
+
+	}
+
+	if ( nIter >= maxIter ) std::cout << "TRACSLMFit: maximum number of iterations reached" << std::endl ;
+
+	//Errors at the final point
+	if ( newJ ) Jacobian( ) ;
+	CalcErrors( ) ;
+
+	return valid ;
+
+}
@@ -0,0 +1,263 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************TRACSSurrogate***********************************
+ *
+ * The emulator is the cubic RBF interpolant with a linear tail
+ *
+ *      s(u) = sum_k w_k |u - u_k|^3 + c_0 + c . u
+ *
+ * in coordinates u scaled by the initial errors, fitted to every residual bin with the
+ * same centres u_k, so one LU decomposition serves all of them. It reproduces the
+ * simulated residuals exactly at the centres.
+ *
+ * Starting from the best point simulated so far, Levenberg-Marquardt minimizes the emulated
+ * chi2. The step, cut to the trust radius, is simulated together with nBatch-1 random points
+ * around it (they refine the emulator where the minimum is expected). The trust radius is
+ * doubled when the simulated decrease of chi2 is close to the predicted one and halved when
+ * it is far from it. The search converges when the emulator, which is exact at the best
+ * point, predicts from there a decrease below 0.002*tolerance, as Migrad's edm.
+ *
+ * Errors come from the J^T J of the emulated residuals at the end.
+ *
+ */
+
+#include <TRACSSurrogate.h>
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+static double SumSq( const std::vector<double> & v ) {
+	double s = 0. ;
+	for ( size_t i=0 ; i<v.size() ; i++ ) s += v[i]*v[i] ;
+	return s ;
+}
+
+static double Distance( const std::vector<double> & a , const std::vector<double> & b ) {
+	double s = 0. ;
+	for ( size_t i=0 ; i<a.size() ; i++ ) s += ( a[i]-b[i] )*( a[i]-b[i] ) ;
+	return std::sqrt( s ) ;
+}
+
+/**
+ *
+ * @param fcn
+ * @param par
+ * @param err
+ */
+TRACSSurrogate::TRACSSurrogate( BatchResiduals fcn , const std::vector<double> & par , const std::vector<double> & err ) :
+	fcn( fcn ) , par( par ) , scale( err ) , errors( err ) , fixed( par.size() , false ) {
+
+	ibest = 0 ;
+	tolerance = 0.01 ;
+	nBatch = 1 ;
+	maxFcn = 1000 ;
+	nIter = 0 ;
+	nFcn = 0 ;
+	printLevel = 1 ;
+	rng.seed( 4357 ) ;
+
+}
+
+void TRACSSurrogate::Fix( int ipar ) { fixed[ipar] = true ; }
+
+//---------------------------------------------------------------------------
+
+std::vector<double> TRACSSurrogate::Coordinates( const std::vector<double> & p ) const {
+
+	std::vector<double> u( ifree.size() ) ;
+	for ( size_t k=0 ; k<ifree.size() ; k++ ) u[k] = ( p[ifree[k]] - par[ifree[k]] )/scale[ifree[k]] ;
+	return u ;
+
+}
+
+/*
+ * Simulates pars and adds them to the centres of the emulator.
+ */
+void TRACSSurrogate::Evaluate( const std::vector< std::vector<double> > & pars ) {
+
+	std::vector< std::vector<double> > r( pars.size() ) ;
+	fcn( pars , r ) ;
+	nFcn += pars.size() ;
+
+	for ( size_t i=0 ; i<pars.size() ; i++ ) {
+		pts.push_back( pars[i] ) ;
+		res.push_back( r[i] ) ;
+		chi2.push_back( SumSq( r[i] ) ) ;
+		X.push_back( Coordinates( pars[i] ) ) ;
+		if ( chi2.back() < chi2[ibest] ) ibest = chi2.size() - 1 ;
+	}
+
+}
+
+/*
+ * Interpolation weights of all the residual bins. Returns false if the centres do
+ * not determine the interpolant (too few of them or degenerate).
+ */
+bool TRACSSurrogate::Train( ) {
+
+	int n = X.size() , d = ifree.size() , N = n + d + 1 ;
+	if ( n < d + 1 ) return false ;
+
+	std::vector< std::vector<double> > A( N , std::vector<double>( N , 0. ) ) ;
+	for ( int i=0 ; i<n ; i++ ) {
+		for ( int j=0 ; j<n ; j++ ) A[i][j] = std::pow( Distance( X[i] , X[j] ) , 3 ) ;
+		A[i][n] = A[n][i] = 1. ;
+		for ( int k=0 ; k<d ; k++ ) A[i][n+1+k] = A[n+1+k][i] = X[i][k] ;
+	}
+
+	//LU decomposition with partial pivoting
+	std::vector<int> perm( N ) ;
+	for ( int i=0 ; i<N ; i++ ) perm[i] = i ;
+	double amax = 0. ;
+	for ( int i=0 ; i<N ; i++ ) for ( int j=0 ; j<N ; j++ ) amax = std::max( amax , std::fabs( A[i][j] ) ) ;
+	for ( int c=0 ; c<N ; c++ ) {
+		int p = c ;
+		for ( int i=c+1 ; i<N ; i++ ) if ( std::fabs( A[i][c] ) > std::fabs( A[p][c] ) ) p = i ;
+		if ( std::fabs( A[p][c] ) <= 1.e-13*amax ) return false ;
+		std::swap( A[p] , A[c] ) ;
+		std::swap( perm[p] , perm[c] ) ;
+		for ( int i=c+1 ; i<N ; i++ ) {
+			A[i][c] /= A[c][c] ;
+			for ( int j=c+1 ; j<N ; j++ ) A[i][j] -= A[i][c]*A[c][j] ;
+		}
+	}
+
+	//Right hand sides: the residuals at the centres, zero for the polynomial conditions
+	int m = res[0].size() ;
+	W.assign( N , std::vector<double>( m , 0. ) ) ;
+	for ( int i=0 ; i<N ; i++ ) if ( perm[i] < n ) W[i] = res[perm[i]] ;
+	for ( int i=0 ; i<N ; i++ )
+		for ( int j=0 ; j<i ; j++ ) {
+			double l = A[i][j] ;
+			if ( l != 0. ) for ( int b=0 ; b<m ; b++ ) W[i][b] -= l*W[j][b] ;
+		}
+	for ( int i=N-1 ; i>=0 ; i-- ) {
+		for ( int j=i+1 ; j<N ; j++ ) {
+			double u = A[i][j] ;
+			if ( u != 0. ) for ( int b=0 ; b<m ; b++ ) W[i][b] -= u*W[j][b] ;
+		}
+		for ( int b=0 ; b<m ; b++ ) W[i][b] /= A[i][i] ;
+	}
+	return true ;
+
+}
+
+/**
+ * Emulated residuals at p
+ * @param p
+ * @param r
+ */
+void TRACSSurrogate::Predict( const std::vector<double> & p , std::vector<double> & r ) const {
+
+	int n = X.size() , d = ifree.size() ;
+	std::vector<double> u = Coordinates( p ) ;
+
+	r = W[n] ;
+	for ( int k=0 ; k<d ; k++ ) for ( size_t b=0 ; b<r.size() ; b++ ) r[b] += W[n+1+k][b]*u[k] ;
+	for ( int i=0 ; i<n ; i++ ) {
+		double phi = std::pow( Distance( u , X[i] ) , 3 ) ;
+		for ( size_t b=0 ; b<r.size() ; b++ ) r[b] += W[i][b]*phi ;
+	}
+
+}
+
+//---------------------------------------------------------------------------
+/*
+ * Initial design: the starting point and one error away from it along every free
+ * parameter, on both sides. Then candidates until convergence or maxFcn simulations.
+ */
+/**
+ *
+ * @return true if converged
+ */
+bool TRACSSurrogate::Minimize( ) {
+
+	ifree.clear() ;
+	for ( size_t i=0 ; i<par.size() ; i++ ) if ( !fixed[i] ) ifree.push_back( i ) ;
+	int d = ifree.size() ;
+
+	std::vector< std::vector<double> > pars( 1 , par ) ;
+	for ( int k=0 ; k<d ; k++ ) {
+		pars.push_back( par ) ; pars.back()[ifree[k]] += scale[ifree[k]] ;
+		pars.push_back( par ) ; pars.back()[ifree[k]] -= scale[ifree[k]] ;
+	}
+	Evaluate( pars ) ;
+
+	double radius = 1. ;
+	bool converged = false ;
+	std::normal_distribution<double> gauss( 0. , 1. ) ;
+	std::uniform_real_distribution<double> uni( 0. , 1. ) ;
+
+	for ( nIter = 0 ; nFcn < maxFcn && d > 0 ; nIter++ ) {
+
+		if ( !Train() ) {
+			std::cout << "TRACSSurrogate: degenerate centres, adding random points" << std::endl ;
+			pars.assign( std::max( nBatch , 1 ) , pts[ibest] ) ;
+			for ( size_t i=0 ; i<pars.size() ; i++ ) for ( int k=0 ; k<d ; k++ ) pars[i][ifree[k]] += radius*scale[ifree[k]]*( 2.*uni( rng ) - 1. ) ;
+			Evaluate( pars ) ;
+			continue ;
+		}
+
+		//Minimum of the emulated chi2 starting from the best point
+		TRACSLMFit lm( [this] ( const std::vector< std::vector<double> > & p , std::vector< std::vector<double> > & r ) {
+				for ( size_t i=0 ; i<p.size() ; i++ ) Predict( p[i] , r[i] ) ;
+			} , pts[ibest] , scale ) ;
+		for ( size_t i=0 ; i<par.size() ; i++ ) if ( fixed[i] ) lm.Fix( i ) ;
+		lm.SetPrintLevel( 0 ) ;
+		lm.SetTolerance( 0.1*tolerance ) ;
+		lm.Minimize() ;
+		errors = lm.Errors() ;
+
+		//Step cut to the trust region
+		std::vector<double> cand = lm.Parameters() ;
+		std::vector<double> ub = Coordinates( pts[ibest] ) , uc = Coordinates( cand ) ;
+		double step = Distance( ub , uc ) ;
+		if ( step > radius ) {
+			for ( int k=0 ; k<d ; k++ ) cand[ifree[k]] = pts[ibest][ifree[k]] + radius/step*( cand[ifree[k]] - pts[ibest][ifree[k]] ) ;
+			step = radius ;
+		}
+		std::vector<double> rc ;
+		Predict( cand , rc ) ;
+		double chi2best = chi2[ibest] , pred = chi2best - SumSq( rc ) ;
+
+		if ( printLevel > 0 ) std::cout << "TRACSSurrogate: iteration " << nIter << " simulations= " << nFcn << " chi2= " << chi2best << " predicted decrease= " << pred << " radius= " << radius << std::endl ;
+		if ( pred < 0.002*tolerance ) {
+			converged = true ;
+			break ;
+		}
+		if ( radius < 1.e-6 ) break ;
+
+		//Candidate and random points in a ball of half the radius around it
+		pars.assign( 1 , cand ) ;
+		for ( int i=1 ; i<nBatch ; i++ ) {
+			std::vector<double> dir( d ) ;
+			for ( int k=0 ; k<d ; k++ ) dir[k] = gauss( rng ) ;
+			double norm = std::sqrt( SumSq( dir ) ) , rr = 0.5*radius*std::pow( uni( rng ) , 1./d ) ;
+			pars.push_back( cand ) ;
+			for ( int k=0 ; k<d ; k++ ) pars.back()[ifree[k]] += rr/norm*dir[k]*scale[ifree[k]] ;
+		}
+		size_t first = chi2.size() ;
+		Evaluate( pars ) ;
+
+		double rho = ( chi2best - chi2[first] )/pred ;
+		if ( rho > 0.75 && step > 0.99*radius ) radius *= 2. ;
+		else if ( rho < 0.25 ) radius = 0.5*std::min( radius , step ) ;
+
+	}
+
+	if ( !converged ) std::cout << "TRACSSurrogate: stopped without convergence after " << nFcn << " simulations" << std::endl ;
+	return converged ;
+
+}
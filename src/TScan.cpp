@@ -34,11 +34,16 @@ TScan::TScan(  ) {
   Fluence = iann = tann	= Etann	= TempAnn = Ldiffx = Ldiffy = Ldiffz = 0.;
   FwQx=FwQy=FwQz=FWHMQx = FWHMQy=FWHMQz=RMSQx=RMSQy=RMSQz=0;
   cce = Itot = 0. ;
+  cols = 0 ;
+  hvtVb = 0 ;
 
 }
 
 TScan::TScan( char *fnm , Double_t Cend ) {
           
+     #if BATCH==1
+       gROOT->SetBatch(kTRUE) ;   //The helpers that draw to get their histograms do it off screen
+     #endif
      
      /* OPEN RAW DATA FILES */
      
@@ -82,13 +87,17 @@ TScan::TScan( char *fnm , Double_t Cend ) {
      z0file=em->z;   
      
        
-     TWaveform *wv = new TWaveform( em ) ;     
+     TWaveform *wv = new TWaveform( ) ;     
      TBranch *proc = tree->GetBranch("proc") ;
      proc->SetAddress(&wv) ;
      
      TMeasHeader *emh = (TMeasHeader *) tree->GetUserInfo()->At(0) ;
     
      tree->GetEntry(0) ;  //Commented 19Sept2012
+     
+     //All the per entry quantities below come from here, in one pass over the file
+     cols = new ScanColumns( fnm ) ;
+     hvtVb = 0 ;
           
 
      /* CREATE VECTORS  */
@@ -101,15 +110,18 @@ TScan::TScan( char *fnm , Double_t Cend ) {
      ScanDir[3] =  (NV>0.)? 1 : 0 ;  
      
      dt     = emh->At ;
+     SharedT = emh->SharedT ;
+     Tstart  = emh->Tstart ;
      NV     = emh->NV ;
      Vbhalf = emh->vVbias[NV/2] ;	
-     vhsV_zi.reserve(NV)   ;  vlhsV_zi.reserve(NV) ;
+     //Those filled by voltage index are sized, empty slots are null
+     vhsV_zi.assign(NV,0)  ;  vlhsV_zi.assign(NV,0) ;
      vhsV_Vbi.reserve(NV)  ;  vlhsV_Vbi.reserve(NV) ;
-     vhvtz.reserve(NV)     ;  vhQ2D.reserve(NV) ; 
-     vhvd2D.reserve(NV)    ;  vhvdEw2D.reserve(NV)    ;
-     vhvtx.reserve(NV)     ;  vhtcoll2D.reserve(NV)  ;
+     vhvtz.reserve(NV)     ;  vhQ2D.assign(NV,0) ; 
+     vhvd2D.assign(NV,0)   ;  vhvdEw2D.assign(NV,0)  ;
+     vhvtx.reserve(NV)     ;  vhtcoll2D.assign(NV,0) ;
      vhvty.reserve(NV)     ;
-     CCE.reserve(NV)       ;  
+     CCE.assign(NV,0.)     ;  
      
      //Vectors that will go in the AutoPilot tree
      if ( Nx > 0 ) {
@@ -192,18 +204,12 @@ TScan::TScan( char *fnm , Double_t Cend ) {
      /* GET BlineMean AVERAGE FOR EACH Vbias */
      
      Double_t *vBlineMean = new Double_t [NV] ;
-     TCanvas *cdum = new TCanvas("cdum","cdum",600,400);
-     TH1D *h1;
      for (Int_t i=0 ; i<NV ; i++) {
-       TString selection = Form( "Vbias==%f", Vb[i] ) ;
-       //TString selection = Form( "Vbias==%f &&(z<4.94 || z>5.)", Vb[i] ) ;  //Sick cases where Bline is too short, this may help. 
-       								            //In thoses cases, BlineMean changes with z
-       tree->Draw("BlineMean",selection.Data()) ;
-       h1 = (TH1D*) gPad->GetPrimitive("htemp"); 
-       vBlineMean[i] = h1->GetMean(); 
+       //Sick cases where Bline is too short may need a cut in z as well (z<4.94 || z>5.):  
+       //in thoses cases, BlineMean changes with z
+       vBlineMean[i] = ScanColumns::Mean( cols->BlineMean , cols->Select( Vb[i] ) ) ; 
      }
      BLMean = TMath::Mean(NV,vBlineMean);
-     delete cdum ;
      delete [] vBlineMean ;
 
      
@@ -215,10 +221,11 @@ TScan::TScan( char *fnm , Double_t Cend ) {
      //TString vselection = Form("Vbias==%d",(Int_t) Vbhalf ) ;
      #ifdef ZLIMIT
        TString vselection = Form("Vbias==%d && %s",(Int_t) Vbhalf ,ZLIMIT) ;
+       RoughTRTL( vselection , tree , wv , trtl );
      #else
-       TString vselection = Form("Vbias==%d",(Int_t) Vbhalf ) ;
+       TString vselection ;
+       RoughTRTL( (Int_t) Vbhalf , trtl );
      #endif
-     RoughTRTL( vselection , tree , wv , trtl );
      travg = (ScanDir[2])? trtl[1] : trtl[1] + 10.  ;
      
 
@@ -230,7 +237,11 @@ TScan::TScan( char *fnm , Double_t Cend ) {
      #endif
      
      #if DECONV==0
-       RoughTRTL( vselection , tree , wv , trtl );
+       #ifdef ZLIMIT
+         RoughTRTL( vselection , tree , wv , trtl );
+       #else
+         RoughTRTL( (Int_t) Vbmax , trtl );
+       #endif
      #else
        RoughTRTL( vselection , tree , trtl , Cend );
      #endif
@@ -247,13 +258,11 @@ TScan::TScan( char *fnm , Double_t Cend ) {
        if (c==0) coord='x' ; if (c==1) coord='y' ; if (c==2) coord='z' ;
        qfwhm[c] = 0. ;
        if ( ScanDir[c] ) {
-         tree->Draw(Form("Q50:%c",coord),Form("Vbias==%f",Vbmax)) ;
-	 TGraph *graph = (TGraph*)gPad->GetPrimitive("Graph"); // 2D
-	 Int_t nentries = graph->GetN();
-	 Double_t *zarr = tree->GetV2(); //do not delete these arrays, done by TTree
-	 Double_t *qarr = tree->GetV1();
-	 TH1D *hstat = new TH1D("hstat","hstat",nentries,zarr[0],zarr[nentries-1]);
-	 for (Int_t il=0;il<nentries;il++) hstat->SetBinContent(il+1,qarr[il]);
+         vector<Long64_t> sel = cols->Select( Vbmax ) ;
+	 const vector<Double_t> &carr = (c==0) ? cols->x : (c==1) ? cols->y : cols->z ;
+	 Int_t nentries = sel.size();
+	 TH1D *hstat = new TH1D("hstat","hstat",nentries,carr[sel[0]],carr[sel[nentries-1]]);
+	 for (Int_t il=0;il<nentries;il++) hstat->SetBinContent(il+1,cols->Q50[sel[il]]);
 	 qfwhm[c] = 2.355*hstat->GetRMS() ;
 	 delete hstat ;  
        }
@@ -293,8 +302,9 @@ TScan::TScan( char *fnm , Double_t Cend ) {
 
 TScan::~TScan(  ) {
      
+     delete cols ;
      delete [] Vb ;  N0.Clear()  ;
-     vhsV_zi.clear() ;  vlhsV_zi.clear() ;
+     vhsV_zi.clear() ;  vlhsV_zi.clear() ;  vhsVt.clear() ;
      vhsV_Vbi.clear() ;  vlhsV_Vbi.clear() ;
      vhvtz.clear() ;  vhQ2D.clear() ; 
      vhvd2D.clear()  ; vhvdEw2D.clear()  ; 
@@ -327,7 +337,6 @@ void TScan::RoughTRTL( TString vselection , TTree *tree , TWaveform *wv , Double
      Double_t val , Vmax = -99999.9 , Vmin = 99999.9 ;
      
      vector<Double_t> tr , tl ;
-     vector<Double_t>::iterator min , max ;
      for ( Int_t ii=0 ; ii < nev ; ii++ ) {
 
        Int_t iev = list->GetEntry(ii) ; 
@@ -343,7 +352,43 @@ void TScan::RoughTRTL( TString vselection , TTree *tree , TWaveform *wv , Double
 
      }  
      
+     TLTRAverages( tl , tr , Vmax , Vmin , trtl ) ;
+     tree->SetEventList(0);
+     
+}
+
+//------------------------------------------------------------------------
+void TScan::RoughTRTL( Double_t vbias , Double_t *trtl ) {
+
+     vector<Long64_t> sel = cols->Select( vbias ) ;
+     Int_t  nev  = sel.size() ; 
+     if (nev==0) exit(-1) ;
+     Double_t val , Vmax = -99999.9 , Vmin = 99999.9 ;
+     
+     vector<Double_t> tr , tl ;
+     for ( Int_t ii=0 ; ii < nev ; ii++ ) {
+
+       Long64_t iev = sel[ii] ; 
+              
+       tl.push_back( cols->tleft[iev] ) ;
+       tr.push_back( cols->tright[iev] );
+              
+       val = cols->Vmax[iev] ;
+       if (val > Vmax ) Vmax = val ; 
+       val = cols->Vmin[iev] ;
+       if (val < Vmin ) Vmin = val ; 
+
+     }  
+     
+     TLTRAverages( tl , tr , Vmax , Vmin , trtl ) ;
+     
+}
+
+//------------------------------------------------------------------------
+void TScan::TLTRAverages( vector<Double_t> &tl , vector<Double_t> &tr , Double_t Vmax , Double_t Vmin , Double_t *trtl ) {
+
      Double_t Mean , RMS ;
+     vector<Double_t>::iterator min , max ;
      
      min = min_element( tl.begin() , tl.end() );
      max = max_element( tl.begin() , tl.end() );
@@ -369,8 +414,7 @@ void TScan::RoughTRTL( TString vselection , TTree *tree , TWaveform *wv , Double
      
      tr.clear();
      tl.clear();
-     tree->SetEventList(0);
-     
+
 }
 
 //------------------------------------------------------------------------
@@ -384,7 +428,7 @@ void TScan::RoughTRTL( TString vselection , TTree *tree , Double_t *trtl , Doubl
      raw->SetAddress(&em) ;
      raw->GetEntry(0) ;  
 
-     TWaveform *wv = new TWaveform( em ) ;     
+     TWaveform *wv = new TWaveform( ) ;     
      TBranch *proc  = tree->GetBranch("proc") ;
      proc->SetAddress(&wv) ;
 
@@ -398,37 +442,81 @@ void TScan::RoughTRTL( TString vselection , TTree *tree , Double_t *trtl , Doubl
      
      vector<Double_t> tr , tl ;
      vector<Double_t>::iterator min , max ;
-     for ( Int_t ii=0 ; ii < nev ; ii++ ) {
-
-       Int_t iev = list->GetEntry(ii) ; 
-       tree->GetEntry( iev );    
+     //The derivatives go in blocks through WaveformBatch for their extrema
+     TMeasHeader *emh = (TMeasHeader *) tree->GetUserInfo()->At(0) ;
+     tree->GetEntry( list->GetEntry(0) ) ;
+     em->Expand( emh , wv->BlineGetMean() ) ;
+     Int_t Nt = em->Nt ;
+     vector<Double_t> dtime( em->time , em->time + Nt ) ;
+     WaveformBatch batch( Nt , &dtime[0] ) ;
+     Int_t nb = batch.GetNmax() ;
+     vector<Double_t> dvolt( nb*Nt ) ;
+     TMeas *dem = new TMeas( );
+     dem->Nt = Nt ;
+     dem->time = &dtime[0] ;
+     if (Cend!=0.) dem->Vbias = Vbmax ;
+     Int_t nbl = TMath::Nint( TWaveform::GetT4BL( dem->Setup )/(dtime[1]-dtime[0]) ) ;
+     
+     Int_t noff = 0 ;
+     vector<Int_t> bev( nb ) ;
+     for ( Int_t ii=0 ; ii < nev ; ii+=nb ) {
+
+       batch.Clear() ;
+       for ( Int_t ib=0 ; ib < nb && ii+ib < nev ; ib++ ) {
+         Int_t iev = list->GetEntry(ii+ib) ; 
+         tree->GetEntry( iev );    
+         em->Expand( emh , wv->BlineGetMean() ) ;
        
-       //We need to overwrite volt contents with the derivatieve: dvolt/dt
-       Int_t Nt = wv->GetNbins() ;
-       TMeas *dem = new TMeas( );
-       dem->Nt = Nt ;
-       dem->volt = new Double_t [ Nt ]; 
-       dem->time = new Double_t [ Nt ]; 
-       if (Cend!=0.) dem->Vbias = Vbmax ;
-       for ( Int_t iv = 0 ; iv< Nt ; iv++ ) {        
-	 dem->volt[iv] = ROSC*Cend*(em->volt[iv+1] - em->volt[iv])/dt + em->volt[iv] ;
-	 dem->time[iv] = em->time[iv] ;
+         //Entries off the time axis of the first one are evaluated one by one, as in EdgePipeline
+         if ( !batch.SameAxis( em->Nt , em->time ) ) {
+           if ( noff++ == 0 ) cout << "RoughTRTL: entry " << iev << " is not on the time axis of entry " << list->GetEntry(0) << ", such entries are not batched" << endl ;
+           Int_t nto = em->Nt ;
+           Double_t dto = ( nto > 1 ) ? em->time[1]-em->time[0] : dt ;
+           vector<Double_t> ov( nto ) , oq( nto ) ;
+           for ( Int_t iv = 0 ; iv< nto-1 ; iv++ ) ov[iv] = ROSC*Cend*(em->volt[iv+1] - em->volt[iv])/dto + em->volt[iv] ;
+           if ( nto > 0 ) ov[nto-1] = em->volt[nto-1] ;
+           TMeas oem ;
+           oem.Nt = nto ; oem.time = em->time ; oem.volt = &ov[0] ; oem.Qt = &oq[0] ;
+           oem.Vbias = dem->Vbias ; oem.event = iev ;
+           TWaveform owv( &oem ) ;
+           oem.time = oem.volt = oem.Qt = 0 ;
+           tl.push_back( owv.GetTleft( ) ) ;
+           tr.push_back( owv.GetTright( ) ) ;
+           if ( owv.GetVmax() > Vmax ) Vmax = owv.GetVmax() ;
+           if ( owv.GetVmin() < Vmin ) Vmin = owv.GetVmin() ;
+           continue ;
+         }
+
+         //We need to overwrite volt contents with the derivatieve: dvolt/dt
+         bev[batch.GetN()] = iev ;
+         Double_t *dv = &dvolt[batch.GetN()*Nt] ;
+         for ( Int_t iv = 0 ; iv< Nt ; iv++ ) {        
+	   dv[iv] = ROSC*Cend*(em->volt[iv+1] - em->volt[iv])/dt + em->volt[iv] ;
+         }
+         batch.Add( dv ) ;
        }
-       dem->event = iev ;
-       TWaveform *dwv = new TWaveform( dem ) ;       
+       batch.Extrema( ) ;
+       batch.Baseline( nbl ) ;
        
-       tl.push_back( dwv->GetTleft( ) ) ;
-       tr.push_back( dwv->GetTright( ) ) ;
+       for ( Int_t ib=0 ; ib < batch.GetN() ; ib++ ) {
+         dem->volt = &dvolt[ib*Nt] ;
+         dem->event = bev[ib] ;
+         TWaveform dwv( dem , kTRUE ) ;       
+         dwv.SetExtrema( batch.GetiVmax(ib) , batch.GetiVmin(ib) , batch.GetBlineMean(ib) ) ;
        
-       val = dwv->GetVmax() ;
-       if (val > Vmax ) Vmax = val ; 
-       val = dwv->GetVmin() ;
-       if (val < Vmin ) Vmin = val ; 
+         tl.push_back( dwv.GetTleft( ) ) ;
+         tr.push_back( dwv.GetTright( ) ) ;
+       
+         val = batch.GetVmax(ib) ;
+         if (val > Vmax ) Vmax = val ; 
+         val = batch.GetVmin(ib) ;
+         if (val < Vmin ) Vmin = val ; 
+       }
 
-       delete [] dem->volt ;
-       delete [] dem->time ;
-       delete dwv ;
      }  
+     dem->volt = 0 ;
+     dem->time = 0 ;
+     delete dem ;
      Double_t Mean  = TMath::Mean( tr.begin(), tr.end()) , RMS=TMath::RMS( tr.begin() , tr.end() ) ;
      Double_t travg = Mean+RMS ; 
 
@@ -470,6 +558,7 @@ void TScan::CalcWhereSignal( Int_t coord ){
 	 what = (ATRL==0)? Form("Sum$(%5.2f*%7.5f*(volt[Iteration$+1]-volt[Iteration$])/%f+(volt-BlineMean)*(time>%f && time<%f)):%c", ROSC,Cend,dt,tlavg, travg , xyz) :
                            Form("Sum$(%5.2f*%7.5f*(volt[Iteration$+1]-volt[Iteration$])/%f+(volt-BlineMean)*(time>%f && time<%f)):%c", ROSC,Cend,dt,tlavg, tlavg+ATRL , xyz) ;	    
      #endif
+     what = edgelayout::TimeFormula( what , SharedT , dt , Tstart ) ;
 
      Double_t *z0t0;
      #ifdef ZLIMIT
@@ -522,6 +611,7 @@ void  TScan::VoltVsTime_ci ( Int_t coord ) {
    #if DECONV==1
      what  = Form("%5.2f*%7.5f*(volt[Iteration$+1]-volt[Iteration$])/%5.3f+volt-BlineMean:time-%f" , ROSC , Cend , dt, t0 ) ;
    #endif
+   what = edgelayout::TimeFormula( what , SharedT , dt , Tstart ) ;
    
    
    //Find the measured z value falling closest to z0
@@ -620,6 +710,18 @@ void  TScan::VoltVsTime_ci ( Int_t coord ) {
      Vmin = tVmin ;
    #endif
    
+   #if BATCH==1
+     //Drawn later by Render, one stack per page
+     for (Int_t iv=0 ; iv<NV ;iv++) {
+       hs = vhsV_zi[iv] ;
+       hs->SetTitle( Form( "Vbias=%d V;Time [ns];Signal [V]" , (Int_t) Vb[iv] ) ) ;
+       hs->SetMaximum( tVmax );
+       hs->SetMinimum( tVmin );
+       vhsVt.push_back( make_pair( TString( Form( "Vt%ci" , xyz ) ) , hs ) ) ;
+     }
+     return ;
+   #endif
+   
    for (Int_t iv=0 ; iv<NV ;iv++) {
      hs = vhsV_zi[iv]  ;
      TString tVbias = Form( "Vbias=%d V" , (Int_t) Vb[iv] ) ;
@@ -683,6 +785,10 @@ void  TScan::PlotVar ( Int_t iwhat , Int_t coord ) {
    if (coord==1) vhstcolly.push_back( hs ) ;
    if (coord==2) vhstcollz.push_back( hs ) ;
    
+   #if BATCH==1
+     return ;
+   #endif
+   
    c1  = new TCanvas();
    hs->SetMaximum( TCOLL );
    hs->SetMinimum( 0 );
@@ -712,29 +818,46 @@ void  TScan::VoltVsTime ( ) {
    TCanvas *c1 ;
    TLegend *leg ;
    THStack *hs ;
-   TH1D *h1;
    Double_t tVmax=-2000. , tVmin=2000. ;
 
-   //TString selection=TString("Vbias>-400 && Vbias%20==0");
-   TString selection=TString("");
-   //TString selection=TString("Vbias%40==0");
-   plot1D( (char*) what.Data() , (char*)selection.Data() , 1 , fnm ) ;
-   hs = (THStack *) gPad->GetPrimitive("hs") ;
+   //Mean V(t) of all the positions at each voltage, one histogram per voltage built in
+   //parallel, stacked in voltage order
+   Int_t nt = cols->GetNt() ;
+   const Double_t *time = cols->GetTime() ;
+   vector<TH1D*> vh1( NV , (TH1D*) 0 ) ;
+   PerVoltage( [&] ( Int_t iv ) {
+     vector<Long64_t> sel = cols->Select( (Int_t) Vb[iv] ) ;
+     TString hnm = TString::Format( "%s_%d" , what.Data() , iv ) , htit = TString::Format( "%d V" , (Int_t) Vb[iv] ) ;
+     TH1D *hv = new TH1D( hnm , htit , nt , time[0]-t0-0.5*dt , time[nt-1]-t0+0.5*dt ) ;
+     hv->SetDirectory(0) ;
+     cols->Samples( sel , [&] ( Long64_t iev , const Double_t *v ) {
+       Double_t bl = cols->BlineMean[iev] , norm = sel.size() ;
+       #if I2CORR==1
+         norm *= cols->LPower[iev]*cols->LPower[iev] ;
+       #endif
+       for ( Int_t j=0 ; j<nt ; j++ ) hv->AddBinContent( j+1 , (v[j]-bl)/norm ) ;
+     } ) ;
+     hv->SetLineColor( iv%9+1 ) ;
+     vh1[iv] = hv ;
+   } ) ;
+   
+   hs = new THStack( "hs" , what ) ;
+   for ( Int_t iv = 0 ; iv < NV ; iv++ ) hs->Add( vh1[iv] ) ;
    vhsV_zi[0] = hs  ;
-   TList *hls = (TList *) hs->GetHists()  ;
-   for ( Int_t ih = 0 ; ih < hls->GetSize(); ih++ ) {
-     h1 = (TH1D * ) hls->At(ih) ;
-     TString tit = h1->GetTitle();
-     Int_t ipos = tit.Index("V=");
-     TString stit( tit(ipos+2,7) );
-     h1->SetTitle( stit );
-   }
 
 
    //Needed for deconvolution plots, cause Vmax is for non-deconvoluted
    if ( hs->GetMaximum("nostack") > tVmax)  tVmax = hs->GetMaximum("nostack") ;
    if ( hs->GetMinimum("nostack") < tVmin)  tVmin = hs->GetMinimum("nostack") ;
    
+   #if BATCH==1
+     hs->SetTitle( ";Time [ns];Signal [V]" ) ;
+     hs->SetMaximum( Vmax );
+     hs->SetMinimum( Vmin-0.05*(Vmax-Vmin) );
+     vhsVt.push_back( make_pair( TString( "Vt" ) , hs ) ) ;
+     return ;
+   #endif
+   
    hs = vhsV_zi[0]  ;
    c1  = new TCanvas();
    
@@ -793,40 +916,23 @@ void TScan::TimeCoordVolt2D( Int_t coord ) {
    if (coord==0) { xyz='x'; val0=x0 ;} 
    if (coord==1) { xyz='y'; val0=y0 ;} 
    if (coord==2) { xyz='z'; val0=z0 ;} 
+   TString what  = Form("(volt-BlineMean)=f(time-%f,%c-%f)",t0, xyz, val0) ;
+   #if DECONV==1
+     what  = Form("%5.2f*%f*(volt[Iteration$+1]-volt[Iteration$])/%f+volt-BlineMean=f(time-%f,z-%f)", ROSC , Cend , dt,t0, z0) ;
+   #endif
+   #if I2CORR==1
+     what  = Form("(volt-BlineMean)/(LPower*LPower)=f(time-%f,%c-%f)",t0, xyz,val0) ;
+   #endif
+   
+   //One histogram per voltage, at the middle of the other scanned axes, built in parallel
+   vector<TH2D*> vh2( NV , (TH2D*) 0 ) ;
+   PerVoltage( [&] ( Int_t iv ) { vh2[iv] = TimeCoord2D( what , coord , val0 , cols->Select( (Int_t) Vb[iv] , coord ) ) ; } ) ;
+   
    for ( Int_t iv = 0 ; iv < NV ; iv++ ) {
    
-     TString selection  = Form("Vbias==%d",(Int_t) Vb[iv]) ;
- 
-     //If this is a 2D scan, then go to the center of the other coordinate
-     if ( coord==0 && ScanDir[1] ) selection=selection+Form("&& TMath::Abs(y-%lf)<%lf",y0file+TMath::Nint(Ny/2.)*dy,0.5*dy);
-     if ( coord==0 && ScanDir[2] ) selection=selection+Form("&& TMath::Abs(z-%lf)<%lf",z0file+TMath::Nint(Nz/2.)*dz,0.5*dz);
-     
-     if ( coord==1 && ScanDir[0] ) selection=selection+Form("&& TMath::Abs(x-%lf)<%lf",x0file+TMath::Nint(Nx/2.)*dx,0.5*dx); 
-     if ( coord==1 && ScanDir[2] ) selection=selection+Form("&& TMath::Abs(z-%lf)<%lf",z0file+TMath::Nint(Nz/2.)*dz,0.5*dz); 
-     
-     if ( coord==2 && ScanDir[0] ) selection=selection+Form("&& TMath::Abs(x-%lf)<%lf",x0file+TMath::Nint(Nx/2.)*dx,0.5*dx); 
-     if ( coord==2 && ScanDir[1] ) selection=selection+Form("&& TMath::Abs(y-%lf)<%lf",y0file+TMath::Nint(Ny/2.)*dy,0.5*dy); 
-     
-     TString what  = Form("time-%f:%c-%f:(volt-BlineMean)", t0,xyz,val0) ;
-     #if I2CORR==1
-       what = Form("time-%f:%c-%f:(volt-BlineMean)/(LPower*LPower)", t0,xyz,val0) ;
-     #endif
-     
-     #if DECONV==1
-       what  = Form("time-%f:z-%f:%5.2f*%f*(volt[Iteration$+1]-volt[Iteration$])/%f+volt-BlineMean" , t0,z0, ROSC , Cend , dt ) ;
-     #endif
-     plot2D( (char*) what.Data() , (char*) selection.Data() , fnm ) ;
-     
-     what  = Form("(volt-BlineMean)=f(time-%f,%c-%f)",t0, xyz, val0) ;
-     #if DECONV==1
-       what  = Form("%5.2f*%f*(volt[Iteration$+1]-volt[Iteration$])/%f+volt-BlineMean=f(time-%f,z-%f)", ROSC , Cend , dt,t0, z0) ;
-     #endif
-     #if I2CORR==1
-       what  = Form("(volt-BlineMean)/(LPower*LPower)=f(time-%f,%c-%f)",t0, xyz,val0) ;
-     #endif
+     TString selection ;
      
-     //h2 = (TH2D *) gDirectory->Get(Form("volt-BlineMean=f(time-40.059797,z)") ;
-     h2 = (TH2D *) gPad->GetPrimitive( what.Data() ) ;
+     h2 = vh2[iv] ;
      if (Atrl+2<30.) h2->GetXaxis()->SetRangeUser(-2.0,Atrl+2.0) ;
      else            h2->GetXaxis()->SetRangeUser(-2.0,30.) ;
      Double_t thickness ;
@@ -836,25 +942,38 @@ void TScan::TimeCoordVolt2D( Int_t coord ) {
      h2->GetYaxis()->SetRangeUser(val0-0.01,val0+thickness+0.01) ;
      h2->GetXaxis()->SetTitle("Time [ns]") ;
      h2->GetYaxis()->SetTitle( Form("%c [mm]",xyz) ) ;
-     TPaletteAxis *palette = (TPaletteAxis*)h2->GetListOfFunctions()->FindObject("palette");
-     palette->GetAxis()->SetTitleOffset(1.1); palette->GetAxis()->SetTitleSize(0.045);
-     palette->GetAxis()->SetTitle( "Signal [V]" );
+     h2->GetZaxis()->SetTitle( "Signal [V]" );
      #if I2CORR==1
-       palette->GetAxis()->SetTitleOffset(1.25); palette->GetAxis()->SetTitleSize(0.045);
-       palette->GetAxis()->SetTitle( "Signal [I^{2} corr., a.u.]" );
+       h2->GetZaxis()->SetTitle( "Signal [I^{2} corr., a.u.]" );
+     #endif
+     #if BATCH==0
+       h2->Draw("colz") ;
+       gPad->Update() ;
+       TPaletteAxis *palette = (TPaletteAxis*)h2->GetListOfFunctions()->FindObject("palette");
+       palette->GetAxis()->SetTitleOffset(1.1); palette->GetAxis()->SetTitleSize(0.045);
+       #if I2CORR==1
+         palette->GetAxis()->SetTitleOffset(1.25);
+       #endif
+       palette->GetAxis()->SetTitle( h2->GetZaxis()->GetTitle() );
      #endif
      if (coord==0) vhvtx.push_back(h2) ;     
      if (coord==1) vhvty.push_back(h2) ;     
      if (coord==2) vhvtz.push_back(h2) ;     
 
-     selection=Form("%d V",(Int_t) Vb[iv]) ;
-     if (Atrl+2<30.) text=new TText( 0.8*Atrl, 0.8*thickness , selection );
-     else            text=new TText( 0.8*30. , 0.8*thickness , selection );
-     tv.push_back(text) ;
+     #if BATCH==0
+       selection=Form("%d V",(Int_t) Vb[iv]) ;
+       if (Atrl+2<30.) text=new TText( 0.8*Atrl, 0.8*thickness , selection );
+       else            text=new TText( 0.8*30. , 0.8*thickness , selection );
+       tv.push_back(text) ;
+     #endif
      cout << endl; cout << endl;
 
    }
    
+   #if BATCH==1
+     return ;
+   #endif
+   
    //Plot them (needed in case we wanted to have subpads
    if (PORTRAIT==1)  c2 = new TCanvas("c2","c2",400,600);
    else              c2 = new TCanvas("c2","c2",600,400);
@@ -904,7 +1023,6 @@ void TScan::TimeCoordVolt2D( Int_t coord ) {
       
    tv.clear();
    delete c2 ;  
-   delete h2 ; 
 }
 
 //------------------------------------------------------------------------
@@ -946,21 +1064,13 @@ void TScan::Maps2D( Int_t iwhat ) {
    if ( Plot.EqualTo("Q2D") )  TheAtrl=Atrl;
    if ( Plot.EqualTo("vd2D") ) TheAtrl=0.4;
 
-   TString what , twhat ;
-   if ( Plot.EqualTo("Q2D") || Plot.EqualTo("vd2D")    ) what= Form( "Sum$((volt-BlineMean)*(time>%f &&time<%f))",t0,t0+TheAtrl );
-   if ( Plot.EqualTo("tcoll2D") ) what= TString( Form("tright-%f",tlavg ) );
-
-   if ( ScanDir[0] && ScanDir[1] ) what  = Form("x-%f:y-%f:", x0, y0 ) + what ;
-   if ( ScanDir[0] && ScanDir[2] ) what  = Form("x-%f:z-%f:", x0, z0 ) + what ;
-   if ( ScanDir[1] && ScanDir[2] ) what  = Form("y-%f:z-%f:", y0, z0 ) + what ;
-   #if I2CORR==1
-     if ( Plot.EqualTo("Q2D") || Plot.EqualTo("vd2D") )      { 
-       what  = Form( "Sum$((volt-BlineMean)*(time>%f &&time<%f))/(LPower*LPower)",t0,t0+TheAtrl ) ;
-       if ( ScanDir[0] && ScanDir[1] ) what  = Form("x-%f:y-%f:", x0, y0 ) + what ;
-       if ( ScanDir[0] && ScanDir[2] ) what  = Form("x-%f:z-%f:", x0, z0 ) + what ;
-       if ( ScanDir[1] && ScanDir[2] ) what  = Form("y-%f:z-%f:", y0, z0 ) + what ;
-     }
-   #endif
+   vector<Double_t> what ;
+   TString twhat ;
+   if ( Plot.EqualTo("Q2D") || Plot.EqualTo("vd2D")    ) what = cols->Window( t0 , t0+TheAtrl , I2CORR==1 ) ;
+   if ( Plot.EqualTo("tcoll2D") ) { 
+     what = cols->tright ;
+     for ( UInt_t i=0 ; i<what.size() ; i++ ) what[i] -= tlavg ;
+   }
 
 
    //Titles of the histograms that are going to be created
@@ -980,33 +1090,34 @@ void TScan::Maps2D( Int_t iwhat ) {
    }
 
 
+   //One map per voltage, built in parallel; then titled and drawn in voltage order
+   vector<TH2D*> vh2( NV , (TH2D*) 0 ) ;
+   PerVoltage( [&] ( Int_t iv ) { vh2[iv] = Map2D( twhat , cols->Select( (Int_t) Vb[iv] ) , what ) ; } ) ;
+   
    TH2D *h2 ;
    for ( Int_t iv = 0 ; iv < NV ; iv++ ) {
    
-     TString selection  = Form("Vbias==%d",(Int_t) Vb[iv]) ;
+     TString selection ;
      
-     plot2D( (char*) what.Data() , (char*) selection.Data() , fnm ) ;
-          
-     h2 = (TH2D *) gPad->GetPrimitive( twhat.Data() ) ; 
+     h2 = vh2[iv] ; 
      
 
      if ( ScanDir[0] && ScanDir[1] ) { h2->GetXaxis()->SetTitle("X [mm]") ; h2->GetYaxis()->SetTitle("Y [mm]") ; }
      if ( ScanDir[0] && ScanDir[2] ) { h2->GetXaxis()->SetTitle("X [mm]") ; h2->GetYaxis()->SetTitle("Z [mm]") ; }
      if ( ScanDir[1] && ScanDir[2] ) { h2->GetXaxis()->SetTitle("Y [mm]") ; h2->GetYaxis()->SetTitle("Z [mm]") ; }
-     TPaletteAxis *palette = (TPaletteAxis*)h2->GetListOfFunctions()->FindObject("palette");
-     palette->GetAxis()->SetTitleOffset(1.1); palette->GetAxis()->SetTitleSize(0.045);
      
+     //Title of the palette, kept as that of the Z axis 
      if ( Plot.EqualTo("Q2D" ) || Plot.EqualTo("vd2D") ) { 
        if ( Plot.EqualTo("Q2D") ) {
-         palette->GetAxis()->SetTitle( Form("Charge in %d ns [a.u.]",TMath::Nint(TheAtrl)) );
+         h2->GetZaxis()->SetTitle( Form("Charge in %d ns [a.u.]",TMath::Nint(TheAtrl)) );
 	 #if I2CORR==1
-	   palette->GetAxis()->SetTitle( Form("Charge in %d ns [I^{2} corr., a.u.]",TMath::Nint(TheAtrl)) );
+	   h2->GetZaxis()->SetTitle( Form("Charge in %d ns [I^{2} corr., a.u.]",TMath::Nint(TheAtrl)) );
 	 #endif
        } 
        if ( Plot.EqualTo("vd2D") ) {
-         palette->GetAxis()->SetTitle( "Drift velocity [a.u.]" );
+         h2->GetZaxis()->SetTitle( "Drift velocity [a.u.]" );
 	 #if I2CORR==1
-	   palette->GetAxis()->SetTitle( "Drift velocity [I^{2} corr., a.u.]" );
+	   h2->GetZaxis()->SetTitle( "Drift velocity [I^{2} corr., a.u.]" );
 	 #endif
        }
        
@@ -1022,15 +1133,23 @@ void TScan::Maps2D( Int_t iwhat ) {
      }
      
      if ( Plot.EqualTo("tcoll2D" ) ) {
-       palette->GetAxis()->SetTitle( Form("Collection Time [ns]") );
+       h2->GetZaxis()->SetTitle( Form("Collection Time [ns]") );
        vhtcoll2D[iv]=h2 ;    
      }
 
      selection=Form("%d V",(Int_t) Vb[iv]) ;
      
-     TLatex text = TLatex();
-     text.SetNDC();
-     text.DrawLatex(0.17, 0.8, selection.Data() );
+     #if BATCH==0
+       h2->Draw("colz") ;
+       gPad->Update() ;
+       TPaletteAxis *palette = (TPaletteAxis*)h2->GetListOfFunctions()->FindObject("palette");
+       palette->GetAxis()->SetTitleOffset(1.1); palette->GetAxis()->SetTitleSize(0.045);
+       palette->GetAxis()->SetTitle( h2->GetZaxis()->GetTitle() );
+       
+       TLatex text = TLatex();
+       text.SetNDC();
+       text.DrawLatex(0.17, 0.8, selection.Data() );
+     #endif
 
      tv.push_back(selection) ;
      cout << endl; cout << endl;
@@ -1060,6 +1179,10 @@ void TScan::Maps2D( Int_t iwhat ) {
    f2Dout->Write();
    f2Dout->Close();
    
+   #if BATCH==1
+     tv.clear();
+     return ;
+   #endif
      
    //Plot them (needed in case we wanted to have subpads
    if (PORTRAIT==1)  c2 = new TCanvas("c2","c2",400,600);
@@ -1116,8 +1239,86 @@ void TScan::Maps2D( Int_t iwhat ) {
    tv.clear();
 
    delete c2 ; 
-   delete h2 ; 
 }
+//------------------------------------------------------------------------
+TH2D *TScan::Map2D( TString name , const vector<Long64_t> &sel , const vector<Double_t> &val ) {
+
+   //val of the entries in sel on the plane of the two scanned coordinates, one bin per
+   //step, relative to (x0,y0,z0). Not drawn: it is called from PerVoltage
+   Int_t    ia = ( ScanDir[0] ) ? 0 : 1 ;
+   Int_t    ib = ( ScanDir[2] ) ? 2 : 1 ;
+   Double_t c0[3]     = { x0 , y0 , z0 } ;
+   Double_t c0file[3] = { x0file , y0file , z0file } ;
+   Double_t dc[3]     = { dx , dy , dz } ;
+   Int_t    Nc[3]     = { Nx , Ny , Nz } ;
+   const vector<Double_t> *cc[3] = { &cols->x , &cols->y , &cols->z } ;
+
+   Double_t lo[3] , hi[3] ;
+   for ( Int_t c=0 ; c<3 ; c++ ) {
+     Double_t first = c0file[c]-c0[c] , last = first + (TMath::Max(Nc[c],1)-1)*dc[c] ;
+     lo[c] = TMath::Min( first , last ) - 0.5*TMath::Abs(dc[c]) ;
+     hi[c] = TMath::Max( first , last ) + 0.5*TMath::Abs(dc[c]) ;
+   }
+
+   TH2D *h2 = new TH2D( name , name , TMath::Max(Nc[ia],1) , lo[ia] , hi[ia] , TMath::Max(Nc[ib],1) , lo[ib] , hi[ib] ) ;
+   h2->SetDirectory(0) ;
+   for ( UInt_t i=0 ; i<sel.size() ; i++ ) {
+     Long64_t iev = sel[i] ;
+     h2->Fill( (*cc[ia])[iev]-c0[ia] , (*cc[ib])[iev]-c0[ib] , val[iev] ) ;
+   }
+   h2->SetStats(0) ;
+   
+   return h2 ;
+
+}
+
+//------------------------------------------------------------------------
+TH2D *TScan::TimeCoord2D( TString name , Int_t coord , Double_t val0 , const vector<Long64_t> &sel ) {
+
+   //Signal of the entries in sel as a function of (time-t0, coordinate-val0): one bin
+   //per sample and one per scan step. Not drawn: it is called from PerVoltage
+   Double_t c0file[3] = { x0file , y0file , z0file } ;
+   Double_t dc[3]     = { dx , dy , dz } ;
+   Int_t    Nc[3]     = { Nx , Ny , Nz } ;
+   const vector<Double_t> *cc[3] = { &cols->x , &cols->y , &cols->z } ;
+   
+   Int_t nt = cols->GetNt() ;
+   const Double_t *time = cols->GetTime() ;
+   Double_t first = c0file[coord]-val0 , last = first + (TMath::Max(Nc[coord],1)-1)*dc[coord] ;
+   Double_t lo = TMath::Min( first , last ) - 0.5*TMath::Abs(dc[coord]) ;
+   Double_t hi = TMath::Max( first , last ) + 0.5*TMath::Abs(dc[coord]) ;
+   
+   TH2D *h2 = new TH2D( name , name , nt , time[0]-t0-0.5*dt , time[nt-1]-t0+0.5*dt , TMath::Max(Nc[coord],1) , lo , hi ) ;
+   h2->SetDirectory(0) ;
+   cols->Samples( sel , [&] ( Long64_t iev , const Double_t *v ) {
+     Double_t bl = cols->BlineMean[iev] , c = (*cc[coord])[iev]-val0 ;
+     #if DECONV==1
+       for ( Int_t j=0 ; j<nt-1 ; j++ ) h2->Fill( time[j]-t0 , c , ROSC*Cend*(v[j+1]-v[j])/dt + v[j]-bl ) ;
+     #elif I2CORR==1
+       Double_t lp2 = cols->LPower[iev]*cols->LPower[iev] ;
+       for ( Int_t j=0 ; j<nt ; j++ ) h2->Fill( time[j]-t0 , c , (v[j]-bl)/lp2 ) ;
+     #else
+       for ( Int_t j=0 ; j<nt ; j++ ) h2->Fill( time[j]-t0 , c , v[j]-bl ) ;
+     #endif
+   } ) ;
+   h2->SetStats(0) ;
+   
+   return h2 ;
+
+}
+
+//------------------------------------------------------------------------
+void TScan::PerVoltage( std::function<void( Int_t )> job ) {
+
+   //The histograms built by the jobs are not attached to any directory: gDirectory
+   //is not to be shared among threads. They are written where needed afterwards
+   Bool_t adddir = TH1::AddDirectoryStatus() ;
+   TH1::AddDirectory( kFALSE ) ;
+   cols->ForEach( NV , job ) ;
+   TH1::AddDirectory( adddir ) ;
+
+}
+
 //------------------------------------------------------------------------
 void TScan::vd_times_Ew() {   
      
@@ -1197,7 +1398,9 @@ void TScan::Q2D_IntegrationTime( ) {
    cout <<  "Plotting " << Plot.Data()<<" maps" <<endl ;
    TString myfnm = TString(dnm)+"histos/"+Plot+"_" + TString(bnm)+".hroot"  ;
    
-   TCanvas *c2 ;
+   #if BATCH==0
+     TCanvas *c2 ;
+   #endif
    TString pthnm = TString(dnm)+"plots/";
    TString pdfnm = pthnm+ Plot +"_" + TString(bnm)  ;
    #if DECONV==1
@@ -1220,28 +1423,16 @@ void TScan::Q2D_IntegrationTime( ) {
 
    TFile *f2Dout=new TFile(myfnm.Data(),"RECREATE");
    
-   if (PORTRAIT==1)  c2 = new TCanvas("c2","c2",400,600);
-   else              c2 = new TCanvas("c2","c2",600,400);
-   c2->cd();
-   c2->Print( pdf0.Data() );
+   #if BATCH==0
+     if (PORTRAIT==1)  c2 = new TCanvas("c2","c2",400,600);
+     else              c2 = new TCanvas("c2","c2",600,400);
+     c2->cd();
+     c2->Print( pdf0.Data() );
+   #endif
 
    for (Int_t it=1;it<=Atrl;it++) {
 
-     TString what , twhat ;
-     if ( Plot.EqualTo("Q2D")     ) what= Form( "Sum$((volt-BlineMean)*(time>%f &&time<%f))",t0,t0+it );
-
-     if ( ScanDir[0] && ScanDir[1] ) what  = Form("x-%f:y-%f:", x0, y0 ) + what ;
-     if ( ScanDir[0] && ScanDir[2] ) what  = Form("x-%f:z-%f:", x0, z0 ) + what ;
-     if ( ScanDir[1] && ScanDir[2] ) what  = Form("y-%f:z-%f:", y0, z0 ) + what ;
-     #if I2CORR==1
-       if ( Plot.EqualTo("Q2D") )      { 
-	 what  = Form( "Sum$((volt-BlineMean)*(time>%f &&time<%f))/(LPower*LPower)",t0,t0+it ) ;
-	 if ( ScanDir[0] && ScanDir[1] ) what  = Form("x-%f:y-%f:", x0, y0 ) + what ;
-	 if ( ScanDir[0] && ScanDir[2] ) what  = Form("x-%f:z-%f:", x0, z0 ) + what ;
-	 if ( ScanDir[1] && ScanDir[2] ) what  = Form("y-%f:z-%f:", y0, z0 ) + what ;
-       }
-     #endif
-
+     TString twhat ;
 
      //Titles of the histograms that are going to be created
      if ( Plot.EqualTo("Q2D") ) {
@@ -1255,27 +1446,27 @@ void TScan::Q2D_IntegrationTime( ) {
        #endif
      }
 
+     //Charge in [t0,t0+it] of every entry, then one map per voltage built in parallel
+     vector<Double_t> what = cols->Window( t0 , t0+it , I2CORR==1 ) ;
+     vector<TH2D*> vh2( NV , (TH2D*) 0 ) ;
+     PerVoltage( [&] ( Int_t iv ) { vh2[iv] = Map2D( twhat , cols->Select( (Int_t) Vb[iv] ) , what ) ; } ) ;
 
      TH2D *h2 ;
      for ( Int_t iv = 0 ; iv < NV ; iv++ ) {
 
-       TString selection  = Form("Vbias==%d",(Int_t) Vb[iv]) ;
-
-       plot2D( (char*) what.Data() , (char*) selection.Data() , fnm ) ;
+       TString selection ;
 
-       h2 = (TH2D *) gPad->GetPrimitive( twhat.Data() ) ; 
+       h2 = vh2[iv] ; 
 
 
        if ( ScanDir[0] && ScanDir[1] ) { h2->GetXaxis()->SetTitle("X [mm]") ; h2->GetYaxis()->SetTitle("Y [mm]") ; }
        if ( ScanDir[0] && ScanDir[2] ) { h2->GetXaxis()->SetTitle("X [mm]") ; h2->GetYaxis()->SetTitle("Z [mm]") ; }
        if ( ScanDir[1] && ScanDir[2] ) { h2->GetXaxis()->SetTitle("Y [mm]") ; h2->GetYaxis()->SetTitle("Z [mm]") ; }
-       TPaletteAxis *palette = (TPaletteAxis*)h2->GetListOfFunctions()->FindObject("palette");
-       palette->GetAxis()->SetTitleOffset(1.1); palette->GetAxis()->SetTitleSize(0.045);
 
        if ( Plot.EqualTo("Q2D" ) ) { 
-	 palette->GetAxis()->SetTitle( Form("Charge in %d ns [a.u.]",it) );
+	 h2->GetZaxis()->SetTitle( Form("Charge in %d ns [a.u.]",it) );
 	 #if I2CORR==1
-	   palette->GetAxis()->SetTitle( Form("Charge in %d ns [I^{2} corr., a.u.]",it) );
+	   h2->GetZaxis()->SetTitle( Form("Charge in %d ns [I^{2} corr., a.u.]",it) );
 	 #endif
 
 	 //Rename the histogram
@@ -1286,30 +1477,36 @@ void TScan::Q2D_IntegrationTime( ) {
 	 selection=Form("%d V",(Int_t) Vb[iv]) ;
 
 
-	 TLatex text = TLatex();
-	 text.SetNDC();
-	 text.DrawLatex(0.17, 0.8, selection.Data() );
+	 #if BATCH==0
+	   c2->cd();
+	   h2->Draw("colz");
+	   gPad->Update();
+	   TPaletteAxis *palette = (TPaletteAxis*)h2->GetListOfFunctions()->FindObject("palette");
+	   palette->GetAxis()->SetTitleOffset(1.1); palette->GetAxis()->SetTitleSize(0.045);
+	   palette->GetAxis()->SetTitle( h2->GetZaxis()->GetTitle() );
+
+	   TLatex text = TLatex();
+	   text.SetNDC();
+	   text.DrawLatex(0.17, 0.8, selection.Data() );
          
-	 c2->cd();
-	 h2->Draw("colz");
-         c2->Print( pdfnm.Data() );
+           c2->Print( pdfnm.Data() );
+	 #endif
         
 	 f2Dout->cd() ; h2->Write() ; 
 	 
-	 if (it==TMath::Nint(Atrl)) vhQ2D.push_back(h2) ;    
-	 
        }
 
-
+       if (it==TMath::Nint(Atrl)) vhQ2D[iv]=h2 ;   //The last ones are kept
+       else                       delete h2 ;
    
      }
-     delete h2;
 
    }
 
-   c2->Print( pdff.Data() );
-
-   delete c2 ; 
+   #if BATCH==0
+     c2->Print( pdff.Data() );
+     delete c2 ; 
+   #endif
 
 }
 //------------------------------------------------------------------------
@@ -1340,26 +1537,34 @@ void TScan::TimeVbiasVolt2D() {
    
    //TString selection=TString("Vbias>-300");
    TString selection=TString("");
+   what = edgelayout::TimeFormula( what , SharedT , dt , Tstart ) ;
    plot2D( (char*) what.Data() , (char*) selection.Data() , fnm ) ;
    what  = Form("volt-BlineMean=f(time-%f,Vbias)",t0) ;
    #if I2CORR==1
      what  = Form("(volt-BlineMean)/(LPower*LPower)=f(time-%f,Vbias)",t0) ;
    #endif
+   what = edgelayout::TimeFormula( what , SharedT , dt , Tstart ) ;
 
    h2 = (TH2D *) gPad->GetPrimitive( what.Data() ) ;
    if (Atrl+2<30.) h2->GetXaxis()->SetRangeUser(-2.0,Atrl+2.0) ;
    else            h2->GetXaxis()->SetRangeUser(-2.0,30.) ;
    h2->GetXaxis()->SetTitle("Time [ns]") ;
    h2->GetYaxis()->SetTitle("Bias voltage [V]") ;
-   TPaletteAxis *palette = (TPaletteAxis*)h2->GetListOfFunctions()->FindObject("palette");
-   palette->GetAxis()->SetTitleOffset(1.1); palette->GetAxis()->SetTitleSize(0.045);
-   palette->GetAxis()->SetTitle( "Signal [V]" );
+   h2->GetZaxis()->SetTitle( "Signal [V]" );
    #if I2CORR==1
-     palette->GetAxis()->SetTitle( "Signal [I^{2} corr., a.u.]" );
+     h2->GetZaxis()->SetTitle( "Signal [I^{2} corr., a.u.]" );
    #endif
+   hvtVb = h2 ;
 
    cout << endl; cout << endl;
 
+   #if BATCH==1
+     return ;
+   #endif
+   TPaletteAxis *palette = (TPaletteAxis*)h2->GetListOfFunctions()->FindObject("palette");
+   palette->GetAxis()->SetTitleOffset(1.1); palette->GetAxis()->SetTitleSize(0.045);
+   palette->GetAxis()->SetTitle( h2->GetZaxis()->GetTitle() );
+
    
    //Plot them (needed in case we wanted to have subpads
    if (PORTRAIT==1)  c2 = new TCanvas("c2","c2",400,600);
@@ -1381,7 +1586,6 @@ void TScan::TimeVbiasVolt2D() {
    }
       
    delete c2 ;  
-   delete h2 ;
    
 }
 //------------------------------------------------------------------------
@@ -1502,6 +1706,9 @@ void TScan::PlotVdt( Double_t toffset , vector<THStack *> vhvd , Int_t c ) {
       Each vhvd[i] is a stack of several histograms
    
    */
+   #if BATCH==1
+     return ;
+   #endif
    TString xyz ;
    if ( c==0 )  xyz=TString("x") ; 
    if ( c==1 )  xyz=TString("y") ; 
@@ -1580,7 +1787,9 @@ void TScan::GetCollectionTimeStack( TString xyz ) {  //UNSAFE !!!
    plot1D((char*)what.Data(),(char*)selection.Data(),1,fnm) ;
    TString pthnm = TString(dnm)+"plots/";
    TString pdfnm = pthnm+"tcoll_" + TString(bnm)+".pdf"  ;
-   gPad->Print( pdfnm.Data() ) ;
+   #if BATCH==0
+     gPad->Print( pdfnm.Data() ) ;
+   #endif
    
    TString hfnm=TString(dnm)+"histos/"+TString(bnm)+".tcoll";
    TString cmd="mv 1Dhistos.root "+ hfnm ;
@@ -1939,11 +2148,13 @@ void TScan::PlotCCExyz_vs_Vbias( Int_t c ) {
      
      
      //Plot CCE
-     TCanvas *c4  = new TCanvas() ;
-     gStyle->SetOptStat(0) ;
-     gStyle->SetMarkerStyle(20) ;
-     gStyle->SetMarkerSize(1) ;
-     c4->SetLeftMargin(0.16); c4->SetGridx(); c4->SetGridy(); 
+     #if BATCH==0
+       TCanvas *c4  = new TCanvas() ;
+       gStyle->SetOptStat(0) ;
+       gStyle->SetMarkerStyle(20) ;
+       gStyle->SetMarkerSize(1) ;
+       c4->SetLeftMargin(0.16); c4->SetGridx(); c4->SetGridy(); 
+     #endif
      TGraph *geff = new TGraph( NV , &sVb[0] , &CCE[0] ); geff->SetTitle("");
      geff->GetXaxis()->SetTitle("Bias voltage [V]");
      //geff->GetYaxis()->SetTitle(Form("CCE=#frac{1}{d}#int_{0}^{d}Q(z, 0-%d ns) #bf{dz} [a.u.]",TMath::Nint(Atrl))) ;
@@ -1957,7 +2168,6 @@ void TScan::PlotCCExyz_vs_Vbias( Int_t c ) {
      #endif
      
      geff->GetYaxis()->SetTitleSize(0.045) ;geff->GetYaxis()->SetTitleOffset(1.4) ;
-     geff->Draw( "awlp" ) ;
      #if SCALEVD>0
        TString cpdfnm = TString(dnm)+"plots/"+"CCE"+xyz+"_"+TString(bnm)+Form("_%dns",TMath::Nint(Atrl))+"_norm" +Form("%d",SCALEVD);
      #else
@@ -1967,7 +2177,10 @@ void TScan::PlotCCExyz_vs_Vbias( Int_t c ) {
        cpdfnm = cpdfnm + "_deconv" ;
      #endif
      cpdfnm=cpdfnm+".pdf" ;
-     c4->Print( cpdfnm.Data() );
+     #if BATCH==0
+       geff->Draw( "awlp" ) ;
+       c4->Print( cpdfnm.Data() );
+     #endif
      
      //Save graph to file
      #if SCALEVD>0
@@ -1991,7 +2204,9 @@ void TScan::PlotCCExyz_vs_Vbias( Int_t c ) {
      AnnInfo.Write("annealing");
      fout->Close();
      
-     delete c4;
+     #if BATCH==0
+       delete c4;
+     #endif
      
      //Calculate Vdep (not needed anymore)
 //      TH1D *hCCE = new TH1D( "hCCE" , "CCE vs voltage" , sVb.size() , &sVb[0] );
@@ -2011,40 +2226,36 @@ void TScan::PlotCCExyz_vs_Vbias( Int_t c ) {
 //------------------------------------------------------------------------
 void TScan::PlotCCEt_vs_Vbias( TTree *tree ) {
 
-   TString what  = Form("Sum$((volt-BlineMean)*(time>%f &&time<%f)):Vbias" ,t0,t0+Atrl ) ;
+   //Sum$((volt-BlineMean)*(time>t0 &&time<t0+Atrl)):Vbias, all entries
    #if I2CORR==1
-     what  = Form("Sum$((volt-BlineMean)*(time>%f &&time<%f))/(LPower*LPower):Vbias" ,t0,t0+Atrl ) ;
+     vector<Double_t> CCEv = cols->Window( t0 , t0+Atrl , kTRUE ) ;
+   #else
+     vector<Double_t> CCEv = cols->Window( t0 , t0+Atrl ) ;
    #endif   
    
-   //TString what  = Form("Sum$((volt-BlineMean)*(time>%f &&time<%f)):Vbias" ,t0,t0+50.0 ) ;
    TString pthnm = TString(dnm);
    TString pdfnm = pthnm + "plots/"+"CCE_"+TString(bnm) +".pdf" , pdf0=pdfnm+"[", pdff=pdfnm+"]";
-   //TString selection = (Polarity==1) ? Form( "Vbias<%f" ,Vbmax-20) : Form( "Vbias>%f" ,Vbmax+50.) ; 
-   TString selection = ""  ; 
    
-   TCanvas *c4 = new TCanvas("c4","CC",600,400);
-   Int_t Nval = tree->Draw(what.Data(),selection.Data(),"l") ;
-   TH2D *h2D = (TH2D*) gPad->GetPrimitive("htemp");  
-   h2D->GetXaxis()->SetTitle("Bias voltage [V]");
-
-   h2D->GetYaxis()->SetTitle(Form("Q=#int_{0}^{%d} I(t) #bf{dt} [a.u.]",TMath::Nint(Atrl))) ;
-   #if I2CORR==1 
-     h2D->GetYaxis()->SetTitle(Form("Q=#int_{0}^{%d} I(t) #bf{dt} [I^{2}corr, a.u.]",TMath::Nint(Atrl)))  ;
-   #endif
-    
-   c4->SetGridx(); c4->SetGridy(); 
-   c4->Print(pdfnm);
-   
-   Double_t *Vv    = tree->GetV2() ;
-   Double_t *CCEv  = tree->GetV1() ;
-
+   Int_t Nval = cols->GetN() ;
 
    //CCE[NV]. If we are in a XYZ scan, then the plot has Nx*Ny*Nz*NV points!
    if ( (ScanDir[0]+ScanDir[1]+ScanDir[2]) == 0 ) for (Int_t il=0;il<Nval ;il++) CCE[il]=CCEv[il];
 
-   TGraph *g=new TGraph( Nval , Vv , CCEv );
-   g->SetMarkerStyle(20); gStyle->SetOptTitle(0);
-   g->Draw();
+   TGraph *g=new TGraph( Nval , &cols->Vbias[0] , &CCEv[0] );
+   g->SetMarkerStyle(20); 
+   #if BATCH==0
+     TCanvas *c4 = new TCanvas("c4","CC",600,400);
+     gStyle->SetOptTitle(0);
+     g->Draw("ap");
+     g->GetXaxis()->SetTitle("Bias voltage [V]");
+     g->GetYaxis()->SetTitle(Form("Q=#int_{0}^{%d} I(t) #bf{dt} [a.u.]",TMath::Nint(Atrl))) ;
+     #if I2CORR==1 
+       g->GetYaxis()->SetTitle(Form("Q=#int_{0}^{%d} I(t) #bf{dt} [I^{2}corr, a.u.]",TMath::Nint(Atrl)))  ;
+     #endif
+    
+     c4->SetGridx(); c4->SetGridy(); 
+     c4->Print(pdfnm);
+   #endif
    g->GetXaxis()->SetTitle("Bias voltage [V]");
    g->GetYaxis()->SetTitle("CC [a.u.]");
 
@@ -2053,7 +2264,9 @@ void TScan::PlotCCEt_vs_Vbias( TTree *tree ) {
    g->Write() ;
    fout->Close();
 
-   delete c4 ;
+   #if BATCH==0
+     delete c4 ;
+   #endif
      
 }
 
@@ -2067,7 +2280,8 @@ void TScan::FitChargeProfile( Int_t coord ) {
      TFile *fout = new TFile( hfnm , "RECREATE");
      fout->cd();
      
-     //Do the fits
+     //Do the fits. One voltage after the other, unlike the histograms of the maps: the fits
+     //look their functions up by name in gROOT and minimize through the global gMinuit
      TH1D *h1 ;
      vector<Double_t> sVb ;
      Int_t NStacks ;
@@ -2076,8 +2290,10 @@ void TScan::FitChargeProfile( Int_t coord ) {
      if ( coord == 2 ) NStacks = vhsQz.size() ;
      vector <TH1D *> vh1;
      TString pdffit = TString(dnm)+"plots/"+"FitEff1by"+xyz+"_"+TString(bnm)+Form("_%dns",TMath::Nint(Atrl))+".pdf" ;
-     TCanvas *c41  = new TCanvas("c41","Effz fits",600,400) ;
-     c41->cd();
+     #if BATCH==0
+       TCanvas *c41  = new TCanvas("c41","Effz fits",600,400) ;
+       c41->cd();
+     #endif
      gStyle->SetOptFit();
      Int_t Convergence;
      for ( Int_t il = 0 ; il < NStacks ; il++ ) {
@@ -2111,16 +2327,20 @@ void TScan::FitChargeProfile( Int_t coord ) {
 	  Convergence = FitGaussianAssyBox( h1 , pars );  
 	 #endif
 	 
-	 TPaveText *doc = new TPaveText( 0.12,0.8,0.3,0.86,"NDC" );
-	 doc->SetTextSize(0.029);
-	 if ( Convergence==0 ) doc->AddText("Converged") ; else doc->AddText("Failed") ;
-	 h1->GetListOfFunctions()->Add(doc); 
-	 h1->Draw();
-	 gPad->UseCurrentStyle();
-	 gPad->Update();
+	 #if BATCH==0
+	   TPaveText *doc = new TPaveText( 0.12,0.8,0.3,0.86,"NDC" );
+	   doc->SetTextSize(0.029);
+	   if ( Convergence==0 ) doc->AddText("Converged") ; else doc->AddText("Failed") ;
+	   h1->GetListOfFunctions()->Add(doc); 
+	   h1->Draw();
+	   gPad->UseCurrentStyle();
+	   gPad->Update();
+	 #endif
 	 h1->Write() ;
-	 if (ih==0) c41->Print(pdffit+"[");
-	 gPad->Print(pdffit);
+	 #if BATCH==0
+	   if (ih==0) c41->Print(pdffit+"[");
+	   gPad->Print(pdffit);
+	 #endif
 	 vh1.push_back(h1) ; 
 	 
 	 //Check the following
@@ -2133,11 +2353,25 @@ void TScan::FitChargeProfile( Int_t coord ) {
 	 if (coord==0) vFitResx[ih] = Convergence ; if (coord==1) vFitResy[ih]  = Convergence ; if (coord==2) vFitResz[ih] = Convergence ;
        }
        delete [] pars;
-       c41->Print(pdffit+"]");
+       #if BATCH==0
+         c41->Print(pdffit+"]");
+       #endif
    }
      
      fout->Close();
-     delete c41;
+     #if BATCH==0
+       delete c41;
+     #else
+       //Only the printout of the fitted widths
+       for ( UInt_t ih = 0 ; ih < vh1.size(); ih++ ) {
+	 TString tit = vh1[ih]->GetTitle() ;
+	 tit = tit(0,tit.Index(" V"));
+	 if (coord==0) std::cout << "d(V=" <<tit.Atof()<<")="<<vFwQx[ih]<<std::endl;
+	 if (coord==1) std::cout << "d(V=" <<tit.Atof()<<")="<<vFwQy[ih]<<std::endl;
+	 if (coord==2) std::cout << "d(V=" <<tit.Atof()<<")="<<vFwQz[ih]<<std::endl;
+       }
+       return ;
+     #endif
      
      //Plot all fits
      TLegend *leg = new TLegend( 0.85 , 0.05 , 0.97 , 0.65 );
@@ -2267,10 +2501,103 @@ void TScan::DumpToTree (  ) {
 
   }
 
+  #if BATCH==1
+    SaveHistos( &froot ) ;
+    froot.cd() ;
+  #endif
   froot.Write();
   delete tap ;
   froot.Close();
   
+}
+
+//------------------------------------------------------------------------
+void TScan::SaveHistos ( TDirectory *dout ) {
+
+  //2D histograms, per bias voltage
+  vector<TH2D*> *v2[7]   = { &vhQ2D , &vhtcoll2D , &vhvd2D , &vhvdEw2D , &vhvtx , &vhvty , &vhvtz } ;
+  const char    *n2[7]   = { "Q2D" , "tcoll2D" , "vd2D" , "vdEw2D" , "Vtx" , "Vty" , "Vtz" } ;
+  for ( Int_t k = 0 ; k < 7 ; k++ ) {
+    TDirectory *d = 0 ;
+    for ( UInt_t iv = 0 ; iv < v2[k]->size() ; iv++ ) {
+      if ( (*v2[k])[iv] == 0 ) continue ;
+      if ( d == 0 ) d = dout->mkdir( n2[k] ) ;
+      d->WriteTObject( (*v2[k])[iv] , Form( "%s_%d" , n2[k] , iv ) ) ;
+    }
+  }
+  if ( hvtVb ) dout->mkdir( "VtVbias" )->WriteTObject( hvtVb , "VtVbias" ) ;
+
+  //Stacks of 1D histograms: Q, vdrift and collection time along each axis
+  vector<THStack*> *vs[9] = { &vhsQx , &vhsQy , &vhsQz , &vhvdx , &vhvdy , &vhvdz , &vhstcollx , &vhstcolly , &vhstcollz } ;
+  const char       *ns[9] = { "Qx" , "Qy" , "Qz" , "vdx" , "vdy" , "vdz" , "tcollx" , "tcolly" , "tcollz" } ;
+  //The stacks are written whole, so that Render draws their members together
+  for ( Int_t k = 0 ; k < 9 ; k++ ) {
+    TDirectory *d = 0 ;
+    for ( UInt_t is = 0 ; is < vs[k]->size() ; is++ ) {
+      if ( (*vs[k])[is] == 0 || (*vs[k])[is]->GetHists() == 0 ) continue ;
+      if ( d == 0 ) d = dout->mkdir( ns[k] ) ;
+      d->WriteTObject( (*vs[k])[is] , Form( "%s_%d" , ns[k] , is ) ) ;
+    }
+  }
+
+  //V(t) stacks: one directory per plot of VoltVsTime_ci (Vtxi, Vtyi, Vtzi) and VoltVsTime (Vt)
+  for ( UInt_t is = 0 ; is < vhsVt.size() ; is++ ) {
+    TString dnm = vhsVt[is].first ;
+    TDirectory *d = dout->GetDirectory( dnm ) ;
+    if ( d == 0 ) d = dout->mkdir( dnm ) ;
+    d->WriteTObject( vhsVt[is].second , Form( "%s_%d" , dnm.Data() , d->GetNkeys() ) ) ;
+  }
+
+}
+
+//------------------------------------------------------------------------
+void TScan::Render ( TString apfnm ) {
+
+  //One multipage pdf per directory of the AP file, in <dir>/plots/
+  TFile *f = new TFile( apfnm ) ;
+  if ( !f->IsOpen() ) {
+    cout << "TScan::Render: cannot open " << apfnm << endl ;
+    delete f ;
+    return ;
+  }
+  TString dir = gSystem->DirName( apfnm ) ;
+  TString bn  = gSystem->BaseName( apfnm ) ;
+  bn.ReplaceAll( ".root" , "" ) ;
+  
+  TCanvas *c1 = new TCanvas( "crender" , "crender" , 600 , 400 ) ;
+  TIter nextd( f->GetListOfKeys() ) ;
+  TKey *kd ;
+  while ( ( kd = (TKey *) nextd() ) ) {
+  
+    if ( !kd->IsFolder() || strcmp( kd->GetClassName() , "TDirectoryFile" ) ) continue ;
+    TDirectory *d = (TDirectory *) kd->ReadObj() ;
+    TString pdfnm = dir + "/plots/" + bn + "_" + d->GetName() + ".pdf" ;
+    
+    Int_t np = 0 ;
+    TIter nexth( d->GetListOfKeys() ) ;
+    TKey *kh ;
+    while ( ( kh = (TKey *) nexth() ) ) {
+      TObject *o = kh->ReadObj() ;
+      c1->Clear() ;
+      if      ( o->InheritsFrom( "THStack" ) ) {
+        o->Draw( "nostack" ) ;
+        c1->BuildLegend( 0.75 , 0.35 , 0.9 , 0.65 )->SetFillColor( kWhite ) ;
+      }
+      else if ( o->InheritsFrom( "TH2" ) )    o->Draw( "colz" ) ;
+      else if ( o->InheritsFrom( "TH1" ) )    o->Draw( ) ;
+      else if ( o->InheritsFrom( "TGraph" ) ) o->Draw( "awlp" ) ;
+      else continue ;
+      c1->Print( ( np == 0 ) ? pdfnm + "(" : pdfnm ) ;
+      np++ ;
+    }
+    if ( np > 0 ) c1->Print( pdfnm + "]" ) ;
+    
+  }
+  
+  delete c1 ;
+  f->Close() ;
+  delete f ;
+  
 }
 //------------------------------------------------------------------------
 void TScan::StackToArray ( THStack *hs , Int_t iVb , Double_t *arr ) {
@@ -2308,13 +2635,18 @@ void TScan::StackRunningQcToArray ( THStack *hs , Int_t iVb , Int_t coord) {
 //------------------------------------------------------------------------
 void TScan::Print_t0 ( TTree *tree , Double_t t0, Double_t Vbmax , Double_t Cend, Double_t dt, TString dnm , TString bnm ) {
      
+     #if BATCH==1
+       return ;
+     #endif
      TCanvas *ccont = new TCanvas("ccont","ccont",600,400);
      TString selection = Form( "Vbias==%f && (time>%f && time<%f) && (event%%10==1)", Vbmax, t0-2.0, t0+10.0 ) ;
+     selection = edgelayout::TimeFormula( selection , SharedT , dt , Tstart ) ;
 
      #if DECONV == 0
-       tree->Draw("volt-BlineMean:time",selection,"l") ;
+       tree->Draw( edgelayout::TimeFormula( "volt-BlineMean:time" , SharedT , dt , Tstart ) ,selection,"l") ;
      #else
        TString what = Form("%5.2f*%7.5f*(volt[Iteration$+1]-volt[Iteration$])/%5.3f+volt-BlineMean:time" , ROSC , Cend , dt);    
+       what = edgelayout::TimeFormula( what , SharedT , dt , Tstart ) ;
        tree->Draw(what.Data(),selection.Data(),"l") ; 
      #endif
      TH1D *htemp = (TH1D*) gPad->GetPrimitive("htemp");  
@@ -2477,12 +2809,11 @@ void TScan::VsBias( TTree *tree , TMeas *em  ) {
       hTp = new TProfile("hTp","Temp vs Vbias",1,Vb[0]-0.1*TMath::Abs(Vb[0]),Vb[0]+0.1*TMath::Abs(Vb[0]),"s") ;
     }
     
-    Long_t nentries = tree->GetEntries() ; 
+    Long_t nentries = cols->GetN() ; 
     for ( Int_t ii=0 ; ii < nentries ; ii++ ) {
 
-      tree->GetEntry(ii);
-      hIp->Fill( em->Vbias, em->Itot );
-      hTp->Fill( em->Vbias, em->Temp );
+      hIp->Fill( cols->Vbias[ii], cols->Itot[ii] );
+      hTp->Fill( cols->Vbias[ii], cols->Temp[ii] );
 
     }
 
@@ -2498,10 +2829,14 @@ void TScan::VsBias( TTree *tree , TMeas *em  ) {
 //------------------------------------------------------------------------
 Int_t TScan::FitGaussian( TH1D* h1 , Double_t *pars ) {
 
-        TCanvas *c1=new TCanvas("c1","Gaussian fits",600,400);
+        #if BATCH==0
+          TCanvas *c1=new TCanvas("c1","Gaussian fits",600,400);
+        #endif
         Int_t Convergence = h1->Fit("gaus");
-        c1->Update();
-        c1->Print("Erf.pdf");
+        #if BATCH==0
+          c1->Update();
+          c1->Print("Erf.pdf");
+        #endif
         TFormula *fit = (TFormula *) h1->GetFunction("gaus");
 
         Double_t Mean=fit->GetParameter(1);
@@ -2520,7 +2855,9 @@ Int_t TScan::FitGaussian( TH1D* h1 , Double_t *pars ) {
    
         std::cout << "Thickness="<<Thickness<<std::endl;
 	
-        delete c1;
+        #if BATCH==0
+          delete c1;
+        #endif
 	
 	return Convergence ;
 	
@@ -2536,13 +2873,17 @@ Int_t TScan::FitGaussianPol1( TH1D* h1 , Double_t *pars ) {
 	Double_t mu=fit->GetParameter(1);
 	Double_t sigma=fit->GetParameter(2);
 
-        TCanvas *c1=new TCanvas("c1","Gaussian+pol1",600,400);
+        #if BATCH==0
+          TCanvas *c1=new TCanvas("c1","Gaussian+pol1",600,400);
+        #endif
 	TF1 *gausp1 = new TF1( "gausp1" , "gaus(0)+pol1(3)" , h1->GetXaxis()->GetXmin() , h1->GetXaxis()->GetXmax() );
         gausp1->SetParameters(norm,mu,sigma,0.,0.6);
         Int_t Convergence = h1->Fit( "gausp1","","",mu-3.*sigma,mu+5.*sigma );
 	gStyle->SetOptFit();
-        c1->Update();
-        c1->Print("Erf.pdf");
+        #if BATCH==0
+          c1->Update();
+          c1->Print("Erf.pdf");
+        #endif
         Double_t Mean=gausp1->GetParameter(1);
         Double_t Sigma=gausp1->GetParameter(2);
         Double_t Thickness = 4.*Sigma ;
@@ -2558,7 +2899,9 @@ Int_t TScan::FitGaussianPol1( TH1D* h1 , Double_t *pars ) {
    
         std::cout << "Thickness="<<Thickness<<std::endl;
 	
-        delete c1;
+        #if BATCH==0
+          delete c1;
+        #endif
 	
 	return Convergence ;
 	
@@ -2574,15 +2917,19 @@ Int_t TScan::FitGaussianBox( TH1D* h1 , Double_t *pars ) {
 	Double_t mu=fit->GetParameter(1);
 	Double_t sigma=fit->GetParameter(2);
 
-        TCanvas *c1=new TCanvas("c1","Gaussian conv. Box",600,400);
+        #if BATCH==0
+          TCanvas *c1=new TCanvas("c1","Gaussian conv. Box",600,400);
+        #endif
 	TF1 *gausbox = new TF1( "gausbox" , GaussBox , h1->GetXaxis()->GetXmin() , h1->GetXaxis()->GetXmax(),4 );
         gausbox->SetParameters(mu,norm,2.*sigma,0.01);
         gausbox->SetParNames("Box center","Norm","Box Length","sigma");
 	gausbox->FixParameter(3,0.01); //Fix beam width
         Int_t Convergence = h1->Fit( "gausbox","WW","",0.,0.09 );
 	gStyle->SetOptFit();
-        c1->Update();
-        c1->Print("Erf.pdf");
+        #if BATCH==0
+          c1->Update();
+          c1->Print("Erf.pdf");
+        #endif
         Double_t Mean      = gausbox->GetParameter(0);
         Double_t BoxLength = gausbox->GetParameter(2);
 	Double_t Gwidth    = TMath::Abs(gausbox->GetParameter(3));
@@ -2598,7 +2945,9 @@ Int_t TScan::FitGaussianBox( TH1D* h1 , Double_t *pars ) {
    
         std::cout << "Thickness="<<BoxLength<<std::endl;
 	
-        delete c1;
+        #if BATCH==0
+          delete c1;
+        #endif
 	
 	return Convergence ;
 	
@@ -2614,7 +2963,9 @@ Int_t TScan::FitGaussianAssyBox( TH1D* h1 , Double_t *pars ) {
         //Guessing starting parameters: gaussian
 	Double_t mean = h1->GetMean() , rms = h1->GetRMS();
 	h1->Fit("gaus","WWR","",mean-rms,mean+rms);
-	gPad->Print("gauss.pdf");
+	#if BATCH==0
+	  gPad->Print("gauss.pdf");
+	#endif
 	TFormula *fit = (TFormula *) h1->GetFunction("gaus");
 	Double_t mu=fit->GetParameter(1);
 	Double_t sigma=fit->GetParameter(2);
@@ -2624,7 +2975,9 @@ Int_t TScan::FitGaussianAssyBox( TH1D* h1 , Double_t *pars ) {
           //Guessing starting parmeters: exponential
 	  h1->Draw();h1->Fit("expo","WW","R,sames",mu+0.66*sigma,h1->GetXaxis()->GetXmax());
 	  cout<<"[]="<<mu+0.2*sigma<<" "<<h1->GetXaxis()->GetXmax()<<endl;
-	  gPad->Print("expo.pdf");
+	  #if BATCH==0
+	    gPad->Print("expo.pdf");
+	  #endif
 	  fit = (TFormula *) h1->GetFunction("expo");
 	  bexpo = fit->GetParameter(1);
 	  eLdiff = 1./TMath::Abs(bexpo) ;
@@ -2632,7 +2985,9 @@ Int_t TScan::FitGaussianAssyBox( TH1D* h1 , Double_t *pars ) {
           //Guessing starting parmeters: exponential
 	  h1->Draw();h1->Fit("pol1","WW","R,sames",mu+0.66*sigma,h1->GetXaxis()->GetXmax());
 	  cout<<"[]="<<mu+0.2*sigma<<" "<<h1->GetXaxis()->GetXmax()<<endl;
-	  gPad->Print("expo.pdf");
+	  #if BATCH==0
+	    gPad->Print("expo.pdf");
+	  #endif
 	  fit = (TFormula *) h1->GetFunction("pol1");
 	  bexpo = fit->GetParameter(1);	
 	  eLdiff =  -fit->GetParameter(0)/fit->GetParameter(1) - mu;
@@ -2654,7 +3009,9 @@ Int_t TScan::FitGaussianAssyBox( TH1D* h1 , Double_t *pars ) {
 			   
         //TMinuit *gMinuit = new TMinuit(5);  //initialize TMinuit with a maximum of 5 params
 
-        TCanvas *c1=new TCanvas("c1","Gaussian conv. Assymetric Box",600,400);
+        #if BATCH==0
+          TCanvas *c1=new TCanvas("c1","Gaussian conv. Assymetric Box",600,400);
+        #endif
 	Double_t norm=h1->Integral(h1->FindBin(-0.02),h1->FindBin( 0.09),"width");
 	TF1 *gausabox ;
 	#if FITQPROF==3
@@ -2724,8 +3081,10 @@ Int_t TScan::FitGaussianAssyBox( TH1D* h1 , Double_t *pars ) {
 	
 	cout<<"End of "<<h1->GetName()<<endl;
 	gStyle->SetOptFit();
-        c1->Update();
-        c1->Print("Erf.pdf");
+        #if BATCH==0
+          c1->Update();
+          c1->Print("Erf.pdf");
+        #endif
         Double_t Mean       = gausabox->GetParameter(0);
         Double_t BoxLength  = TMath::Abs(gausabox->GetParameter(2));
 	Double_t Gwidth     = TMath::Abs(gausabox->GetParameter(3));
@@ -2749,7 +3108,9 @@ Int_t TScan::FitGaussianAssyBox( TH1D* h1 , Double_t *pars ) {
    
         //std::cout << "Thickness="<<Thickness<<std::endl;
 	
-        delete c1;
+        #if BATCH==0
+          delete c1;
+        #endif
 	
 	return Convergence ;
 	
@@ -57,6 +57,10 @@
 
 #define HIGHQPDF 1        //1 Creates a big pdf out of the 2D distros, otherwise say 0
 
+#define BATCH 0           //0 plots are drawn and printed as they are calculated
+                          //1 headless: no canvases, legends or text boxes, nothing printed. The histograms
+                          //  go with the AutoPilot tree to AP_<name>.root, plot them with TScan::Render
+
 
 #define ATRL 15          //0 in case we want the program to calculate the time window for plotting
 			  //non-zero in case we want a fixed time zoom in plots
@@ -93,7 +97,9 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <utility>
 #include <algorithm>
+#include <functional>
 #include <libgen.h>
 
 #include "TFile.h"
@@ -121,10 +127,14 @@
 #include "TROOT.h"
 #include "TPaletteAxis.h"
 #include "TPaveText.h"
+#include "TKey.h"
 
 #include "TMeas.h"
 #include "TMeasHeader.h"
 #include "TWaveform.h"
+#include "WaveformBatch.h"
+#include "ScanColumns.h"
+#include "EdgeLayout.h"
 #include "TScan.h"
 #include "TMinuit.h"
 
@@ -196,6 +206,8 @@ class TScan : public TObject {   //TScan derives from TObject, so we can use som
 			      //!TCT+: Always Z involved except for Normal TCT: Vscan or XY(V) scan
 
      Double_t dt        ;     //Step in times (scope)
+     Int_t    SharedT   ;     //!Time axis in the header, not in the entries (EdgeLayout.h)
+     Double_t Tstart    ;     //!Origin of that axis
      Double_t N0avg     ;     //!Average number of e-h pairs produced
 
      Double_t iann      ;     //annealing step [allowing steps like "3.5"]
@@ -321,6 +333,8 @@ class TScan : public TObject {   //TScan derives from TObject, so we can use som
      vector<THStack*> vhsV_zi  ;    //!NV   thstacks of V(t) at fixed z	, different Vbias
      vector<THStack*> vhsV_Vbi  ;   //!NV   thstacks of V(t) at fixed Vbias, different z
      
+     vector<pair<TString,THStack*> > vhsVt ; //!V(t) stacks of VoltVsTime(_ci) kept in BATCH mode, with their directory in SaveHistos
+     
      vector<TLegend*> vlhsV_zi ;    //!NV   Legends
      vector<TLegend*> vlhsV_Vbi ;   //!NV   Legends
      
@@ -332,6 +346,7 @@ class TScan : public TObject {   //TScan derives from TObject, so we can use som
      vector<TH2D*>    vhtcoll2D  ; //!NV   2D collection time map   
      vector<TH2D*>    vhvd2D     ; //!NV   2D vd(x,y)
      vector<TH2D*>    vhvdEw2D   ; //!NV   2D vd(x,y)*WeightingField
+     TH2D            *hvtVb      ; //!     Signal vs (time,Vbias), TimeVbiasVolt2D
      vector<Double_t> CCE        ; //!NV
      
      
@@ -349,12 +364,15 @@ class TScan : public TObject {   //TScan derives from TObject, so we can use som
           
      vector<THStack*> hstcoll ; //!Collection time for each Z, at each voltage
      
+     ScanColumns      *cols ;   //!The edge tree, read once (see ScanColumns.h)
+     
 
 
      //----> Methods 
      
      void     RoughTRTL( TString vselection , TTree *tree , TWaveform *wv , Double_t *trtl ) ;   //!
      void     RoughTRTL( TString vselection , TTree *tree , Double_t *trtl , Double_t Cend ) ;   //!
+     void     RoughTRTL( Double_t vbias , Double_t *trtl ) ;   //! Same as the first, from cols
      void      VoltVsTime_ci ( Int_t coord ) ;   //!
      void      VoltVsTime ( )   ;   //!
      void	 TimeCoordVolt2D ( Int_t coord ) ;  //!
@@ -370,6 +388,8 @@ class TScan : public TObject {   //TScan derives from TObject, so we can use som
      void      GetCollectionTimeStack( TString xyz ) ;		                         //!	  
      void      ScaleTHStack( THStack *hs , TString rfnm , Double_t toffset , Int_t c ) ; //! 
      void      DumpToTree( );                                              //!
+     void      SaveHistos( TDirectory *dout ) ;                            //! Histograms and stacks, one directory per kind
+     static void Render( TString apfnm ) ;                                 //! Plots of a file written by DumpToTree with BATCH 1
      void      StackToArray( THStack *hs , Int_t iVb , Double_t *arr );    //!
      void      StackAbscissaToArray( THStack *hs , Int_t iVb , Double_t *arr );   //!
      void      StackRunningQcToArray( THStack *hs , Int_t iVb , Int_t coord );   //!
@@ -394,6 +414,10 @@ private:
      void      TCollBinByBin( Int_t iVbias , TH1D *hiv, TH1D *hv  ) ;	   //!
      
      Double_t  FindErfStart( TTree *tree, TString what , TString selection ) ;
+     void      TLTRAverages( vector<Double_t> &tl , vector<Double_t> &tr , Double_t Vmax , Double_t Vmin , Double_t *trtl ) ; //!
+     TH2D     *Map2D( TString name , const vector<Long64_t> &sel , const vector<Double_t> &val ) ; //!
+     TH2D     *TimeCoord2D( TString name , Int_t coord , Double_t val0 , const vector<Long64_t> &sel ) ; //!
+     void      PerVoltage( std::function<void( Int_t )> job ) ; //! job(iv) for every bias voltage, in parallel
 
 protected:
 
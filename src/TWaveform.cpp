@@ -27,8 +27,6 @@
 #include "TWaveform.h"
 #include <TMath.h>
 #include <TVectorD.h>
-#include <TGraph.h>
-#include <TF1.h>
 
 #define VMAX -999999.9
 #define CHARSZ 256
@@ -40,6 +38,32 @@ ClassImp(TWaveform)
 const int LOW  = -1;
 const int HIGH = 15;
 
+/* Least squares straight line y+yshift = offset + slope*x through the n points with
+   xlo <= x <= xhi: what TGraph::Fit("pol1","RQ0") gives, but with no allocation and no
+   ROOT global state, so it can run in several threads at once. The sums are taken about
+   the means, which keeps them well conditioned when x is far from 0 */
+static void FitLine( int n , const double *x , const double *y , double xlo , double xhi , double yshift ,
+                     double &offset , double &slope ) {
+  double sx = 0. , sy = 0. ;
+  int    np = 0 ;
+  for ( int i=0 ; i < n ; i++ ) {
+    if ( x[i] < xlo || x[i] > xhi ) continue ;
+    sx += x[i] ; sy += y[i]+yshift ; np++ ;
+  }
+  offset = slope = 0. ;
+  if ( np < 2 ) return ;
+  double xm = sx/np , ym = sy/np , sxx = 0. , sxy = 0. ;
+  for ( int i=0 ; i < n ; i++ ) {
+    if ( x[i] < xlo || x[i] > xhi ) continue ;
+    double dx = x[i]-xm ;
+    sxx += dx*dx ;
+    sxy += dx*(y[i]+yshift-ym) ;
+  }
+  if ( sxx == 0. ) return ;
+  slope  = sxy/sxx ;
+  offset = ym - slope*xm ;
+}
+
 /* Default constructor, see ROOT manual page 270 */
 
 TWaveform::TWaveform(  ) {
@@ -70,6 +94,9 @@ TWaveform::TWaveform(  ) {
   Vmin = 0.;
   Vmax = 0.;
   Polarity = 0.;
+  owner = true ;
+  known = kAll ;     //Read from the tree, if anything
+  t4bl  = T4BL ;
 
 
 }
@@ -87,39 +114,51 @@ TWaveform::TWaveform( TMeas *em ) {
 
    Vbias=em->Vbias ;
 
-   CalcVmaxmin( ) ;
+   owner = true ;
+   known = 0 ;
+   hvt = hbl = hpbl = hvtbl = 0 ;
+   tright = 0. ; itright = 0 ;     //Kept if the signal has no right edge
+   LPower = LNph = 0. ;
+   t4bl = GetT4BL( em->Setup ) ;
 
-   CalcPolarity () ;
+   Need( kAll ) ;
 
-   /* 
-   Note that we need a rough estimation of itleft to calculate BlineMean. 
-   After knowing BlineMean we can properly calculate the left and right extremes of the
-   signal, and actually the BlineMean
-   
-   Taking  itleft=iVmax/2 does not work for very wide pulses (like in N bulk, low Vbias)
-   Take 5 ns worth of data
-   
-   */
+   CreateHistos() ;
+
+   CalcRunningCharge( em ) ;
    
-   T4BL = (em->Setup==5)? 0.5 : 10. ;
-   if ( Polarity == 1 )   //NEW: Sept 2012
-          itleft=( 0<iVmax && iVmax<=Nbins )? TMath::Nint( T4BL/(time[1]-time[0]) ) : Nbins ;
-   else 
-          itleft=( 0<iVmin && iVmin<=Nbins )? TMath::Nint( T4BL/(time[1]-time[0]) ) : Nbins ;
-    
-   CalcBline( ) ;
+}
 
-   CalcSignalTimeLR( ) ;
+TWaveform::TWaveform( TMeas *em , Bool_t lazy ) {
 
-   CreateHistos() ;
+   Nbins=em->Nt ;
+   Vbias=em->Vbias ;
 
-   CalcRiseTime( RTIME ) ;
-   
-   Q50 = GetCharge( tleft   , tleft+25.  ) ;
-   Qtot= GetCharge( time[0] , time[Nbins-1] ) ;
+   owner = !lazy ;
+   if ( lazy ) {
+     time = em->time ;
+     volt = em->volt ;
+   } else {
+     time = new Double_t [em->Nt] ;
+     volt = new Double_t [em->Nt] ;
+     for ( int i=0 ; i < em->Nt ; i++ ) {
+       time[i]= em->time[i];
+       volt[i]= em->volt[i];
+     }
+   }
+
+   known = 0 ;
+   hvt = hbl = hpbl = hvtbl = 0 ;
+   tright = 0. ; itright = 0 ;     //Kept if the signal has no right edge
+   LPower = LNph = 0. ;
+   t4bl = GetT4BL( em->Setup ) ;
+
+   if ( !lazy ) {
+     Need( kAll ) ;
+     CreateHistos() ;
+     CalcRunningCharge( em ) ;
+   }
 
-   CalcRunningCharge( em ) ;
-   
 }
 
 TWaveform::TWaveform( int nel , double *tin , double *vin , double Bias  ) {
@@ -135,31 +174,16 @@ TWaveform::TWaveform( int nel , double *tin , double *vin , double Bias  ) {
 
    Vbias=Bias ;
 
-   CalcVmaxmin( ) ;
-
-   CalcPolarity () ;
-
-   /* Note that we need a rough estimation of itleft to calculate BlineMean. 
-   After knowing BlineMean we can properly calculate the left and right extremes of the
-   signal, and actually the BlineMean 
-   */
-
-   //itleft=( 0<iVmax && iVmax<=Nbins )? (int) iVmax/2 : Nbins ;
-   if ( Polarity == 1 )   //NEW: Sept 2012
-          itleft=( 0<iVmax && iVmax<=Nbins )? TMath::Nint(  T4BL/(time[1]-time[0]) ) : Nbins ;
-   else 
-          itleft=( 0<iVmin && iVmin<=Nbins )? TMath::Nint(  T4BL/(time[1]-time[0]) ) : Nbins ;
+   owner = true ;
+   known = 0 ;
+   hvt = hbl = hpbl = hvtbl = 0 ;
+   tright = 0. ; itright = 0 ;     //Kept if the signal has no right edge
+   LPower = LNph = 0. ;
+   t4bl = T4BL ;
 
-   CalcBline( ) ;
-
-   CalcSignalTimeLR( ) ;
+   Need( kAll ) ;
 
    CreateHistos() ;
-
-   CalcRiseTime( RTIME ) ;
-
-   Q50 = GetCharge( tleft   , tleft+25.  ) ;
-   Qtot= GetCharge( time[0] , time[Nbins-1] ) ;
       
 }
 
@@ -167,8 +191,10 @@ TWaveform::TWaveform( int nel , double *tin , double *vin , double Bias  ) {
 TWaveform::~TWaveform(){
   //if (volt != (Double_t *) 0) delete [] volt ; //19Sept2012
   //if (time != (Double_t *) 0) delete [] time ;
-  delete [] volt ;
-  delete [] time ;
+  if ( owner ) {
+    delete [] volt ;
+    delete [] time ;
+  }
   delete hvt   ;  
   delete hbl   ; 
   delete hpbl  ; 
@@ -182,64 +208,122 @@ int    TWaveform::GetNbins(){
 }
 
 Double_t TWaveform::GetVmax(){
+  Need( kExtrema ) ;
   return Vmax ;
 }
 
 Double_t TWaveform::GetVmin(){
+  Need( kExtrema ) ;
   return Vmin ;
 }
 
 Double_t TWaveform::GettVmax(){
+  Need( kExtrema ) ;
   return tVmax ;
 }
 
 Double_t TWaveform::GettVmin(){
+  Need( kExtrema ) ;
   return tVmin ;
 }
 
 Double_t   TWaveform::GetAbsVmax(){
+  Need( kExtrema ) ;
   Double_t val = (fabs(Vmax)>fabs(Vmin)) ? Vmax : Vmin  ;
   return val ;
 }
 
 int    TWaveform::GetPolarity(){
+  Need( kExtrema ) ;
   return Polarity ;
 }
 
 double TWaveform::GetTleft() { 
+  Need( kSignal ) ;
   return tleft ; 
 }
 
 double TWaveform::GetTright(){ 
+  Need( kSignal ) ;
   return tright; 
 }
 
 double TWaveform::GetTrms()  { 
+  Need( kSignal ) ;
   return trms  ; 
 }
 
 double TWaveform::BlineGetMean() {
+  Need( kSignal ) ;
   return BlineMean ;
 }
 
 double TWaveform::BlineGetRMS() {
+  Need( kSignal ) ;
   return BlineRMS ;
 }
 
 double TWaveform::GetRiseTime( double fraction )  { 
+  Need( kSignal ) ;
   double rt=CalcRiseTime( fraction );
   return rt  ; 
 }
 
+Double_t TWaveform::GetQ50() {
+  Need( kCharge ) ;
+  return Q50 ;
+}
+
+Double_t TWaveform::GetQtot() {
+  Need( kCharge ) ;
+  return Qtot ;
+}
+
 Double_t TWaveform::GetCharge(double tinf , double tsup ) {
-  if (hvtbl==0) { 
-    cout << "No histogram"<<endl;
-    exit(0) ;
+
+  /* Integral(imin,imax,"width") of hvtbl, summed straight from volt so that the
+     histograms are not needed: every sample goes to the bin of its time
+  */
+  Need( kSignal ) ;
+  double At   = ( TMath::MaxElement( Nbins , time ) - TMath::MinElement( Nbins , time ) )/(Nbins-1.0) ;
+  double tmin = -0.5*At ;
+  int imin=TimeBin( tinf , tmin , At );
+  int imax=TimeBin( tsup , tmin , At );
+  if ( imax < imin ) imax = Nbins+1 ;
+  double width = ( (tmin + Nbins*At) - tmin )/Nbins ;
+  double sum = 0. , content = 0. ;
+  int ibin = 0 ;
+  for ( int i=0 ; i < Nbins ; i++ ) {   //Times are increasing: the bins come in order
+    int ib = TimeBin( time[i] , tmin , At ) ;
+    if ( ib != ibin ) { sum += content*width ; content = 0. ; ibin = ib ; }
+    if ( imin<=ib && ib<=imax ) content += volt[i]-BlineMean ;
   }
-  int imin=hvtbl->FindBin(tinf);
-  int imax=hvtbl->FindBin(tsup);
-  //cout << "imin="<<imin<<" imax" << imax << endl ;
-  return hvtbl->Integral(imin,imax,"width") ;
+  return sum + content*width ;
+}
+
+void TWaveform::Evaluate( TMeas *em ) {
+  Need( kAll ) ;
+  if ( em ) CalcRunningCharge( em ) ;
+}
+
+void TWaveform::SetExtrema( int imax , int imin , double mybl ) {
+  iVmax=imax ;
+  iVmin=imin ;
+  Vmax=volt[iVmax];
+  Vmin=volt[iVmin];
+  tVmax=time[iVmax];
+  tVmin=time[iVmin];
+  Polarity = ( fabs(Vmax-mybl) > fabs(Vmin-mybl) ) ? 1 : -1 ;
+  known |= kExtrema ;
+}
+
+void TWaveform::SetRiseTime( double rtime ) {
+  RiseTime = rtime ;
+  known |= kRise ;
+}
+
+Double_t TWaveform::GetT4BL( Int_t Setup ) {
+  return (Setup==5)? 0.5 : 10. ;
 }
 
 Double_t TWaveform::RGetCharge(double tinf , double tsup ) {
@@ -259,6 +343,63 @@ Double_t TWaveform::RGetCharge(double tinf , double tsup ) {
 
 /*------------------- PRIVATE METHODS -----------------------------*/
 
+void   TWaveform::Need( int what ) {
+
+  /* Calculates the features in what not known yet, and those they depend on */
+  
+  if ( (what & kCharge) || (what & kRise) ) what |= kSignal ;
+  if ( what & kSignal ) what |= kExtrema ;
+  what &= ~known ;
+  if ( what == 0 ) return ;
+
+  if ( what & kExtrema ) {
+    CalcVmaxmin( ) ;
+    CalcPolarity () ;
+    known |= kExtrema ;
+  }
+
+  if ( what & kSignal ) {
+    /* 
+    Note that we need a rough estimation of itleft to calculate BlineMean. 
+    After knowing BlineMean we can properly calculate the left and right extremes of the
+    signal, and actually the BlineMean
+   
+    Taking  itleft=iVmax/2 does not work for very wide pulses (like in N bulk, low Vbias)
+    Take 5 ns worth of data
+   
+    */
+    if ( Polarity == 1 )   //NEW: Sept 2012
+           itleft=( 0<iVmax && iVmax<=Nbins )? TMath::Nint( t4bl/(time[1]-time[0]) ) : Nbins ;
+    else 
+           itleft=( 0<iVmin && iVmin<=Nbins )? TMath::Nint( t4bl/(time[1]-time[0]) ) : Nbins ;
+    CalcBline( ) ;
+    CalcSignalTimeLR( ) ;
+    known |= kSignal ;
+  }
+
+  if ( what & kRise ) {
+    CalcRiseTime( RTIME ) ;
+    known |= kRise ;
+  }
+
+  if ( what & kCharge ) {
+    known |= kCharge ;
+    Q50 = GetCharge( tleft   , tleft+25.  ) ;
+    Qtot= GetCharge( time[0] , time[Nbins-1] ) ;
+  }
+
+}
+
+int    TWaveform::TimeBin( double t , double tmin , double At ) {
+
+  /* Bin of t in hvtbl (Nbins bins of width At from tmin), as given by FindBin */
+  
+  double tmax = tmin + Nbins*At ;
+  if ( t < tmin ) return 0 ;
+  if ( !( t < tmax ) ) return Nbins+1 ;
+  return 1 + int( Nbins*(t-tmin)/(tmax-tmin) ) ;
+}
+
 void   TWaveform::CalcVmaxmin() {
   iVmax=TMath::LocMax(Nbins,volt) ;
   iVmin=TMath::LocMin(Nbins,volt) ;
@@ -304,15 +445,14 @@ void   TWaveform::CalcPolarity(){
   /*Gives +1 if signal is positive, -1 otherwise */
     
   //Estimate baseline
-  Int_t nbl=TMath::Nint(  T4BL/(time[1]-time[0]) ) ;
-  TVectorD myblv(nbl,volt) ;
-  Double_t mybl = myblv.Sum()/nbl ;
+  Int_t nbl=TMath::Nint(  t4bl/(time[1]-time[0]) ) ;
+  Double_t mybl = 0. ;
+  for ( int i=0 ; i < nbl ; i++ ) mybl += volt[i] ;
+  mybl /= nbl ;
   
-  TVectorD voltbl(Nbins,volt) ;
-  voltbl.AddSomeConstant(-1.0*mybl,voltbl) ;
-  
-  double avx = voltbl.Max( ) ;
-  double avn = voltbl.Min( ) ;
+  //Extremes of volt-mybl, the same as those of volt (CalcVmaxmin) shifted
+  double avx = Vmax-mybl ;
+  double avn = Vmin-mybl ;
   Polarity = ( fabs(avx) > fabs(avn) ) ? 1 : -1 ;
   //cout  << "Polarity" << Polarity << endl;
 
@@ -393,30 +533,12 @@ void TWaveform::FitSignalTimeL( double &TimeL , int &iTimeL ) {
   }
   
   //Fit the slope of volt:time from the Baseline to the middle of the Vmax
-  TF1 *fpol1 = new TF1("fpol1","pol1",time[iTimeL],time[iPos]);
-  TGraph *gr = new TGraph( iPos-iTimeL+1, &time[iTimeL] , &volt[iTimeL] );
-  #define LPLOTFIT 0
-  #if LPLOTFIT==1
-    gr->Fit("fpol1","RQ");
-  #else
-    gr->Fit("fpol1","RQ0");
-  #endif
-  Double_t offset=fpol1->GetParameter(0);
-  Double_t  slope=fpol1->GetParameter(1);
+  Double_t offset , slope ;
+  FitLine( iPos-iTimeL+1 , &time[iTimeL] , &volt[iTimeL] , time[iTimeL] , time[iPos] , 0. , offset , slope ) ;
  
   TimeL  = (slope!=0.)? (BlineMean-offset)/slope : 0.0 ;
   iTimeL = TMath::Nint( (TimeL-time[0])/(time[1]-time[0]) ) ;
   
-  #if LPLOTFIT==1
-    TGraph *grt = new TGraph( Nbins, &time[0] , &volt[0] );
-    grt->Draw("awlp") ; fpol1->Draw("lsame") ;
-    grt->Write(); fpol1->Write();
-    delete grt;
-  #endif
-
-  delete fpol1;
-  delete gr;
-  
   //cout << "tleft="<<TimeL<<endl;
     
 }
@@ -469,36 +591,14 @@ void TWaveform::FitSignalTimeR( double &TimeR , int &iTimeR ) {
     return ;
   }
   
-  //Fit the slope of volt:time from the Baseline to the middle of the Vmax
-  TVectorD voltbl(Nbins,volt) ;
-  TVectorD timed(Nbins,time) ;
-  voltbl.AddSomeConstant(-1.0*BlineMean,voltbl) ;
-  TGraph *gr = new TGraph( timed , voltbl );
-  TF1 *fpol1 = new TF1("fpol1","pol1",time[iPos],time[iTimeR]);
-  
-  #define RPLOTFIT 0
-  #if RPLOTFIT==1
-    gr->Fit("fpol1","RQ");
-  #else
-    gr->Fit("fpol1","RQ0");
-  #endif
-  Double_t offset=fpol1->GetParameter(0);
-  Double_t  slope=fpol1->GetParameter(1);
+  //Fit the slope of volt:time from the Baseline to the middle of the Vmax, volt baseline corrected
+  Double_t offset , slope ;
+  FitLine( Nbins , time , volt , time[iPos] , time[iTimeR] , -1.0*BlineMean , offset , slope ) ;
  
   TimeR  = (slope!=0.)? (BlineMean-offset)/slope : 0.0 ;
   iTimeR = TMath::Nint( (TimeR-time[0])/(time[1]-time[0]) ) ;
   
   //cout << "tleft="<<TimeL<<endl;
-
-  #if RPLOTFIT==1
-    gr->Draw("awlp") ; fpol1->Draw("lsame") ;
-    gr->Write(); fpol1->Write();
-  #endif
-  
-  delete fpol1;
-  delete gr;
-  timed.Clear();
-  voltbl.Clear();
     
 }
 
@@ -621,7 +721,7 @@ void TWaveform::CalcSignalTimeLR( ) {
 
 void TWaveform::CalcBline() {
 
-  int N5ns = TMath::Nint( T4BL/(time[1]-time[0]) );
+  int N5ns = TMath::Nint( t4bl/(time[1]-time[0]) );
   if ( itleft>0 ) {
     //If the pulses are not monotonous (increasing or decreasing), itleft can be wrong. 
     //If itleft falls in the signal, then BlineMean is wrong. We use BlineMean to correct 
@@ -647,6 +747,9 @@ double TWaveform::CalcRiseTime( double fraction ) {
 
 void TWaveform::CreateHistos( ) {
 
+  if ( hvt ) return ;
+  Need( kSignal ) ;
+
   double tmin = TMath::MinElement( Nbins , time ) ;
   double tmax = TMath::MaxElement( Nbins , time ) ;
   double At   = (tmax-tmin)/(Nbins-1.0) ;
@@ -700,6 +803,7 @@ void TWaveform::CreateHistos( ) {
 
 void TWaveform::CalcRunningCharge( TMeas *em ) {
   
+  Need( kSignal ) ;
   Int_t ir = 1 ;
   em->Qt[0] = volt[0]- BlineMean ;
   while ( ir < Nbins ) { 
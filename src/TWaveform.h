@@ -33,6 +33,7 @@ class TWaveform : public TObject {
 	  	  
        TWaveform() ;
        TWaveform( TMeas *em ) ;
+       TWaveform( TMeas *em , Bool_t lazy ) ;  //lazy: view on the arrays of em, see Evaluate
        TWaveform( int nel , double *tin , double *vin , double Bias  ) ;
 	  ~TWaveform() ;
 	  
@@ -67,12 +68,33 @@ class TWaveform : public TObject {
 	  Double_t GetCharge( double tinf , double tsup ) ;   
 	  Double_t RGetCharge( double tinf , double tsup ) ;   
           void     CalcRunningCharge( TMeas *em ) ;           //!
+	  Double_t GetQ50()      ;			      //!
+	  Double_t GetQtot()     ;			      //!
+
+	  /* A lazy waveform borrows time and volt from its TMeas, which must stay unchanged
+	     while it is used, and calculates each feature the first time it is asked for.
+	     Evaluate calculates all those stored in the tree (and the running charge of em,
+	     if given); histograms are only built by CreateHistos */
+	  void     Evaluate( TMeas *em = nullptr ) ;          //!
+	  void     CreateHistos() ;			      //!
+
+	  /* Features calculated elsewhere for a block of waveforms (WaveformBatch), so the
+	     waveform does not calculate them again. mybl: mean of the first
+	     Nint(GetT4BL(Setup)/At) samples */
+	  void     SetExtrema( int imax , int imin , double mybl ) ;  //!
+	  void     SetRiseTime( double rtime ) ;		      //!
+	  static Double_t GetT4BL( Int_t Setup ) ;	      //! Time of the baseline before the signal
 	  
 	  
 
   private:						     
           int    Nbins     ;				    //!
 	  int    Polarity  ;				    //!
+	  bool   owner     ;				    //! time and volt are copies
+	  int    known     ;				    //! Features already calculated
+	  double t4bl      ;				    //! Time of the baseline before the signal
+
+	  enum { kExtrema = 1 , kSignal = 2 , kRise = 4 , kCharge = 8 , kAll = 15 } ;
 	  
 	  Double_t Vmax      ;
 	  Double_t Vmin      ;
@@ -100,7 +122,8 @@ class TWaveform : public TObject {
 	  void   CalcPolarity() ;						       //!
 	  void   CalcBline()  ; 						       //!
 	  double CalcRiseTime( double fraction=RTIME )  ;			       //!
-	  void   CreateHistos() ;						       //!		       //!
+	  void   Need( int what ) ;						       //!
+	  int    TimeBin( double t , double tmin , double At ) ;		       //!
    
   /*protected:  //classes that inherit from TWaveform can access these methods*/
     
@@ -40,9 +40,9 @@ void call_from_thread(int tid) {
 	TRACSsim[tid]->set_tcount(tid);
 	if(tid==0)
 	{
-		i_ramo_array.clear();
-		TRACSsim[tid]->resize_array();
-		TRACSsim[tid]->write_header(tid);
+		if (resultSink == nullptr || resultSink->IsHetct()) TRACSsim[tid]->write_header(tid);
+		else TRACSsim[tid]->set_hetctFilename();
+		if (resultSink != nullptr) resultSink->Open(TRACSsim[tid]->get_hetctFilename(), TRACSsim[tid]->GetMeasHeader());
 		TRACSsim.resize(num_threads);
 	}
 	std::cout << "Thread with tid " << tid << " is OUTSIDE the critical section "<< std::endl;
@@ -65,13 +65,12 @@ void call_from_thread_FitPar(int tid, const std::vector<Double_t>& par) {
 	TRACSsim[tid]->set_tcount(tid);
 	if(tid==0)
 	{
-		i_ramo_array.clear();
-		TRACSsim[tid]->resize_array();
 		TRACSsim[tid]->write_header(tid);
 		TRACSsim.resize(num_threads);
 	}
 	std::cout << "Thread with tid " << tid << " is OUTSIDE the critical section "<< std::endl;
 	mtx.unlock();
+	TRACSsim[tid]->set_Fidelity(fidelity);
 	TRACSsim[tid]->set_FitParam(par);
 	TRACSsim[tid]->loop_on(tid);
 
@@ -87,13 +86,12 @@ void call_from_thread_FitNorm(int tid, const std::vector<Double_t>& par) {
 	TRACSsim[tid]->set_tcount(tid);
 	if(tid==0)
 	{
-		i_ramo_array.clear();
-		TRACSsim[tid]->resize_array();
 		TRACSsim[tid]->write_header(tid);
 		TRACSsim.resize(num_threads);
 	}
 	std::cout << "Thread with tid " << tid << " is OUTSIDE the critical section "<< std::endl;
 	mtx.unlock();
+	TRACSsim[tid]->set_Fidelity(fidelity);
 	TRACSsim[tid]->set_Fit_Norm(par);
 	TRACSsim[tid]->loop_on(tid);
 
@@ -328,7 +328,7 @@ std::string utilities::vector_to_string(std::vector<double> input_list)
 void utilities::parse_config_file(std::string fileName, std::string &carrierFile, double &depth, double &width, double &pitch, int &nns, double &temp, double &trapping, double &fluence,
 		int &nThreads, int &n_cells_x, int &n_cells_y, char &bulk_type, char &implant_type, int &waveLength, std::string &scanType, double &C, double &dt, double &max_time,
 		double &v_init, double &deltaV, double &v_max, double &v_depletion, double &zInit, double &zMax, double &deltaZ, double &yInit, double &yMax, double &deltaY,
-		std::vector<double> &neff_param, std::string &neffType, double &tolerance, double &chiFinal, int &diffusion, double &fitNorm/*, double &gen_time*/)
+		std::vector<double> &neff_param, std::string &neffType, double &tolerance, double &chiFinal, int &diffusion, double &fitNorm, int &convolution, std::string &transferFunction, double &bandwidth/*, double &gen_time*/)
 {
 	// Creat map to hold all values as strings 
 	std::map< std::string, std::string> valuesMap;
@@ -646,6 +646,24 @@ void utilities::parse_config_file(std::string fileName, std::string &carrierFile
 	converter.str("");
 	tempString = std::string("");
 
+	tempString = std::string("convolution");
+	converter << valuesMap[tempString];
+	converter >> convolution;
+	converter.clear();
+	converter.str("");
+	tempString = std::string("");
+
+	tempString = std::string("TransferFunction");
+	transferFunction = valuesMap[tempString];
+	tempString = std::string("");
+
+	tempString = std::string("Bandwidth");
+	converter << valuesMap[tempString];
+	converter >> bandwidth;
+	converter.clear();
+	converter.str("");
+	tempString = std::string("");
+
 	/*tempString = std::string("generation_time");
 		converter << valuesMap[tempString];
 		converter >> gen_time;
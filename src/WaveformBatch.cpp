@@ -0,0 +1,211 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************WaveformBatch***********************************
+ *
+ * Every pass runs over all the nmax lanes, used or not, so the inner loops have a fixed
+ * length; the lanes not in use just hold old samples. Decisions are written as
+ * selections (c ? a : b) rather than branches, which the compiler turns into vector
+ * blends.
+ *
+ */
+
+#include "WaveformBatch.h"
+
+#include <cmath>
+#include <cstring>
+
+/**
+ *
+ * @param nt
+ * @param time
+ * @param nmax
+ */
+WaveformBatch::WaveformBatch( int nt , const double * time , int nmax ) : nt( nt ) , nmax( nmax ) , n( 0 ) ,
+	time( time , time + nt ) , v( (size_t) nt*nmax , 0. ) , q( (size_t) nt*nmax , 0. ) ,
+	vmax( nmax ) , vmin( nmax ) , blmean( nmax ) , blrms( nmax ) , th( nmax ) , pol( nmax ) , bl( nmax ) ,
+	imax( nmax ) , imin( nmax ) , pos( nmax ) , idx( nmax ) {
+
+}
+
+/**
+ *
+ * @param nt
+ * @param time
+ * @return
+ */
+bool WaveformBatch::SameAxis( int nt , const double * time ) const {
+
+	return nt == this->nt && memcmp( time , this->time.data() , nt*sizeof( double ) ) == 0 ;
+
+}
+
+/**
+ *
+ * @param volt
+ * @return
+ */
+int WaveformBatch::Add( const double * volt ) {
+
+	if ( n == nmax ) return -1 ;
+	double * col = v.data() + n ;
+	for ( int i = 0 ; i < nt ; i++ ) col[(size_t) i*nmax] = volt[i] ;
+	return n++ ;
+
+}
+
+/*
+ * First index of the maximum and of the minimum, as TMath::LocMax/LocMin
+ */
+void WaveformBatch::Extrema( ) {
+
+	const double * vi = v.data() ;
+	for ( int w = 0 ; w < nmax ; w++ ) {
+		vmax[w] = vmin[w] = vi[w] ;
+		imax[w] = imin[w] = 0 ;
+	}
+
+	double * xmax = vmax.data() , * xmin = vmin.data() , * jmax = imax.data() , * jmin = imin.data() ;
+	for ( int i = 1 ; i < nt ; i++ ) {
+		vi = v.data() + (size_t) i*nmax ;
+		double di = i ;
+		//Indices first, with the extremes so far; one quantity per loop, or they do not vectorize
+		for ( int w = 0 ; w < nmax ; w++ ) jmax[w] = ( xmax[w] < vi[w] ) ? di : jmax[w] ;
+		for ( int w = 0 ; w < nmax ; w++ ) jmin[w] = ( xmin[w] > vi[w] ) ? di : jmin[w] ;
+		for ( int w = 0 ; w < nmax ; w++ ) xmax[w] = ( xmax[w] < vi[w] ) ? vi[w] : xmax[w] ;
+		for ( int w = 0 ; w < nmax ; w++ ) xmin[w] = ( xmin[w] > vi[w] ) ? vi[w] : xmin[w] ;
+	}
+
+}
+
+/*
+ * Mean as TMath::Mean; RMS as the square root of the mean squared deviation
+ */
+/**
+ *
+ * @param nbl
+ */
+void WaveformBatch::Baseline( int nbl ) {
+
+	if ( nbl > nt ) nbl = nt ;
+	if ( nbl < 1 ) return ;
+
+	for ( int w = 0 ; w < nmax ; w++ ) blmean[w] = blrms[w] = 0. ;
+	for ( int i = 0 ; i < nbl ; i++ ) {
+		const double * vi = v.data() + (size_t) i*nmax ;
+		for ( int w = 0 ; w < nmax ; w++ ) blmean[w] += vi[w] ;
+	}
+	for ( int w = 0 ; w < nmax ; w++ ) blmean[w] /= nbl ;
+
+	for ( int i = 0 ; i < nbl ; i++ ) {
+		const double * vi = v.data() + (size_t) i*nmax ;
+		for ( int w = 0 ; w < nmax ; w++ ) blrms[w] += ( vi[w]-blmean[w] )*( vi[w]-blmean[w] ) ;
+	}
+	for ( int w = 0 ; w < nmax ; w++ ) blrms[w] = std::sqrt( blrms[w]/nbl ) ;
+
+}
+
+/*
+ * The crossing to the left is the last sample before the extreme that is not above the
+ * threshold, the one to the right the first after it: the whole axis is scanned and the
+ * last (or first) one that qualifies is kept
+ */
+/**
+ *
+ * @param fraction
+ * @param bline
+ * @param polarity
+ * @param left
+ * @param t
+ * @param it
+ */
+void WaveformBatch::Crossing( double fraction , const double * bline , const int * polarity , bool left , double * t , int * it ) {
+
+	for ( int w = 0 ; w < nmax ; w++ ) {
+		int ww = ( w < n ) ? w : 0 ;                    //Lanes not in use follow lane 0
+		double ext = ( polarity[ww]==1 ) ? vmax[w] : vmin[w] ;
+		th[w]  = bline[ww] + fraction*( ext-bline[ww] ) ;
+		pos[w] = ( polarity[ww]==1 ) ? imax[w] : imin[w] ;
+		pol[w] = polarity[ww] ;
+		idx[w] = left ? 0 : -1 ;
+	}
+
+	if ( left ) {
+		for ( int i = 1 ; i < nt ; i++ ) {
+			const double * vi = v.data() + (size_t) i*nmax ;
+			double di = i ;
+			for ( int w = 0 ; w < nmax ; w++ ) {
+				bool c = ( di < pos[w] ) & !( pol[w]*( vi[w]-th[w] ) > 0. ) ;
+				idx[w] = c ? di : idx[w] ;
+			}
+		}
+	} else {
+		for ( int i = nt-1 ; i > 0 ; i-- ) {
+			const double * vi = v.data() + (size_t) i*nmax ;
+			double di = i ;
+			for ( int w = 0 ; w < nmax ; w++ ) {
+				bool c = ( di > pos[w] ) & !( pol[w]*( vi[w]-th[w] ) > 0. ) ;
+				idx[w] = c ? di : idx[w] ;
+			}
+		}
+	}
+
+	//Linear interpolation with the neighbour on the side of the extreme
+	for ( int w = 0 ; w < n ; w++ ) {
+		int i = (int) idx[w] ;
+		if ( left ) {
+			if ( i == 0 ) { t[w] = 0 ; it[w] = 0 ; continue ; }
+			double v0 = v[(size_t) i*nmax+w] , v1 = ( i+1 < nt ) ? v[(size_t) (i+1)*nmax+w] : v0 ;
+			t[w] = ( i+1 < nt && (v1-v0)!=0. ) ? time[i] + (time[i+1]-time[i])/(v1-v0)*(th[w]-v0) : time[i] ;
+		} else {
+			if ( i < 0 ) continue ;
+			double v0 = v[(size_t) i*nmax+w] , v1 = v[(size_t) (i-1)*nmax+w] ;
+			t[w] = ( (v1-v0)!=0. ) ? time[i] + (time[i-1]-time[i])/(v1-v0)*(th[w]-v0) : time[i] ;
+		}
+		it[w] = i ;
+	}
+
+}
+
+/*
+ * Same sums as TWaveform::CalcRunningCharge
+ */
+/**
+ *
+ * @param bline
+ */
+void WaveformBatch::RunningCharge( const double * bline ) {
+
+	for ( int w = 0 ; w < nmax ; w++ ) bl[w] = bline[ ( w < n ) ? w : 0 ] ;
+
+	for ( int w = 0 ; w < nmax ; w++ ) q[w] = v[w] - bl[w] ;
+	for ( int i = 1 ; i < nt ; i++ ) {
+		const double * vi = v.data() + (size_t) i*nmax ;
+		const double * qp = q.data() + (size_t) (i-1)*nmax ;
+		double * qi = q.data() + (size_t) i*nmax ;
+		for ( int w = 0 ; w < nmax ; w++ ) qi[w] = qp[w] + vi[w] - bl[w] ;
+	}
+
+}
+
+/**
+ *
+ * @param w
+ * @param qt
+ */
+void WaveformBatch::GetRunningCharge( int w , double * qt ) const {
+
+	const double * col = q.data() + w ;
+	for ( int i = 0 ; i < nt ; i++ ) qt[i] = col[(size_t) i*nmax] ;
+
+}
@@ -0,0 +1,126 @@
+/*
+ * @ Copyright 2014-2017 CERN and Instituto de Fisica de Cantabria - Universidad de Cantabria. All rigths not expressly granted are reserved [tracs.ssd@cern.ch]
+ * This file is part of TRACS.
+ *
+ * TRACS is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the Licence.
+ *
+ * TRACS is distributed in the hope that it will be useful , but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with TRACS. If not, see <http://www.gnu.org/licenses/>
+ */
+
+/************************************WaveformStore***********************************
+ *
+ * A map of nv*ny*nz points of nt samples used to be as many valarrays (or histograms),
+ * each one a separate allocation. Here it is one aligned block, allocated once per shape.
+ *
+ */
+
+#include <WaveformStore.h>
+
+#include <iostream>
+#include <cstdlib>
+
+#define CACHELINE 64
+
+WaveformStore::WaveformStore( ) {
+
+	buffer = nullptr ;
+	stride = 0 ;
+	nv = ny = nz = nt = 0 ;
+	single = false ;
+
+}
+
+WaveformStore::~WaveformStore( ) {
+
+	free( buffer ) ;
+
+}
+
+/*
+ * Room for nv*ny*nz rows of nt samples, all of them empty. Nothing is done if the shape
+ * and precision do not change, so every interface writing to the store may call it.
+ */
+/**
+ *
+ * @param nv
+ * @param ny
+ * @param nz
+ * @param nt
+ * @param single
+ */
+void WaveformStore::Resize( int nv , int ny , int nz , int nt , bool single ) {
+
+	std::lock_guard<std::mutex> lock( smtx ) ;
+	if ( nv == this->nv && ny == this->ny && nz == this->nz && nt == this->nt && single == this->single ) return ;
+
+	this->nv = nv ; this->ny = ny ; this->nz = nz ; this->nt = nt ;
+	this->single = single ;
+
+	size_t bytes = (size_t) nt * ( single ? sizeof(float) : sizeof(double) ) ;
+	stride = ( ( bytes + CACHELINE - 1 )/CACHELINE )*CACHELINE ;
+
+	free( buffer ) ;
+	buffer = nullptr ;
+	size_t nrows = (size_t) nv*ny*nz ;
+	if ( nrows*stride > 0 && posix_memalign( (void **) &buffer , CACHELINE , nrows*stride ) != 0 ) {
+		std::cout << "Error: cannot allocate " << nrows*stride << " bytes for " << nrows << " waveforms" << std::endl ;
+		std::cout << "Exiting!"<< std::endl ;
+		exit(-1);
+	}
+	length.assign( nrows , 0 ) ;
+
+}
+
+/**
+ *
+ * @param row
+ * @return
+ */
+WaveformStore::View WaveformStore::operator[ ]( size_t row ) const {
+
+	return View( buffer + row*stride , length[row] , single ) ;
+
+}
+
+/**
+ *
+ * @param row
+ * @param w
+ */
+void WaveformStore::Set( size_t row , const std::valarray<double> & w ) {
+
+	Set( row , ( w.size() > 0 ) ? &w[0] : nullptr , w.size() ) ;
+
+}
+
+/**
+ *
+ * @param row
+ * @param w
+ * @param n
+ * @param stride
+ */
+void WaveformStore::Set( size_t row , const double * w , size_t n , size_t stride ) {
+
+	if ( n > (size_t) nt ) {
+		std::cout << "Error: waveform of " << n << " samples does not fit in a store of " << nt << std::endl ;
+		std::cout << "Exiting!"<< std::endl ;
+		exit(-1);
+	}
+
+	char * p = buffer + row*this->stride ;
+	if ( single ) {
+		float * f = (float *) p ;
+		for ( size_t i = 0 ; i < n ; i++ ) f[i] = (float) w[i*stride] ;
+	}
+	else {
+		double * d = (double *) p ;
+		for ( size_t i = 0 ; i < n ; i++ ) d[i] = w[i*stride] ;
+	}
+	length[row] = n ;
+
+}